@@ -72,6 +72,10 @@ struct BlinkCopyCommand: ParsableCommand {
         help: "Copy only when source is newer than destination, considering the timestamp. This includes -p.")
   var update: Bool = false
 
+  @Flag(name: .long,
+        help: "Verify copied files by their SHA-256, hashed on the remote when possible. BLAKE3 when both sides are remote and have b3sum.")
+  var verify: Bool = false
+
   @Argument(help: "SOURCE(s) ... DEST",
             transform: {
     try FileLocationPath($0)
@@ -258,8 +262,14 @@ public class BlinkCopy: NSObject {
             .map { (source, $0) }
             .eraseToAnyPublisher()
         }
-        .flatMap {
-          $1.copy(from: [$0], args: copyArguments)
+        .flatMap { (source, destination) -> CopyProgressInfoPublisher in
+          let copy = destination.copy(from: [source], args: copyArguments)
+          guard self.command.verify else {
+            return copy
+          }
+          return copy
+            .append(self.verify(source, copiedTo: destination))
+            .eraseToAnyPublisher()
         }.eraseToAnyPublisher()
     }.sink(receiveCompletion: { completion in
       if case let .failure(error) = completion {
@@ -317,6 +327,48 @@ public class BlinkCopy: NSObject {
     return rc
   }
 
+  // Compares the digests of the source with the ones where it was copied to.
+  func verify(_ source: Translator, copiedTo destination: Translator) -> CopyProgressInfoPublisher {
+    let name = (source.current as NSString).lastPathComponent
+    let copied = destination.isDirectory ? destination.cloneWalkTo(name) : .just(destination)
+
+    return copied
+      .flatMap { copied in
+        self.hashAlgorithm(for: [source, copied])
+          .flatMap { algorithm -> AnyPublisher<HashComparison, Error> in
+            let hasher = FileHasher(algorithm: algorithm)
+            return Publishers.Zip(hasher.digests(of: source), hasher.digests(of: copied))
+              .map { HashComparison(source: $0, destination: $1) }
+              .eraseToAnyPublisher()
+          }
+      }
+      .tryMap { comparison -> Void in
+        print("\u{001B}[KVerified \(comparison.matching) files from \(source.current)", to: &self.stdout)
+        guard comparison.isMatching else {
+          comparison.different.forEach { print("Different: \($0)", to: &self.stderr) }
+          comparison.missing.forEach { print("Missing: \($0)", to: &self.stderr) }
+          throw CommandError(message: "Verification failed for \(source.current)")
+        }
+      }
+      .flatMap { Empty<CopyProgressInfo, Error>() }
+      .eraseToAnyPublisher()
+  }
+
+  // Hashing locally needs SHA-256. Anything else only if all sides can hash it remotely.
+  func hashAlgorithm(for translators: [Translator]) -> AnyPublisher<HashAlgorithm, Error> {
+    let remotes = translators.compactMap { $0 as? HashTranslator }
+    guard remotes.count == translators.count else {
+      return .just(.sha256)
+    }
+
+    return remotes.publisher
+      .setFailureType(to: Error.self)
+      .flatMap { $0.canHash(using: .blake3) }
+      .allSatisfy { $0 }
+      .map { $0 ? HashAlgorithm.blake3 : .sha256 }
+      .eraseToAnyPublisher()
+  }
+
   func localTranslator(to path: String) -> AnyPublisher<Translator, Error> {
     return .just(FlowConsoleFiles.Local())
   }
@@ -200,6 +200,36 @@ struct SSHCommand: ParsableCommand {
   @Flag(name: [.customShort("A")], help: "Forward Agent.")
   var agentForward: Bool = false
 
+  @Flag(name: .customLong("reconnect"),
+        help: "Re-establish the session automatically when the network changes or the connection drops.")
+  var autoReconnect: Bool = false
+
+  @Option(
+    name: .customLong("attach"),
+    help: .init(
+      "Attach to a tmux or screen session on the remote, created if needed, on connect and on every reconnect. The session name defaults to blink.",
+      valueName: "tmux|screen[:name]"
+    )
+  )
+  var attachSession: String?
+  var attachCommand: String? {
+    guard let attach = attachSession else {
+      return nil
+    }
+    let comps = attach.split(separator: ":", maxSplits: 1).map(String.init)
+    let name = comps.count > 1 ? comps[1] : "blink"
+    // The name goes on the remote command line as is.
+    guard !name.isEmpty,
+          name.allSatisfy({ $0.isLetter || $0.isNumber || "_-.".contains($0) }) else {
+      return nil
+    }
+    switch comps[0] {
+    case "tmux":   return "tmux new-session -A -s \(name)"
+    case "screen": return "screen -D -R -S \(name)"
+    default:       return nil
+    }
+  }
+
   // SSH Port
   @Option(
     name: [.customShort("p", allowingJoined: true)],
@@ -257,6 +287,15 @@ struct SSHCommand: ParsableCommand {
     if disableTTY && forceTTY {
       throw ValidationError("Incompatible flags t and T")
     }
+
+    if attachSession != nil {
+      if attachCommand == nil {
+        throw ValidationError("Unknown session manager for attach. Use tmux or screen.")
+      }
+      if !command.isEmpty {
+        throw ValidationError("Cannot attach to a session and run a command")
+      }
+    }
   }
 }
 
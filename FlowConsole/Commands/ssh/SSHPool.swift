@@ -68,34 +68,22 @@ class SSHPool {
                                proxy: SSH.SSHClient.ExecProxyCommandCallback? = nil,
                                exposeSocket exposed: Bool = true) -> AnyPublisher<SSH.SSHClient, Error> {
     let pb = PassthroughSubject<SSH.SSHClient, Error>()
-    var dial: AnyCancellable?
-    var runLoop: RunLoop!
-
-    let t = Thread {
-      runLoop = RunLoop.current
-
-      dial = SSH.SSHClient.dial(host, with: config, withProxy: proxy)
-        //.print("SSHClient Pool")
-        .sink(
-          receiveCompletion: { completion in
-            pb.send(completion: completion)
-          },
-          receiveValue: { [weak self] conn in
-            let control = SSHClientControl(for: conn, on: host, with: config, running: runLoop, exposed: exposed)
-            self?.queue.sync {
-              SSHPool.shared.controls.append(control)
-            }
-            pb.send(conn)
-          })
-
-      // NOTE Before we let the Pool control the RunLoop, and the problem is that SSHClient needs to be in full control
-      // as it may have multiple nested runs internally. Using SSHClient.run, the SSHClient will continue until the object itself is fully disposed.
-      SSH.SSHClient.run()
-
-      print("Pool Thread out")
-    }
-
-    t.start()
+    // Connections share a fixed set of loops instead of running a thread each.
+    let loop = SSHEventLoopGroup.shared.next()
+
+    var dial: AnyCancellable? = SSH.SSHClient.dial(host, with: config, withProxy: proxy, on: loop)
+      //.print("SSHClient Pool")
+      .sink(
+        receiveCompletion: { completion in
+          pb.send(completion: completion)
+        },
+        receiveValue: { [weak self] conn in
+          let control = SSHClientControl(for: conn, on: host, with: config, running: loop.runLoop, exposed: exposed)
+          self?.queue.sync {
+            SSHPool.shared.controls.append(control)
+          }
+          pb.send(conn)
+        })
 
     return pb.buffer(size: 1, prefetch: .byRequest, whenFull: .dropOldest)
       .handleEvents(receiveCancel: {
@@ -150,6 +138,17 @@ extension SSHPool {
   }
 }
 
+extension SSHPool {
+  // Stop handing out a connection that is known to be dead, even if libssh did not notice yet.
+  // Whoever holds it will still get their failures from it.
+  static func remove(connection: SSH.SSHClient) {
+    guard let c = control(on: connection) else {
+      return
+    }
+    shared.removeControl(c)
+  }
+}
+
 // Shell
 extension SSHPool {
   static func register(shellOn connection: SSH.SSHClient) {
@@ -225,6 +224,23 @@ extension SSHPool {
   }
 }
 
+// Tunnel counters, for the dashboard.
+extension SSHPool {
+  static func localTunnelStats(on connection: SSH.SSHClient) -> [PortForwardInfo:SSHTunnelStats.Snapshot] {
+    guard let c = control(on: connection) else {
+      return [:]
+    }
+    return c.localTunnels.mapValues { $0.stats.snapshot }
+  }
+
+  static func remoteTunnelStats(on connection: SSH.SSHClient) -> [PortForwardInfo:SSHTunnelStats.Snapshot] {
+    guard let c = control(on: connection) else {
+      return [:]
+    }
+    return c.remoteTunnels.mapValues { $0.stats.snapshot }
+  }
+}
+
 // Dynamic Forward
 extension SSHPool {
   static func register(_ server: SOCKSServer,
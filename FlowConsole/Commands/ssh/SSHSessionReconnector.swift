@@ -0,0 +1,115 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+import Foundation
+import Network
+
+
+/**
+ Tells a session when it has to be re-established after the network changed under it.
+ A path change only counts when the local address of the connection is gone from the
+ device, ie moving from Wi-Fi to cellular, so adding an interface does not drop a working
+ session. Failed attempts are retried with exponential backoff.
+ */
+class SSHSessionReconnector {
+  static let maxAttempts = 10
+
+  private let monitor = NWPathMonitor()
+  private let queue = DispatchQueue(label: "SSHSessionReconnector")
+  private var lastInterfaces: [String]? = nil
+  private let localAddress: () -> String?
+  private let reconnect: () -> ()
+  private(set) var attempts = 0
+
+  init(localAddress: @escaping () -> String?, reconnect: @escaping () -> ()) {
+    self.localAddress = localAddress
+    self.reconnect = reconnect
+  }
+
+  func start() {
+    monitor.pathUpdateHandler = { [weak self] in self?.pathChanged($0) }
+    monitor.start(queue: queue)
+  }
+
+  func stop() {
+    monitor.cancel()
+  }
+
+  /// Delay before the next attempt, or nil once there are no attempts left.
+  func nextDelay() -> TimeInterval? {
+    guard attempts < Self.maxAttempts else {
+      return nil
+    }
+    attempts += 1
+    return min(0.5 * pow(2, Double(attempts - 1)), 8)
+  }
+
+  func reset() {
+    attempts = 0
+  }
+
+  private func pathChanged(_ path: NWPath) {
+    guard path.status == .satisfied else {
+      return
+    }
+    let interfaces = path.availableInterfaces.map(\.name)
+    defer { lastInterfaces = interfaces }
+    guard let last = lastInterfaces, last != interfaces else {
+      return
+    }
+    if let address = localAddress(), Self.isAssigned(address) {
+      return
+    }
+    reconnect()
+  }
+
+  static func isAssigned(_ address: String) -> Bool {
+    var ifaddrs: UnsafeMutablePointer<ifaddrs>? = nil
+    guard getifaddrs(&ifaddrs) == 0 else {
+      return false
+    }
+    defer { freeifaddrs(ifaddrs) }
+
+    var hostBuffer = [CChar](repeating: 0, count: Int(NI_MAXHOST))
+    var ifa = ifaddrs
+    while let cur = ifa {
+      defer { ifa = cur.pointee.ifa_next }
+      guard let addr = cur.pointee.ifa_addr,
+            addr.pointee.sa_family == AF_INET || addr.pointee.sa_family == AF_INET6 else {
+        continue
+      }
+      let len = socklen_t(addr.pointee.sa_family == AF_INET ? MemoryLayout<sockaddr_in>.size : MemoryLayout<sockaddr_in6>.size)
+      if getnameinfo(addr, len, &hostBuffer, socklen_t(hostBuffer.count), nil, 0, NI_NUMERICHOST) == 0,
+         String(cString: hostBuffer) == address {
+        return true
+      }
+    }
+    return false
+  }
+}
@@ -0,0 +1,479 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+import Combine
+import Dispatch
+import Foundation
+
+import ArgumentParser
+import FlowConsoleConfig
+import SSH
+import ios_system
+
+fileprivate let Version = "1.0.0"
+
+@_cdecl("fc_pssh_main")
+public func fc_pssh_main(argc: Int32, argv: Argv) -> Int32 {
+  setvbuf(thread_stdout, nil, _IONBF, 0)
+  setvbuf(thread_stderr, nil, _IONBF, 0)
+
+  let session = Unmanaged<MCPSession>.fromOpaque(thread_context).takeUnretainedValue()
+  let cmd = BlinkParallelSSH()
+  session.registerSSHClient(cmd)
+  let rc = cmd.start(argc, argv: argv.args(count: argc))
+  session.unregisterSSHClient(cmd)
+
+  return rc
+}
+
+struct ParallelSSHCommand: ParsableCommand {
+  static var configuration = CommandConfiguration(
+    commandName: "pssh",
+    abstract: "Run COMMAND on multiple hosts in parallel.",
+    discussion: """
+    Hosts are resolved like ssh does, including your Hosts and ssh_config. Connections are
+    taken from the pool when a ControlMaster is active for the host. Output is streamed with
+    the host as prefix, and a summary is printed once every host is done.
+    """,
+    version: Version)
+
+  @Option(name: [.customShort("H"), .customLong("host")],
+          help: "Host to run on, as [user@]host. Can be repeated or comma separated.")
+  var hostArgs: [String] = []
+
+  @Option(name: [.customShort("f"), .customLong("hosts-file")],
+          help: "File with a host per line. Lines starting with # are ignored.")
+  var hostsFile: String?
+
+  @Option(name: [.customShort("p"), .customLong("parallel")],
+          help: "Maximum number of hosts running at the same time.")
+  var parallel: Int = 16
+
+  @Option(name: .shortAndLong,
+          help: "Seconds before a host is abandoned, including connection time. 0 to disable.")
+  var timeout: Int = 60
+
+  @Flag(name: .shortAndLong,
+        help: "Print the output of each host as a block when it finishes, instead of streaming lines.")
+  var inline: Bool = false
+
+  @Flag(name: .shortAndLong)
+  var verbose: Int
+
+  @Argument(parsing: .remaining, help: "Command to run on each host.")
+  var command: [String] = []
+
+  func validate() throws {
+    if hostArgs.isEmpty && hostsFile == nil {
+      throw ValidationError("No hosts specified. Use -H or -f.")
+    }
+    if command.isEmpty {
+      throw ValidationError("No command specified.")
+    }
+    if parallel < 1 {
+      throw ValidationError("Parallel must be at least 1.")
+    }
+  }
+
+  func hosts() throws -> [String] {
+    var hosts = hostArgs.flatMap { $0.split(separator: ",") }.map(String.init)
+    if let hostsFile = hostsFile {
+      let path = (hostsFile as NSString).expandingTildeInPath
+      let content = try String(contentsOfFile: path, encoding: .utf8)
+      hosts += content.split(whereSeparator: \.isNewline).map(String.init)
+    }
+    return hosts
+      .map { $0.trimmingCharacters(in: .whitespaces) }
+      .filter { !$0.isEmpty && !$0.starts(with: "#") }
+  }
+}
+
+/// State of the command on a single host. Only touched from the command RunLoop.
+fileprivate class HostRun {
+  enum Status {
+    case pending
+    case running
+    case exited(Int32?)
+    case failed(Error)
+    case timedOut
+    case cancelled
+
+    var isFinished: Bool {
+      switch self {
+      case .pending, .running: return false
+      default: return true
+      }
+    }
+  }
+
+  let alias: String
+  var status: Status = .pending
+  var started: Date?
+  var connected: Date?
+  var finished: Date?
+
+  var connection: SSH.SSHClient?
+  var stream: SSH.Stream?
+  var cancellable: AnyCancellable?
+  var timer: Timer?
+
+  // Partial lines are held until the newline arrives, so lines from different
+  // hosts never interleave.
+  var pendingStdout = Data()
+  var pendingStderr = Data()
+  var output = Data()
+
+  init(_ alias: String) {
+    self.alias = alias
+  }
+}
+
+/// Writer that hands the received data to a closure, for the Stream to push into.
+fileprivate class HostOutputWriter: Writer {
+  let receive: (DispatchData) -> ()
+
+  init(_ receive: @escaping (DispatchData) -> ()) {
+    self.receive = receive
+  }
+
+  func write(_ buf: DispatchData, max length: Int) -> AnyPublisher<Int, Error> {
+    receive(buf)
+    return .just(buf.count)
+  }
+}
+
+public class BlinkParallelSSH: NSObject {
+  let device: TermDevice = tty()
+  let currentRunLoop = RunLoop.current
+  var stdout = OutputStream(file: thread_stdout)
+  var stderr = OutputStream(file: thread_stderr)
+  var command: ParallelSSHCommand!
+
+  fileprivate var runs: [HostRun] = []
+  private var nextRun = 0
+  private var running = 0
+  private var prefixWidth = 0
+  private var remoteCommand = ""
+  private var useColor = false
+
+  public func start(_ argc: Int32, argv: [String]) -> Int32 {
+    let hosts: [String]
+    do {
+      command = try ParallelSSHCommand.parse(Array(argv[1...]))
+      hosts = try command.hosts()
+    } catch {
+      let message = ParallelSSHCommand.message(for: error)
+      print(message, to: &stderr)
+      return -1
+    }
+
+    guard !hosts.isEmpty else {
+      print("No hosts to run on.", to: &stderr)
+      return -1
+    }
+
+    runs = hosts.map { HostRun($0) }
+    prefixWidth = hosts.map { $0.count }.max() ?? 0
+    remoteCommand = command.command.joined(separator: " ")
+    useColor = ios_isatty(fileno(thread_stdout)) != 0
+
+    launchNext()
+    if runs.contains(where: { !$0.status.isFinished }) {
+      CFRunLoopRunInMode(.defaultMode, TimeInterval(INT_MAX), false)
+    }
+
+    printSummary()
+
+    let rc: Int32 = runs.allSatisfy {
+      if case .exited(let status) = $0.status { return status == 0 }
+      return false
+    } ? 0 : 1
+
+    // Let streams and connections wind down on their own loops before leaving.
+    runs.forEach { release($0) }
+    RunLoop.current.run(until: Date(timeIntervalSinceNow: 0.5))
+    return rc
+  }
+
+  private func launchNext() {
+    while running < command.parallel && nextRun < runs.count {
+      let run = runs[nextRun]
+      nextRun += 1
+      running += 1
+      launch(run)
+    }
+  }
+
+  private func launch(_ run: HostRun) {
+    run.status = .running
+    run.started = Date()
+
+    if command.timeout > 0 {
+      let timer = Timer(timeInterval: TimeInterval(command.timeout), repeats: false) { [weak self] _ in
+        self?.finish(run, as: .timedOut)
+      }
+      currentRunLoop.add(timer, forMode: .default)
+      run.timer = timer
+    }
+
+    let host: BKSSHHost
+    let hostName: String
+    let config: SSHClientConfig
+    do {
+      var params = [run.alias]
+      if command.verbose > 0 {
+        params.append("-" + String(repeating: "v", count: command.verbose))
+      }
+      let sshCommand = try SSHCommand.parse(params)
+      host = try BKConfig().bkSSHHost(sshCommand.hostAlias, extending: sshCommand.bkSSHHost())
+      hostName = host.hostName ?? sshCommand.hostAlias
+      config = try SSHClientConfigProvider.config(host: host, using: device)
+    } catch {
+      finish(run, as: .failed(CommandError(message: "Configuration error - \(error)")))
+      return
+    }
+
+    // Callbacks from the connection arrive on its own loop, everything else is handed
+    // to the command loop through onCommandLoop.
+    run.cancellable = SSHPool.dial(hostName,
+                                   with: config,
+                                   withControlMaster: host.controlMaster ?? .auto,
+                                   withProxy: { BlinkSSH.executeProxyCommand(command: $0, sockIn: $1, sockOut: $2) })
+      .flatMap { [weak self] conn -> AnyPublisher<(SSH.SSHClient, SSH.Stream), Error> in
+        self?.onCommandLoop {
+          run.connection = conn
+          run.connected = Date()
+        }
+        return conn.requestExec(command: self?.remoteCommand ?? "")
+          .map { (conn, $0) }
+          .eraseToAnyPublisher()
+      }
+      .sink(
+        receiveCompletion: { [weak self] completion in
+          if case .failure(let error) = completion {
+            self?.onCommandLoop { self?.finish(run, as: .failed(error)) }
+          }
+        },
+        receiveValue: { [weak self] (conn, stream) in
+          guard let self = self else {
+            return
+          }
+          let out = HostOutputWriter { buf in self.onCommandLoop { self.received(buf, from: run, isStderr: false) } }
+          let err = HostOutputWriter { buf in self.onCommandLoop { self.received(buf, from: run, isStderr: true) } }
+          stream.handleCompletion = {
+            let status = stream.exitStatus
+            self.onCommandLoop { self.finish(run, as: .exited(status)) }
+          }
+          stream.handleFailure = { error in
+            self.onCommandLoop { self.finish(run, as: .failed(error)) }
+          }
+          stream.connect(stdout: out, stderr: err)
+
+          self.onCommandLoop {
+            // The host may have timed out while the channel was opening.
+            guard !run.status.isFinished else {
+              stream.cancel()
+              return
+            }
+            run.stream = stream
+            SSHPool.register(shellOn: conn)
+          }
+        })
+  }
+
+  private func received(_ buf: DispatchData, from run: HostRun, isStderr: Bool) {
+    guard !run.status.isFinished else {
+      return
+    }
+    if command.inline {
+      run.output.append(contentsOf: buf)
+      return
+    }
+
+    var pending = isStderr ? run.pendingStderr : run.pendingStdout
+    pending.append(contentsOf: buf)
+    while let nl = pending.firstIndex(of: UInt8(ascii: "\n")) {
+      let line = pending[pending.startIndex..<nl]
+      printLine(String(decoding: line, as: UTF8.self), from: run, isStderr: isStderr)
+      pending.removeSubrange(pending.startIndex...nl)
+    }
+    if isStderr {
+      run.pendingStderr = pending
+    } else {
+      run.pendingStdout = pending
+    }
+  }
+
+  private func printLine(_ line: String, from run: HostRun, isStderr: Bool) {
+    let prefix = run.alias.padding(toLength: prefixWidth, withPad: " ", startingAt: 0)
+    let colored = useColor ? "\u{001B}[\(31 + (index(of: run) % 6))m\(prefix)\u{001B}[0m" : prefix
+    if isStderr {
+      print("\(colored) ! \(line)", to: &stderr)
+    } else {
+      print("\(colored) | \(line)", to: &stdout)
+    }
+  }
+
+  private func finish(_ run: HostRun, as status: HostRun.Status) {
+    guard !run.status.isFinished else {
+      return
+    }
+    // A host that never started cannot be running.
+    if run.started != nil {
+      running -= 1
+    }
+    run.status = status
+    run.finished = Date()
+    run.timer?.invalidate()
+    run.timer = nil
+
+    if command.inline {
+      printBlock(for: run)
+    } else {
+      if !run.pendingStdout.isEmpty {
+        printLine(String(decoding: run.pendingStdout, as: UTF8.self), from: run, isStderr: false)
+      }
+      if !run.pendingStderr.isEmpty {
+        printLine(String(decoding: run.pendingStderr, as: UTF8.self), from: run, isStderr: true)
+      }
+      if case .failed(let error) = status {
+        printLine("\(error)", from: run, isStderr: true)
+      } else if case .timedOut = status {
+        printLine("Timed out after \(command.timeout)s", from: run, isStderr: true)
+      }
+    }
+    run.pendingStdout = Data()
+    run.pendingStderr = Data()
+    release(run)
+
+    launchNext()
+    if running == 0 && nextRun == runs.count {
+      stop()
+    }
+  }
+
+  private func release(_ run: HostRun) {
+    if let conn = run.connection, run.stream != nil {
+      SSHPool.deregister(shellOn: conn)
+    }
+    run.stream?.cancel()
+    run.stream = nil
+    run.cancellable = nil
+    run.connection = nil
+  }
+
+  private func printBlock(for run: HostRun) {
+    print("[\(index(of: run) + 1)] \(run.alias) \(describe(run.status))", to: &stdout)
+    if !run.output.isEmpty {
+      let text = String(decoding: run.output, as: UTF8.self)
+      print(text, terminator: text.hasSuffix("\n") ? "" : "\n", to: &stdout)
+    }
+    if case .failed(let error) = run.status {
+      print("\(error)", to: &stderr)
+    }
+  }
+
+  private func printSummary() {
+    func seconds(_ from: Date?, _ to: Date?) -> String {
+      guard let from = from, let to = to else {
+        return "-"
+      }
+      return String(format: "%.2fs", to.timeIntervalSince(from))
+    }
+
+    let width = max(prefixWidth, 4)
+    let header = [
+      "HOST".padding(toLength: width, withPad: " ", startingAt: 0),
+      "STATUS".padding(toLength: 10, withPad: " ", startingAt: 0),
+      "CONNECT".leftPadding(toLength: 9),
+      "TOTAL".leftPadding(toLength: 9)
+    ].joined(separator: "  ")
+    print("", to: &stdout)
+    print(header, to: &stdout)
+
+    for run in runs {
+      let row = [
+        run.alias.padding(toLength: width, withPad: " ", startingAt: 0),
+        describe(run.status).padding(toLength: 10, withPad: " ", startingAt: 0),
+        seconds(run.started, run.connected).leftPadding(toLength: 9),
+        seconds(run.started, run.finished).leftPadding(toLength: 9)
+      ].joined(separator: "  ")
+      print(row, to: &stdout)
+    }
+
+    let ok = runs.filter {
+      if case .exited(let status) = $0.status { return status == 0 }
+      return false
+    }.count
+    print("\(ok)/\(runs.count) hosts succeeded.", to: &stdout)
+  }
+
+  private func describe(_ status: HostRun.Status) -> String {
+    switch status {
+    case .pending:              return "pending"
+    case .running:              return "running"
+    case .exited(let status?):  return status == 0 ? "ok" : "exit \(status)"
+    case .exited(nil):          return "exit ?"
+    case .failed:               return "failed"
+    case .timedOut:             return "timeout"
+    case .cancelled:            return "cancelled"
+    }
+  }
+
+  private func index(of run: HostRun) -> Int {
+    runs.firstIndex { $0 === run } ?? 0
+  }
+
+  private func onCommandLoop(_ block: @escaping () -> ()) {
+    currentRunLoop.perform(block)
+    CFRunLoopWakeUp(currentRunLoop.getCFRunLoop())
+  }
+
+  @objc func sigwinch() { }
+
+  @objc func kill() {
+    onCommandLoop {
+      print("\r\nOperation cancelled", to: &self.stderr)
+      // Mark the pending ones first, so finishing the running ones does not launch them.
+      self.nextRun = self.runs.count
+      self.runs.filter { !$0.status.isFinished }.forEach { self.finish($0, as: .cancelled) }
+      self.stop()
+    }
+  }
+
+  func stop() {
+    CFRunLoopStop(self.currentRunLoop.getCFRunLoop())
+  }
+}
+
+fileprivate extension String {
+  func leftPadding(toLength length: Int) -> String {
+    count >= length ? self : String(repeating: " ", count: length - count) + self
+  }
+}
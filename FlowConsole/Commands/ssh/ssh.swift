@@ -71,6 +71,13 @@ public func fc_ssh_main(argc: Int32, argv: Argv) -> Int32 {
   var outStream: DispatchOutputStream?
   var inStream: DispatchInputStream?
   var errStream: DispatchOutputStream?
+
+  // Auto reconnect. The session is re-established with the same resolved configuration.
+  private var reconnector: SSHSessionReconnector?
+  private var redial: (() -> SSHConnection)?
+  private var startSession: ((SSH.SSHClient) -> SSHConnection)?
+  private var reconnectCancellable: AnyCancellable?
+  private var reconnecting = false
   
   init(mcp: MCPSession) {
     _mcp = mcp;
@@ -152,18 +159,28 @@ public func fc_ssh_main(argc: Int32, argv: Argv) -> Int32 {
       // Disable CM on -W, this way we attach it to the main connection only
       let useControlMaster = (cmd.stdioHostAndPort != nil) ? .no : (host.controlMaster ?? .no)
       
-      connect = SSHPool.dial(
-        hostName,
-        with: config,
-        withControlMaster: useControlMaster,
-        withProxy: { [weak self] in
-          guard let self = self
-          else {
-            return
-          }
-          self._mcp.setActiveSession()
-          Self.executeProxyCommand(command: $0, sockIn: $1, sockOut: $2)
-        })
+      let dial = { () -> SSHConnection in
+        SSHPool.dial(
+          hostName,
+          with: config,
+          withControlMaster: useControlMaster,
+          withProxy: { [weak self] in
+            guard let self = self
+            else {
+              return
+            }
+            self._mcp.setActiveSession()
+            Self.executeProxyCommand(command: $0, sockIn: $1, sockOut: $2)
+          })
+      }
+      connect = dial()
+
+      if cmd.autoReconnect && cmd.startsSession {
+        redial = dial
+        reconnector = SSHSessionReconnector(
+          localAddress: { [weak self] in self?.connection?.localAddressIP() },
+          reconnect: { [weak self] in self?.onCommandLoop { self?.reestablishSession() } })
+      }
     }
     
     var environment: [String: String] = .init(minimumCapacity: host.sendEnv?.count ?? 0)
@@ -183,10 +200,7 @@ public func fc_ssh_main(argc: Int32, argv: Argv) -> Int32 {
         print(banner, to: &self.stdout)
       }
       
-      conn.handleSessionException = { error in
-        print("Exception received \(error)", to: &self.stderr)
-        self.kill()
-      }
+      self.observeExceptions(on: conn)
       
       if cmd.startsSession {
         if let addr = conn.clientAddressIP() {
@@ -206,9 +220,22 @@ public func fc_ssh_main(argc: Int32, argv: Argv) -> Int32 {
           }
         }
 
+        // Attaching needs a terminal even though it runs a command.
+        let sessionCommand = cmd.attachCommand ?? host.remoteCommand
+        let requestTTY: TTYBool = cmd.attachCommand != nil ? .force : (host.requestTty ?? .auto)
+        if self.reconnector != nil {
+          self.startSession = { [unowned self] conn in
+            self.startInteractiveSessions(conn,
+                                          command: sessionCommand,
+                                          requestTTY: requestTTY,
+                                          withEnvVars: environment,
+                                          sendAgent: sendAgent)
+          }
+        }
+
         return self.startInteractiveSessions(conn,
-                                             command: host.remoteCommand,
-                                             requestTTY: host.requestTty ?? .auto,
+                                             command: sessionCommand,
+                                             requestTTY: requestTTY,
                                              withEnvVars: environment,
                                              sendAgent: sendAgent)
       }
@@ -219,7 +246,7 @@ public func fc_ssh_main(argc: Int32, argv: Argv) -> Int32 {
     // ExitOnForwardFailure only closes if the bind for -L/-R fails
     // TODO Note, we are not merging localForward on host and cmd yet. There can also be -o.
     .flatMap { self.startForwardTunnels( (host.localForward ?? []), on: $0, exitOnFailure: host.exitOnForwardFailure ?? false) }
-    .flatMap { self.startRemoteTunnels( (host.remoteForward ?? []), on: $0, exitOnFailure: host.exitOnForwardFailure ?? false) }
+    .flatMap { self.startRemoteTunnels( (host.remoteForward ?? []), on: $0, policy: host.remoteForwardPolicy, exitOnFailure: host.exitOnForwardFailure ?? false) }
     .flatMap { self.startDynamicForwarding( (host.dynamicForward ?? []), on: $0, exitOnFailure: host.exitOnForwardFailure ?? false) }
     .sink(receiveCompletion: { completion in
       switch completion {
@@ -237,16 +264,15 @@ public func fc_ssh_main(argc: Int32, argv: Argv) -> Int32 {
       }
     })
 
+    reconnector?.start()
     awaitRunLoop()
+    reconnector?.stop()
+    reconnector = nil
+    reconnectCancellable = nil
+    redial = nil
+    startSession = nil
 
-    stream?.cancel()
-    outStream?.close()
-    inStream?.close()
-    errStream?.close()
-    stream = nil
-    outStream = nil
-    inStream = nil
-    errStream = nil
+    closeSession()
     
     if let conn = self.connection, cmd.blocks {
       if cmd.startsSession { SSHPool.deregister(shellOn: conn) }
@@ -315,15 +341,27 @@ public func fc_ssh_main(argc: Int32, argv: Argv) -> Int32 {
       let ins = DispatchInputStream(stream: dup(self.instream))
       let errs = DispatchOutputStream(stream: dup(self.errstream))
 
-      s.handleCompletion = { [weak self] in
+      s.handleCompletion = { [weak self, unowned s] in
+        guard let self = self else {
+          return
+        }
+        // A shell that exits sends its status. Without it, the connection went away.
+        if self.reconnector != nil && s.exitStatus == nil && !conn.isConnected {
+          self.onCommandLoop { self.reestablishSession() }
+          return
+        }
         // Once finished, exit.
-        self?.kill()
+        self.kill()
         return
       }
       s.handleFailure = { [weak self] error in
         guard let self = self else {
           return
         }
+        if self.reconnector != nil {
+          self.onCommandLoop { self.reestablishSession() }
+          return
+        }
         self.exitCode = -1
         print("Interactive Shell error. \(error)", to: &self.stderr)
         self.kill()
@@ -406,6 +444,7 @@ public func fc_ssh_main(argc: Int32, argv: Argv) -> Int32 {
 
   private func startRemoteTunnels(_ tunnels: [PortForwardInfo],
                                   on conn: SSH.SSHClient, 
+                                  policy: SSHForwardPolicy,
                                   exitOnFailure: Bool) -> SSHConnection {
     let tunnels = tunnels.filter { !SSHPool.contains(remoteForward: $0, on: conn) }
     if tunnels.isEmpty {
@@ -418,6 +457,7 @@ public func fc_ssh_main(argc: Int32, argv: Argv) -> Int32 {
         client = SSHPortForwardClient(forward: tunnel.bindAddress,
                                       onPort: tunnel.remotePort,
                                       toRemotePort: tunnel.localPort,
+                                      policy: policy,
                                       using: conn)
         
         
@@ -489,6 +529,92 @@ public func fc_ssh_main(argc: Int32, argv: Argv) -> Int32 {
     return true
   }
 
+  private func observeExceptions(on conn: SSH.SSHClient) {
+    conn.handleSessionException = { [weak self] error in
+      guard let self = self else {
+        return
+      }
+      if self.reconnector != nil {
+        self.onCommandLoop { self.reestablishSession() }
+        return
+      }
+      print("Exception received \(error)", to: &self.stderr)
+      self.kill()
+    }
+  }
+
+  private func closeSession() {
+    stream?.cancel()
+    outStream?.close()
+    inStream?.close()
+    errStream?.close()
+    stream = nil
+    outStream = nil
+    inStream = nil
+    errStream = nil
+  }
+
+  // Dial again with the configuration resolved at start, which also goes through the
+  // remembered auth method, and open the session at the current size of the terminal.
+  private func reestablishSession() {
+    guard !reconnecting,
+          let redial = redial,
+          let startSession = startSession,
+          let reconnector = reconnector
+    else {
+      return
+    }
+    reconnecting = true
+    let started = Date()
+
+    if reconnector.attempts == 0 {
+      // Whatever the remote wrote after the connection was lost is not coming back.
+      print("\r\n[Connection lost, output may be missing from here. Reconnecting...]\r", to: &stderr)
+    }
+
+    closeSession()
+    if let conn = connection {
+      SSHPool.deregister(shellOn: conn)
+      SSHPool.remove(connection: conn)
+      connection = nil
+    }
+
+    reconnectCancellable = redial()
+      .flatMap { conn -> SSHConnection in
+        self.connection = conn
+        self.observeExceptions(on: conn)
+        return startSession(conn)
+      }
+      .sink(receiveCompletion: { completion in
+        guard case .failure(let error) = completion else {
+          return
+        }
+        self.onCommandLoop {
+          self.reconnecting = false
+          guard let delay = reconnector.nextDelay() else {
+            print("[Could not reconnect. \(error)]\r", to: &self.stderr)
+            self.exitCode = -1
+            self.kill()
+            return
+          }
+          print("[Reconnect failed, retrying in \(delay)s. \(error)]\r", to: &self.stderr)
+          let retry = Timer(timeInterval: delay, repeats: false) { [weak self] _ in self?.reestablishSession() }
+          self.currentRunLoop.add(retry, forMode: .default)
+        }
+      }, receiveValue: { _ in
+        self.onCommandLoop {
+          self.reconnecting = false
+          reconnector.reset()
+          print(String(format: "[Reconnected in %.2fs]\r", Date().timeIntervalSince(started)), to: &self.stderr)
+        }
+      })
+  }
+
+  private func onCommandLoop(_ block: @escaping () -> ()) {
+    currentRunLoop.perform(block)
+    CFRunLoopWakeUp(currentRunLoop.getCFRunLoop())
+  }
+
   @objc public func sigwinch() {
     var c: AnyCancellable?
     c = stream?
@@ -506,6 +632,7 @@ public func fc_ssh_main(argc: Int32, argv: Argv) -> Int32 {
     // Trying to do it at the runloop has the issue that flows may continue running.
     print("Kill received")
     connectionCancellable = nil
+    reconnectCancellable = nil
     
     awake()
   }
@@ -31,6 +31,7 @@ import Foundation
 import Combine
 import ios_system
 import FlowConsoleConfig
+import SSH
 
 private let _completionQueue = DispatchQueue(label: "completion.queue")
 private var _showReplHints: Bool = {
@@ -154,6 +155,7 @@ struct Complete {
       "pbpaste": "Paste from the pasteboard.",
       "ping": "Send ICMP ECHO_REQUEST packets to network hosts.", // fish
       "printenv": "Print out the environment.", // fish
+      "pssh": "Run a command on multiple hosts in parallel. 🐙",
       "pwd": "Return working directory name.", // fish
       "readlink": "Display file status.", // fish
 //  //    @"rlogin": @"", // TODO: REMOVE
@@ -378,21 +380,7 @@ struct Complete {
   }
   
   private static func _allKnownHosts() -> [String] {
-    guard let hostsFile = try? String(contentsOfFile: FlowConsolePaths.knownHostsFile(), encoding: .utf8)
-    else {
-      return []
-    }
-    
-    var hosts = Set<String>()
-    
-    hostsFile.enumerateLines { (line, finish) in
-      if let host = line.split(separator: " ", maxSplits: 1, omittingEmptySubsequences: true).first,
-        !host.isEmpty {
-        hosts.insert(String(host))
-      }
-    }
-    
-    return Array(hosts).sorted()
+    SSHKnownHosts.store(at: FlowConsolePaths.knownHostsFile()).hostNames()
   }
   
   private static func _allPaths(prefix: String, skipFiles: Bool) -> [String] {
@@ -30,7 +30,6 @@
 import Foundation
 
 import SSH
-import SSHConfig
 
 
 // Responsible to intermediate between the Blink Configuration formats and the
@@ -39,19 +38,18 @@ import SSHConfig
 public struct BKConfig {
   let defaultKeyNames = ["id_dsa", "id_rsa", "id_ecdsa", "id_ecdsa_sk", "id_ed25519"]
 
-  private let _allHosts: [BKHosts]
   private let _allIdentities: [BKPubKey]
-  private let bkSSHConfig: SSHConfig
+  private let bkSSHConfig: BKSSHConfigCache
 
-  // TODO Config files
+  // The parsed configuration is shared between instances and only parsed
+  // again when a file in the Include chain changes.
   public init() throws {
-    _allHosts = BKHosts.allHosts()
     _allIdentities = BKPubKey.all()
-    bkSSHConfig = try SSHConfig.parse(url: FlowConsolePaths.blinkGlobalSSHConfigFileURL())
+    bkSSHConfig = BKSSHConfigCache.shared
   }
 
   private func _host(_ host: String) -> BKHosts? {
-    return _allHosts.first(where: { $0.host == host })
+    return bkSSHConfig.host(host)
   }
 
   // Return the stored configuration given the host.
@@ -75,7 +73,8 @@ public struct BKConfig {
 
   public func privateKey(forIdentifier identifier: String) -> (String, String)? {
     guard
-      let privateKey = _allIdentities.first(where: { $0.id == identifier })?.loadPrivateKey()
+      let card = _allIdentities.first(where: { $0.id == identifier }),
+      let privateKey = BKIdentityStore.shared.privateKey(for: card)
     else {
       return nil
     }
@@ -85,7 +84,7 @@ public struct BKConfig {
 
   public func signer(forIdentity identity: String) -> (Signer, String)? {
     guard
-      let signer = _allIdentities.signerWithID(identity)
+      let signer = BKIdentityStore.shared.signer(forIdentity: identity, in: _allIdentities)
     else {
       return nil
     }
@@ -115,7 +114,7 @@ public struct BKConfig {
         defaultKeyNames.contains($0.id)
       }
       .map {
-        ($0.loadPrivateKey(), $0.id)
+        (BKIdentityStore.shared.privateKey(for: $0), $0.id)
       }
       .compactMap {
         guard
@@ -0,0 +1,211 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+import Foundation
+
+import SSH
+
+
+/**
+ Signers for the stored identities, reading and parsing secrets only when needed.
+
+ Keychain keys are handed out as signers built from the public key on the card, which only
+ read and parse the private key the first time they have to sign. Parsed signers stay in
+ memory, and are dropped after `idleTimeout` without use. Secrets are read with a single
+ keychain query for all the items, as the query costs about the same as reading one.
+ */
+@objc public final class BKIdentityStore: NSObject {
+  @objc public static let shared = BKIdentityStore()
+
+  public var idleTimeout: TimeInterval = 5 * 60
+
+  private struct Cached {
+    let signer: Signer
+    var lastUsed: Date
+  }
+
+  private let lock = NSLock()
+  private var signers: [String: Cached] = [:]
+  private var items: [String: String]? = nil
+  private var itemsLoaded = Date.distantPast
+  private var sweep: DispatchWorkItem? = nil
+
+  /// Signer for the identity. Keychain keys do not touch the keychain until they sign.
+  public func signer(forIdentity id: String, in identities: [BKPubKey]) -> Signer? {
+    guard let card = identities.first(where: { $0.id == id }) else {
+      return nil
+    }
+
+    // Certificates live in the keychain too, so those are loaded as usual.
+    if card.storageType == BKPubKeyStorageTypeKeyChain,
+       card.certType == nil,
+       let signer = BKLazySigner(card, store: self) {
+      return signer
+    }
+
+    return try? loadSigner(for: card)
+  }
+
+  /// Parsed signer for the card, from memory if it has been used recently.
+  func loadSigner(for card: BKPubKey) throws -> Signer {
+    lock.lock()
+    defer { lock.unlock() }
+
+    let now = Date()
+    if var cached = signers[card.tag] {
+      cached.lastUsed = now
+      signers[card.tag] = cached
+      return cached.signer
+    }
+
+    let signer = try makeSigner(for: card)
+    // Passkeys and security keys prompt on the view of each connection, so they are not shared.
+    if card.storageType == BKPubKeyStorageTypeKeyChain || card.storageType == BKPubKeyStorageTypeSecureEnclave {
+      signers[card.tag] = Cached(signer: signer, lastUsed: now)
+      scheduleSweep()
+    }
+    return signer
+  }
+
+  public func privateKey(for card: BKPubKey) -> String? {
+    lock.lock()
+    defer { lock.unlock() }
+    return _privateKey(for: card)
+  }
+
+  /// Forget everything in memory. Called when keys change.
+  @objc public func invalidate() {
+    lock.lock()
+    defer { lock.unlock() }
+    signers = [:]
+    items = nil
+  }
+
+  private func makeSigner(for card: BKPubKey) throws -> Signer {
+    if card.storageType == BKPubKeyStorageTypeKeyChain {
+      guard
+        let privateKey = _privateKey(for: card),
+        let privateKeyBlob = SSHKey.sanitize(key: privateKey).data(using: .utf8)
+      else {
+        throw SSHKeyError.general(title: "Could not read private key \(card.id).")
+      }
+
+      let certBlob = (keychainItems().flatMap { card.certificate(fromKeychainItems: $0) } ?? card.loadCertificate())?
+        .data(using: .utf8)
+      return try SSHKey(fromFileBlob: privateKeyBlob, withPublicFileCertBlob: certBlob)
+    }
+
+    if card.storageType == BKPubKeyStorageTypeSecureEnclave {
+      // TODO: Certs fro SEKey?
+      if let key = SEKey(tagged: card.tag) {
+        return key
+      }
+    }
+
+    if card.storageType == BKPubKeyStorageTypePlatformKey,
+       let rawAttestationObject = card.rawAttestationObject,
+       let rpId = card.rpId {
+      return try WebAuthnKey(rpId:rpId, rawAttestationObject: rawAttestationObject)
+    }
+
+    if card.storageType == BKPubKeyStorageTypeSecurityKey,
+       let rawAttestationObject = card.rawAttestationObject,
+       let rpId = card.rpId {
+      return try SKWebAuthnKey(rpId:rpId, rawAttestationObject: rawAttestationObject)
+    }
+
+    throw SSHKeyError.general(title: "Could not load key \(card.id).")
+  }
+
+  private func _privateKey(for card: BKPubKey) -> String? {
+    // Keys added after the items were read are not on the batch.
+    keychainItems().flatMap { card.privateKey(fromKeychainItems: $0) } ?? card.loadPrivateKey()
+  }
+
+  private func keychainItems() -> [String: String]? {
+    if items == nil {
+      items = BKPubKey.loadKeychainItems()
+      itemsLoaded = Date()
+      scheduleSweep()
+    }
+    return items
+  }
+
+  private func scheduleSweep() {
+    guard sweep == nil else {
+      return
+    }
+    let work = DispatchWorkItem { [weak self] in self?.sweepIdle() }
+    sweep = work
+    DispatchQueue.global(qos: .utility).asyncAfter(deadline: .now() + idleTimeout, execute: work)
+  }
+
+  private func sweepIdle() {
+    lock.lock()
+    defer { lock.unlock() }
+
+    sweep = nil
+    let now = Date()
+    signers = signers.filter { now.timeIntervalSince($0.value.lastUsed) < idleTimeout }
+    if now.timeIntervalSince(itemsLoaded) >= idleTimeout {
+      items = nil
+    }
+    if !signers.isEmpty || items != nil {
+      scheduleSweep()
+    }
+  }
+}
+
+/// Keychain key that only loads the private part when it has to sign.
+final class BKLazySigner: Signer {
+  let card: BKPubKey
+  let store: BKIdentityStore
+  let key: SSHKey
+  let comment: String?
+
+  init?(_ card: BKPubKey, store: BKIdentityStore) {
+    let parts = card.publicKey.split(separator: " ", maxSplits: 2)
+    guard parts.count >= 2,
+          let blob = Data(base64Encoded: String(parts[1])),
+          let key = try? SSHKey(fromPublicBlob: blob) else {
+      return nil
+    }
+    self.card = card
+    self.store = store
+    self.key = key
+    self.comment = parts.count > 2 ? String(parts[2]) : nil
+  }
+
+  var publicKey: PublicKey { key }
+  var sshKeyType: SSHKeyType { key.sshKeyType }
+
+  func sign(_ message: Data, algorithm: String?) throws -> Data {
+    try store.loadSigner(for: card).sign(message, algorithm: algorithm)
+  }
+}
@@ -52,6 +52,11 @@ typedef enum: NSUInteger {
 
 - (nullable NSString *)loadPrivateKey;
 - (nullable NSString *)loadCertificate;
+// Same as above, from the items returned by loadKeychainItems.
+- (nullable NSString *)privateKeyFromKeychainItems:(nonnull NSDictionary<NSString *, NSString *> *)items;
+- (nullable NSString *)certificateFromKeychainItems:(nonnull NSDictionary<NSString *, NSString *> *)items;
+// All the stored keys and certificates in a single keychain query.
++ (nullable NSDictionary<NSString *, NSString *> *)loadKeychainItems;
 
 + (void)initialize;
 + (nullable instancetype)withID:(nullable NSString *)ID;
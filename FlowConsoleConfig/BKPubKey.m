@@ -267,6 +267,7 @@ static UICKeyChainStore *__get_keychain() {
 - (void)storePrivateKeyInKeychain:(NSString *) privateKey {
   UICKeyChainStore *keychain = __get_keychain();
   [keychain setString:privateKey forKey:[self _privateKeyKeychainRef]];
+  [BKIdentityStore.shared invalidate];
 }
 
 - (void)storeCertificateInKeychain:(nullable NSString *) certificate {
@@ -279,6 +280,7 @@ static UICKeyChainStore *__get_keychain() {
     [keychain removeItemForKey:certRef];
     _certType = nil;
   }
+  [BKIdentityStore.shared invalidate];
 }
 
 - (nullable NSString *)privateKey {
@@ -309,6 +311,44 @@ static UICKeyChainStore *__get_keychain() {
   }
 }
 
++ (nullable NSDictionary<NSString *, NSString *> *)loadKeychainItems
+{
+  NSArray *items = [__get_keychain() allItems];
+  if (!items) {
+    return nil;
+  }
+
+  NSMutableDictionary<NSString *, NSString *> *result = [[NSMutableDictionary alloc] initWithCapacity:items.count];
+  for (NSDictionary *item in items) {
+    id key = item[@"key"];
+    id value = item[@"value"];
+    if ([key isKindOfClass:NSString.class] && [value isKindOfClass:NSString.class]) {
+      result[key] = value;
+    }
+  }
+  return result;
+}
+
+- (nullable NSString *)privateKeyFromKeychainItems:(NSDictionary<NSString *, NSString *> *)items
+{
+  if (_privateKeyRef) {
+    return items[_privateKeyRef];
+  }
+
+  switch (_storageType) {
+    case BKPubKeyStorageTypeiCloudKeyChain:
+    case BKPubKeyStorageTypeKeyChain:
+      return items[[self _privateKeyKeychainRef]];
+    default:
+      return nil;
+  }
+}
+
+- (nullable NSString *)certificateFromKeychainItems:(NSDictionary<NSString *, NSString *> *)items
+{
+  return items[[self _certificateKeychainRef]];
+}
+
 - (NSString *)_certificateKeychainRef {
   return [NSString stringWithFormat: @"%@-cert.pub", _tag];
 }
@@ -343,6 +383,7 @@ static UICKeyChainStore *__get_keychain() {
   }
   [__identities removeObject:self];
   [BKPubKey saveIDS];
+  [BKIdentityStore.shared invalidate];
 }
 
 // UIActivityItemSource methods
@@ -171,47 +171,6 @@ extension Collection where Element == BKPubKey {
       return nil
     }
 
-    if card.storageType == BKPubKeyStorageTypeKeyChain {
-      guard
-        let privateKey = card.loadPrivateKey(),
-        let privateKeyBlob = SSHKey.sanitize(key: privateKey).data(using: .utf8)
-      else {
-        return nil
-      }
-      
-      let certBlob = card.loadCertificate()?.data(using: .utf8)
-      return try? SSHKey(fromFileBlob: privateKeyBlob, withPublicFileCertBlob: certBlob)
-    }
-    
-    if card.storageType == BKPubKeyStorageTypeSecureEnclave {
-      // TODO: Certs fro SEKey?
-      return SEKey(tagged: card.tag)
-    }
-    
-    if card.storageType == BKPubKeyStorageTypePlatformKey {
-      guard
-        let rawAttestationObject = card.rawAttestationObject,
-        let rpId = card.rpId
-      else {
-        return nil
-      }
-
-      return try? WebAuthnKey(rpId:rpId, rawAttestationObject: rawAttestationObject)
-    }
-    
-    if card.storageType == BKPubKeyStorageTypeSecurityKey {
-      guard
-        let rawAttestationObject = card.rawAttestationObject,
-        let rpId = card.rpId
-      else {
-        return nil
-      }
-
-      return try? SKWebAuthnKey(rpId:rpId, rawAttestationObject: rawAttestationObject)
-    }
-    
-    return nil
+    return try? BKIdentityStore.shared.loadSigner(for: card)
   }
-  
-
 }
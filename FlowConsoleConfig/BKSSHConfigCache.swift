@@ -0,0 +1,237 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+import Foundation
+
+import SSHConfig
+
+
+// Keeps the parsed ssh_config chain across BKConfig instances, so connections do
+// not parse the files again unless one of them changed. Resolution per alias is
+// memoized on top of it.
+final class BKSSHConfigCache {
+  static let shared = BKSSHConfigCache(root: FlowConsolePaths.blinkGlobalSSHConfigFileURL())
+
+  // Same limit as OpenSSH (READCONF_MAX_DEPTH).
+  static let maxIncludeDepth = 16
+
+  struct Stamp: Equatable {
+    let path: String
+    let exists: Bool
+    let inode: UInt64
+    let size: Int64
+    let mtime: timespec
+
+    init(_ path: String) {
+      self.path = path
+      var st = stat()
+      if stat(path, &st) == 0 {
+        exists = true
+        inode = UInt64(st.st_ino)
+        size = Int64(st.st_size)
+        mtime = st.st_mtimespec
+      } else {
+        exists = false
+        inode = 0
+        size = 0
+        mtime = timespec()
+      }
+    }
+
+    static func == (lhs: Stamp, rhs: Stamp) -> Bool {
+      lhs.path == rhs.path && lhs.exists == rhs.exists && lhs.inode == rhs.inode && lhs.size == rhs.size &&
+        lhs.mtime.tv_sec == rhs.mtime.tv_sec && lhs.mtime.tv_nsec == rhs.mtime.tv_nsec
+    }
+  }
+
+  private let root: URL?
+  private let lock = NSLock()
+
+  // Files in the Include chain, plus the directories of glob Includes so new
+  // matches are noticed.
+  private var stamps: [Stamp] = []
+  private var contentHash: Int? = nil
+  private var config: SSHConfig? = nil
+  // Match exec and friends depend on the moment they are evaluated, so a chain
+  // that uses them is resolved every time.
+  private var isMemoizable = true
+  private var resolved: [String: [String: Any]] = [:]
+
+  private var hostsStamp: Stamp? = nil
+  private var hostsIndex: [String: BKHosts] = [:]
+
+  init(root: URL?) {
+    self.root = root
+  }
+
+  func resolve(alias: String) throws -> [String: Any] {
+    lock.lock()
+    defer { lock.unlock() }
+
+    let config = try validConfig()
+    if isMemoizable, let cfg = resolved[alias] {
+      return cfg
+    }
+    let cfg = try config.resolve(alias: alias)
+    if isMemoizable {
+      resolved[alias] = cfg
+    }
+    return cfg
+  }
+
+  // Hosts are saved to their file on every change, so its stamp tells when to rebuild.
+  func host(_ alias: String) -> BKHosts? {
+    lock.lock()
+    defer { lock.unlock() }
+
+    let stamp = Stamp(FlowConsolePaths.blinkHostsFile())
+    if stamp != hostsStamp || hostsIndex.isEmpty {
+      var index: [String: BKHosts] = [:]
+      for h in BKHosts.allHosts() ?? [] {
+        if let alias = h.host as String?, index[alias] == nil {
+          index[alias] = h
+        }
+      }
+      hostsIndex = index
+      hostsStamp = stamp
+    }
+    return hostsIndex[alias]
+  }
+
+  func invalidate() {
+    lock.lock()
+    defer { lock.unlock() }
+    stamps = []
+    contentHash = nil
+    config = nil
+    resolved = [:]
+    hostsStamp = nil
+  }
+
+  private func validConfig() throws -> SSHConfig {
+    if let config = config,
+       stamps.allSatisfy({ Stamp($0.path) == $0 }) {
+      return config
+    }
+
+    guard let root = root else {
+      throw BKSSHConfigCacheError.noConfiguration
+    }
+
+    // Something changed. If only the timestamps did (files are rewritten with the
+    // same content on every save), keep the parsed configuration.
+    let chain = Self.includeChain(from: root)
+    if let config = config, chain.contentHash == contentHash {
+      stamps = chain.stamps
+      return config
+    }
+
+    let newConfig = try SSHConfig.parse(url: root)
+    config = newConfig
+    stamps = chain.stamps
+    contentHash = chain.contentHash
+    isMemoizable = chain.isMemoizable
+    resolved = [:]
+    return newConfig
+  }
+
+  struct IncludeChain {
+    var stamps: [Stamp] = []
+    var contentHash: Int = 0
+    var isMemoizable = true
+  }
+
+  static func includeChain(from root: URL) -> IncludeChain {
+    var chain = IncludeChain()
+    var hasher = Hasher()
+    var visited = Set<String>()
+
+    func visit(_ path: String, depth: Int) {
+      guard depth <= maxIncludeDepth, !visited.contains(path) else {
+        return
+      }
+      visited.insert(path)
+
+      let stamp = Stamp(path)
+      chain.stamps.append(stamp)
+      hasher.combine(path)
+      guard stamp.exists,
+            let data = FileManager.default.contents(atPath: path) else {
+        return
+      }
+      hasher.combine(data)
+
+      let base = (path as NSString).deletingLastPathComponent
+      for line in String(decoding: data, as: UTF8.self).split(whereSeparator: \.isNewline) {
+        let words = line.split(whereSeparator: { $0 == " " || $0 == "\t" || $0 == "=" }).map(String.init)
+        guard let keyword = words.first?.lowercased() else {
+          continue
+        }
+        if keyword == "match",
+           words.dropFirst().contains(where: { ["exec", "localuser", "localnetwork"].contains($0.lowercased()) }) {
+          chain.isMemoizable = false
+        }
+        guard keyword == "include" else {
+          continue
+        }
+        for pattern in words.dropFirst() {
+          var expanded = (pattern as NSString).expandingTildeInPath
+          if !expanded.hasPrefix("/") {
+            expanded = (base as NSString).appendingPathComponent(expanded)
+          }
+          if expanded.contains(where: { "*?[".contains($0) }) {
+            chain.stamps.append(Stamp((expanded as NSString).deletingLastPathComponent))
+            globPaths(expanded).forEach { visit($0, depth: depth + 1) }
+          } else {
+            visit((expanded as NSString).standardizingPath, depth: depth + 1)
+          }
+        }
+      }
+    }
+
+    visit(root.path, depth: 0)
+    chain.contentHash = hasher.finalize()
+    return chain
+  }
+
+  private static func globPaths(_ pattern: String) -> [String] {
+    var gt = glob_t()
+    defer { globfree(&gt) }
+    guard glob(pattern, 0, nil, &gt) == 0 else {
+      return []
+    }
+    return (0..<Int(gt.gl_pathc)).compactMap { i in
+      gt.gl_pathv[i].map { String(cString: $0) }
+    }.sorted()
+  }
+}
+
+enum BKSSHConfigCacheError: Error {
+  case noConfiguration
+}
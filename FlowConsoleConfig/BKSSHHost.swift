@@ -68,6 +68,10 @@ public struct BKSSHHost {
   public var rekeyLimit: BytesNumber?
   public var remoteCommand: String?
   public var remoteForward: [PortForwardInfo]?
+  // Not in OpenSSH. Local connections for the streams of a RemoteForward, see SSHForwardPolicy.
+  public var remoteForwardMaxConnections: UInt?
+  public var remoteForwardMaxQueued: UInt?
+  public var remoteForwardPrewarm: UInt?
   public var requestTty: TTYBool?
   public var sendEnv: [String]?
   public var strictHostKeyChecking: Bool?
@@ -133,6 +137,9 @@ public struct BKSSHHost {
         case "rekeylimit":                    self.rekeyLimit                   = try castValue(value)
         case "remotecommand":                 self.remoteCommand                = try castValue(value)
         case "remoteforward":                 self.remoteForward                = try castList(value)
+        case "remoteforwardmaxconnections":   self.remoteForwardMaxConnections  = try castValue(value)
+        case "remoteforwardmaxqueued":        self.remoteForwardMaxQueued       = try castValue(value)
+        case "remoteforwardprewarm":          self.remoteForwardPrewarm         = try castValue(value)
         case "requesttty":                    self.requestTty                   = try castValue(value)
         case "sendenv":                       self.sendEnv                      = try castList(value)
         case "stricthostkeychecking":         self.strictHostKeyChecking        = try castValue(value)
@@ -154,6 +161,20 @@ public struct BKSSHHost {
     return try BKSSHHost(content: configDict)
   }
 
+  public var remoteForwardPolicy: SSHForwardPolicy {
+    var policy = SSHForwardPolicy()
+    if let max = remoteForwardMaxConnections {
+      policy.maxConnections = Int(max)
+    }
+    if let queued = remoteForwardMaxQueued {
+      policy.maxQueued = Int(queued)
+    }
+    if let prewarm = remoteForwardPrewarm {
+      policy.prewarm = Int(prewarm)
+    }
+    return policy
+  }
+
   public func sshClientConfig(authMethods: [SSH.AuthMethod]?,
                               verifyHostCallback: SSHClientConfig.RequestVerifyHostCallback? = nil,
                               agent: SSHAgent? = nil,
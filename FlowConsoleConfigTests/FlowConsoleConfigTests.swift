@@ -28,6 +28,7 @@
 
 
 import XCTest
+import SSH
 
 @testable import FlowConsoleConfig
 
@@ -109,4 +110,45 @@ func testBKHostsToSSHConfig() throws {
     XCTAssert(env.contains("TERM") &&
               env.contains("LC*"), "List mapping failed")
   }
+
+  func testRemoteForwardPolicy() throws {
+    let defaults = try BKSSHHost(content: [:]).remoteForwardPolicy
+    XCTAssertEqual(defaults.maxConnections, 0)
+    XCTAssertEqual(defaults.prewarm, 0)
+
+    let host = try BKSSHHost(content: ["RemoteForwardMaxConnections": "8",
+                                       "RemoteForwardMaxQueued": "16",
+                                       "RemoteForwardPrewarm": "2"])
+    let policy = host.remoteForwardPolicy
+    XCTAssertEqual(policy.maxConnections, 8)
+    XCTAssertEqual(policy.maxQueued, 16)
+    XCTAssertEqual(policy.prewarm, 2)
+
+    XCTAssertThrowsError(try BKSSHHost(content: ["RemoteForwardPrewarm": "-1"]))
+  }
+
+  func testSSHConfigIncludeChain() throws {
+    let dir = fm.temporaryDirectory.appendingPathComponent(UUID().uuidString)
+    try fm.createDirectory(at: dir.appendingPathComponent("conf.d"), withIntermediateDirectories: true)
+    defer { try? fm.removeItem(at: dir) }
+
+    let root = dir.appendingPathComponent("ssh_config")
+    try "Include ssh_config_hosts\nInclude conf.d/*.conf\n\nHost *\n  User glenda\n".write(to: root, atomically: true, encoding: .utf8)
+    try "Host test\n  HostName localhost\n".write(to: dir.appendingPathComponent("ssh_config_hosts"), atomically: true, encoding: .utf8)
+    try "Host other\n  Port 2222\n".write(to: dir.appendingPathComponent("conf.d/other.conf"), atomically: true, encoding: .utf8)
+
+    let chain = BKSSHConfigCache.includeChain(from: root)
+    let paths = chain.stamps.map { ($0.path as NSString).lastPathComponent }
+    XCTAssertEqual(paths, ["ssh_config", "ssh_config_hosts", "conf.d", "other.conf"])
+    XCTAssertTrue(chain.isMemoizable)
+
+    // Rewriting the same content keeps the hash, so the parsed config can be kept.
+    try "Host test\n  HostName localhost\n".write(to: dir.appendingPathComponent("ssh_config_hosts"), atomically: true, encoding: .utf8)
+    XCTAssertEqual(BKSSHConfigCache.includeChain(from: root).contentHash, chain.contentHash)
+
+    try "Match exec \"true\"\n  Port 2222\n".write(to: dir.appendingPathComponent("conf.d/other.conf"), atomically: true, encoding: .utf8)
+    let changed = BKSSHConfigCache.includeChain(from: root)
+    XCTAssertNotEqual(changed.contentHash, chain.contentHash)
+    XCTAssertFalse(changed.isMemoizable)
+  }
 }
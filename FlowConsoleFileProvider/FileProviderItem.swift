@@ -34,20 +34,35 @@ import UniformTypeIdentifiers
 class FileProviderItem: NSObject, NSFileProviderItem {
   let blinkIdentifier: BlinkFileItemIdentifier
   private let attributes: FlowConsoleFiles.FileAttributes
+  // From the modification date. Kept to compare with the DB without building the version each time.
+  let contentVersion: Data
 
   init(blinkIdentifier: BlinkFileItemIdentifier, attributes: FlowConsoleFiles.FileAttributes) {
     self.blinkIdentifier = blinkIdentifier
+    self.attributes = Self.providerAttributes(attributes)
+    let ts = (self.attributes[.modificationDate] as? NSDate)?.timeIntervalSince1970 ?? 0
+    self.contentVersion = "\(ts)".data(using: .utf8)!
+  }
 
+  private static func providerAttributes(_ attributes: FlowConsoleFiles.FileAttributes) -> FlowConsoleFiles.FileAttributes {
     let fileType = attributes[.type] as? FileAttributeType
     if fileType == .typeSymbolicLink,
        let targetAttributes = attributes[.symbolicLinkTargetInfo] as? FlowConsoleFiles.FileAttributes {
       // For purposes of the Provider, the attributes the attributes are those of the target, except the symlink name.
       var attrs = targetAttributes
       attrs[.name] = attributes[.name] as! String
-      self.attributes = attrs
-    } else {
-      self.attributes = attributes
+      return attrs
     }
+    return attributes
+  }
+
+  // Whether the item would be the same if built from the attributes, so it can be reused.
+  func hasSameAttributes(_ attributes: FlowConsoleFiles.FileAttributes) -> Bool {
+    let attrs = Self.providerAttributes(attributes)
+    return attrs[.type] as? FileAttributeType == self.attributes[.type] as? FileAttributeType &&
+      attrs[.modificationDate] as? NSDate == self.attributes[.modificationDate] as? NSDate &&
+      attrs[.size] as? NSNumber == self.attributes[.size] as? NSNumber &&
+      attrs[.posixPermissions] as? NSNumber == self.attributes[.posixPermissions] as? NSNumber
   }
 
   var itemIdentifier: NSFileProviderItemIdentifier {
@@ -63,9 +78,7 @@ class FileProviderItem: NSObject, NSFileProviderItem {
   }
 
   var itemVersion: NSFileProviderItemVersion {
-    let ts = (attributes[.modificationDate] as? NSDate)?.timeIntervalSince1970 ?? 0
-    return NSFileProviderItemVersion(contentVersion: "\(ts)".data(using: .utf8)!,
-                                     metadataVersion: "\(ts)".data(using: .utf8)!)
+    NSFileProviderItemVersion(contentVersion: contentVersion, metadataVersion: contentVersion)
   }
 
   var filename: String {
@@ -234,7 +234,16 @@ public class WorkingSet {
   private let fpm: NSFileProviderManager?
   private let pollCoordinator = PollCoordinator()
   private var timer: DispatchSourceTimer? = nil
-  private var timerIntervalInSeconds = 0
+  private var nextPollDeadline: DispatchTime? = nil
+  // Polls start at the base interval, and back off while nothing changes. Zero until started.
+  private var baseIntervalInSeconds = 0
+  private var pollIntervalInSeconds = 0
+  private let maxPollIntervalInSeconds = 120
+  // While the remote reports its changes, only the containers it touched are polled.
+  private var watchCancellable: AnyCancellable? = nil
+  private var watchRetryInSeconds = WorkingSet.minWatchRetryInSeconds
+  private static let minWatchRetryInSeconds = 60
+  private static let maxWatchRetryInSeconds = 30 * 60
   private let log: BlinkLogger
   private var prepareChangesCancellable: AnyCancellable? = nil
   private var prepareChangesTick = 0
@@ -249,6 +258,9 @@ public class WorkingSet {
   private let db: WorkingSetDatabase
 
   private var itemsInCommit = Set<String>()
+  // Items built on the last poll, by container and name. They are reused while their attributes
+  // stay the same. Only from the changesQueue.
+  private var polledItems: [NSFileProviderItemIdentifier: [String: FileProviderItem]] = [:]
 
   init(domain: NSFileProviderDomain?, db: WorkingSetDatabase, logger: BlinkLogger) throws {
     self.log = logger
@@ -271,6 +283,21 @@ public class WorkingSet {
   }
 
   func resumeChangesTimerEvery(seconds: Int) {
+    changesQueue.async {
+      self.baseIntervalInSeconds = seconds
+      self.pollIntervalInSeconds = seconds
+      self.schedulePoll(in: 0)
+    }
+  }
+
+  // Polls again by the given time, unless one is already scheduled before. Only from the changesQueue.
+  private func schedulePoll(in seconds: Double) {
+    let deadline = DispatchTime.now() + seconds
+    if timer != nil, let nextPollDeadline = nextPollDeadline, nextPollDeadline <= deadline {
+      return
+    }
+
+    self.timer?.cancel()
     let timer = DispatchSource.makeTimerSource(flags: [], queue: changesQueue)
     timer.setEventHandler { [weak self] in
       guard let self = self else {
@@ -278,14 +305,109 @@ public class WorkingSet {
       }
 
       self.log.info("Timer triggered")
+      self.timer = nil
+      self.nextPollDeadline = nil
       self.prepareChangesAndSignalEnumerator()
+      if !self.pollCoordinator.isWatching {
+        self.schedulePoll(in: Double(self.pollIntervalInSeconds))
+      }
     }
 
-    timer.schedule(deadline: .now(), repeating: .seconds(seconds))
+    timer.schedule(deadline: deadline)
     timer.resume()
 
     self.timer = timer
-    self.timerIntervalInSeconds = seconds
+    self.nextPollDeadline = deadline
+  }
+
+  // Without a watch, polls slow down while nothing changes, and come back to the base interval
+  // as soon as something does. Only from the changesQueue.
+  private func adjustPollInterval(foundChanges: Bool) {
+    guard baseIntervalInSeconds > 0 else {
+      return
+    }
+    if foundChanges {
+      pollIntervalInSeconds = baseIntervalInSeconds
+    } else {
+      pollIntervalInSeconds = min(pollIntervalInSeconds * 2, maxPollIntervalInSeconds)
+    }
+  }
+
+  // Listens for changes on the remote, if it can report them. Touched containers are polled soon
+  // after, and nothing else is. If the watch stops, polling takes over until it is back.
+  func watchChanges(on rootTranslator: @escaping () -> TranslatorPublisher) {
+    changesQueue.async {
+      self.startWatch(on: rootTranslator)
+    }
+  }
+
+  private func startWatch(on rootTranslator: @escaping () -> TranslatorPublisher) {
+    self.watchCancellable = rootTranslator()
+      .flatMap { root -> AnyPublisher<(String, String), Error> in
+        // Nothing to wait for if the translator cannot watch at all.
+        guard let watcher = root.clone() as? WatchTranslator else {
+          return Empty().eraseToAnyPublisher()
+        }
+        let rootPath = watcher.current
+        return watcher.watchChanges().map { (rootPath, $0) }.eraseToAnyPublisher()
+      }
+      .receive(on: changesQueue)
+      .sink(
+        receiveCompletion: { [weak self] completion in
+          guard let self = self else {
+            return
+          }
+
+          self.log.info("Watch stopped, polling instead - \(completion)")
+          self.watchCancellable = nil
+          self.pollCoordinator.isWatching = false
+          if self.baseIntervalInSeconds > 0 {
+            self.pollIntervalInSeconds = self.baseIntervalInSeconds
+            self.schedulePoll(in: 0)
+          }
+          guard case .failure = completion else {
+            return
+          }
+
+          let retry = self.watchRetryInSeconds
+          self.watchRetryInSeconds = min(retry * 2, Self.maxWatchRetryInSeconds)
+          self.changesQueue.asyncAfter(deadline: .now() + .seconds(retry)) { [weak self] in
+            guard let self = self, self.watchCancellable == nil, self.baseIntervalInSeconds > 0 else {
+              return
+            }
+            self.startWatch(on: rootTranslator)
+          }
+        },
+        receiveValue: { [weak self] (rootPath, changedPath) in
+          guard let self = self else {
+            return
+          }
+
+          if !self.pollCoordinator.isWatching {
+            self.log.info("Watching changes at \(rootPath)")
+            self.pollCoordinator.isWatching = true
+            self.watchRetryInSeconds = Self.minWatchRetryInSeconds
+          }
+          guard let path = WorkingSet.containerPath(of: changedPath, under: rootPath) else {
+            return
+          }
+          self.pollCoordinator.markChanged(path)
+          // Changes come in bursts, so give them a moment to settle.
+          self.schedulePoll(in: 1)
+        })
+  }
+
+  // Path of a remote directory relative to the root, as in BlinkFileItemIdentifier. Nil if outside of it.
+  static func containerPath(of path: String, under rootPath: String) -> String? {
+    let root = rootPath.hasSuffix("/") ? String(rootPath.dropLast()) : rootPath
+    let path = path.hasSuffix("/") && path.count > 1 ? String(path.dropLast()) : path
+    if path == root {
+      return ""
+    }
+    guard path.hasPrefix(root + "/") else {
+      return nil
+    }
+    return String(path.dropFirst(root.count + 1))
   }
 
   func addToActiveEnumerators(_ enumerator: FileProviderReplicatedEnumerator,
@@ -299,8 +421,10 @@ public class WorkingSet {
 
         if needsEnumeration && prepareChangesCancellable == nil {
           self.cancelChanges()
-          if timer != nil {
-            resumeChangesTimerEvery(seconds: self.timerIntervalInSeconds)
+          self.pollCoordinator.markChanged(enumerator.blinkIdentifier.path)
+          if baseIntervalInSeconds > 0 {
+            self.pollIntervalInSeconds = self.baseIntervalInSeconds
+            self.schedulePoll(in: 0)
           }
         }
         return true
@@ -321,6 +445,7 @@ public class WorkingSet {
         return
       }
 
+      self.adjustPollInterval(foundChanges: !changes.isEmpty)
       if changes.isEmpty {
         self.log.info("No changes.")
         return
@@ -356,7 +481,11 @@ public class WorkingSet {
         }
       }
 
+      // A new batch replaces the one in flight, so what it was looking at goes again.
+      self.pollCoordinator.requeueBatch()
       let enumerators = self.pollCoordinator.nextBatch()
+      let polledContainers = Set(enumerators.map { $0.blinkIdentifier.itemIdentifier })
+      self.polledItems = self.polledItems.filter { polledContainers.contains($0.key) }
 
       if enumerators.isEmpty {
         onCompletion(ItemsChanged())
@@ -365,9 +494,14 @@ public class WorkingSet {
 
       self.prepareChangesCancellable = enumerators.publisher
         .compactMap { enumerator in
-          self.itemsInCommit.contains { $0.hasPrefix(enumerator.blinkIdentifier.path + "/") } ? nil : enumerator
+          guard !self.itemsInCommit.contains(where: { $0.hasPrefix(enumerator.blinkIdentifier.path + "/") }) else {
+            // Look again once the commit is done, in case the change came from a watch.
+            self.pollCoordinator.markChanged(enumerator.blinkIdentifier.path)
+            return nil
+          }
+          return enumerator
         }
-        .flatMap { enumerator -> AnyPublisher<([ItemRow], [FileProviderItem]), Never> in
+        .flatMap { enumerator -> AnyPublisher<(BlinkFileItemIdentifier, [ItemRow], [FlowConsoleFiles.FileAttributes]), Never> in
           let container = enumerator.blinkIdentifier
           let dbItemsPublisher = Just(container.itemIdentifier)
             .tryMap {
@@ -376,44 +510,39 @@ public class WorkingSet {
               return itemRows
             }
           let allItemsPublisher = enumerator.allItems()
-            .tryMap {
+            .map {
               self.log.debug("\(container.description) received \($0.count) from source.")
-              return try self.matchOrGenerateItemAttributesInContainer(container, itemsAttributes: $0)
+              return $0
             }
 
           return Publishers.Zip(dbItemsPublisher, allItemsPublisher)
-            .catch { error -> AnyPublisher<([ItemRow], [FileProviderItem]), Never> in
+            .map { (container, $0, $1) }
+            .catch { error -> AnyPublisher<(BlinkFileItemIdentifier, [ItemRow], [FlowConsoleFiles.FileAttributes]), Never> in
               // Skip an enumerator if it failed.
               self.log.error("prepareChanges for \(container.description) failed - \(error)")
-              return Just(([], [])).eraseToAnyPublisher()
+              return Just((container, [], [])).eraseToAnyPublisher()
             }
             .eraseToAnyPublisher()
         }
         .receive(on: self.changesQueue)
-        .map { (rows: [ItemRow], items: [FileProviderItem]) -> ItemsChanged in
-          let deletedRows = rows.filter { row in
-            !items.contains { $0.filename == row.name }
-          }
-
-          let updatedItems = items.compactMap { item in
-            if let row = rows.first(where: { $0.name == item.filename }),
-               item.itemVersion != row.version {
-              return item
-            }
-            return nil
+        .map { (container: BlinkFileItemIdentifier, rows: [ItemRow], itemsAttributes: [FlowConsoleFiles.FileAttributes]) -> ItemsChanged in
+          if rows.isEmpty && itemsAttributes.isEmpty {
+            return ItemsChanged()
           }
 
-          // Find new items
-          let newItems = items.filter { item in
-            !rows.contains { $0.name == item.filename }
-          }
+          let items = self.matchOrGenerateItemAttributesInContainer(container,
+                                                                    itemsAttributes: itemsAttributes,
+                                                                    previousRows: rows,
+                                                                    previousItems: self.polledItems[container.itemIdentifier] ?? [:])
+          self.polledItems[container.itemIdentifier] = Dictionary(items.map { ($0.filename, $0) },
+                                                                  uniquingKeysWith: { first, _ in first })
 
-          let detectedChanges = ItemsChanged(creates: newItems, updates: updatedItems, deletions: deletedRows)
+          let detectedChanges = ItemsChanged(from: rows, to: items)
           if detectedChanges.hasChanges {
-            (newItems + updatedItems).forEach { item in
+            (detectedChanges.creates + detectedChanges.updates).forEach { item in
               self.log.debug("Item changed: \(item.filename)")
             }
-            deletedRows.forEach { item in
+            detectedChanges.deletions.forEach { item in
               self.log.debug("Deleted \(item.name)")
             }
           }
@@ -426,6 +555,7 @@ public class WorkingSet {
        }
         .sink {
           self.log.info("Prepare changes completed")
+          self.pollCoordinator.completeBatch()
           onCompletion($0)
         }
     }
@@ -476,7 +606,10 @@ public class WorkingSet {
           let createRows = self.changes.creates.map { ItemRow.from($0, at: self.anchorIteration) }
           let updateRows = self.changes.updates.map { ItemRow.from($0, at: self.anchorIteration) }
 
-          let deletedRows = try db.updateChangedItems(createRows: createRows, updateRows: updateRows, deleteRows: self.changes.deletions)
+          let deletedRows = try db.updateChangedItems(createRows: createRows,
+                                                      updateRows: updateRows,
+                                                      deleteRows: self.changes.deletions,
+                                                      at: self.anchorIteration)
           let deletions = deletedRows.map { $0.item }
 
           // Filter "." as internal.
@@ -490,6 +623,15 @@ public class WorkingSet {
           observer.finishEnumeratingWithError(error)
         }
 
+        return
+      } else if anchor.version == self.anchorVersion,
+                self.changes.isEmpty,
+                let delta = try? db.changes(since: anchor.iteration),
+                // Items cannot be rebuilt from rows, so only deletions can be caught up from the log.
+                delta.updated.isEmpty {
+        self.log.debug("enumerateChanges \(delta.deleted.count) deletions from the log")
+        observer.didDeleteItems(withIdentifiers: delta.deleted)
+        observer.finishEnumeratingChanges(upTo: self.anchor, moreComing: false)
         return
       } else {
         self.log.error("SyncAnchor expired. Requested \(anchor.string). WorkingSet at \(self.anchor.string)")
@@ -559,7 +701,9 @@ extension WorkingSet {
     log.debug("Commit \(itemsAttributes.count) items at \(container.path)")
 
     // Replace Rows with new set.
-    let items = try matchOrGenerateItemAttributesInContainer(container, itemsAttributes: itemsAttributes)
+    let items = matchOrGenerateItemAttributesInContainer(container,
+                                                         itemsAttributes: itemsAttributes,
+                                                         previousRows: try self.db.items(in: container.itemIdentifier))
 
     let newRows = items.map { ItemRow.from($0, at: self.anchorIteration) }
 
@@ -568,13 +712,26 @@ extension WorkingSet {
     return items
   }
 
-  private func matchOrGenerateItemAttributesInContainer(_ container: BlinkFileItemIdentifier, itemsAttributes: [FlowConsoleFiles.FileAttributes]) throws -> [FileProviderItem] {
-    let previousRows = try self.db.items(in: container.itemIdentifier)
+  // Items keep the identifier of the row with their name, and previous items are reused as long as
+  // they still match it.
+  private func matchOrGenerateItemAttributesInContainer(_ container: BlinkFileItemIdentifier,
+                                                        itemsAttributes: [FlowConsoleFiles.FileAttributes],
+                                                        previousRows: [ItemRow],
+                                                        previousItems: [String: FileProviderItem] = [:]) -> [FileProviderItem] {
+    let rowsByName = Dictionary(previousRows.map { ($0.name, $0) }, uniquingKeysWith: { first, _ in first })
 
     return itemsAttributes.map { itemAttrs in
       let itemName = itemAttrs[.name] as! String
       let fileType = itemAttrs[.type] as? FileAttributeType
-      let blinkIdentifier = if let existingRow = previousRows.first(where: { $0.name == itemName }) {
+      let existingRow = rowsByName[itemName]
+      if let existingRow = existingRow,
+         let previousItem = previousItems[itemName],
+         previousItem.itemIdentifier == existingRow.item,
+         previousItem.hasSameAttributes(itemAttrs) {
+        return previousItem
+      }
+
+      let blinkIdentifier = if let existingRow = existingRow {
         BlinkFileItemIdentifier(with: existingRow.item, name: itemName, parent: container)
       } else {
         BlinkFileItemIdentifier.generate(name: itemName, parent: container, isSymbolicLink: fileType == .typeSymbolicLink)
@@ -596,13 +753,22 @@ extension WorkingSet {
           return item
         }
         .handleEvents(
-          receiveCompletion: { _ in self.changesQueue.async { self.itemsInCommit.remove(itemPath) } },
-          receiveCancel: { self.changesQueue.async { self.itemsInCommit.remove(itemPath) } }
+          receiveCompletion: { _ in self.changesQueue.async { self.didCommitItem(itemPath) } },
+          receiveCancel: { self.changesQueue.async { self.didCommitItem(itemPath) } }
         )
         .eraseToAnyPublisher()
     }
   }
 
+  // Only from the changesQueue.
+  private func didCommitItem(_ itemPath: String) {
+    itemsInCommit.remove(itemPath)
+    // Containers skipped during the commit are looked at again.
+    if pollCoordinator.hasChanges && baseIntervalInSeconds > 0 {
+      schedulePoll(in: 1)
+    }
+  }
+
   func commitItemInSet(_ item: FileProviderItem) throws {
     log.debug("Committing item \(item.blinkIdentifier.path)")
     let row = ItemRow.from(item, at: self.anchorIteration)
@@ -611,17 +777,27 @@ extension WorkingSet {
 
   func invalidate() {
     cancelTimers()
-    cancelChanges()
+    changesQueue.sync {
+      self.cancelChanges()
+      self.watchCancellable?.cancel()
+      self.watchCancellable = nil
+    }
   }
 
+  // Only from the changesQueue.
   private func cancelChanges() {
     self.prepareChangesCancellable?.cancel()
     self.prepareChangesCancellable = nil
+    self.pollCoordinator.requeueBatch()
   }
 
   private func cancelTimers() {
-    self.timer?.cancel()
-    self.timer = nil
+    changesQueue.sync {
+      self.timer?.cancel()
+      self.timer = nil
+      self.nextPollDeadline = nil
+      self.baseIntervalInSeconds = 0
+    }
   }
 }
 
@@ -656,7 +832,34 @@ struct ItemsChanged {
   }
 }
 
+extension ItemsChanged {
+  // Changes from the rows in the DB for a container to the items in it now, matched by name.
+  init(from rows: [ItemRow], to items: [FileProviderItem]) {
+    var unmatchedRows = Dictionary(rows.map { ($0.name, $0) }, uniquingKeysWith: { first, _ in first })
+    var creates: [FileProviderItem] = []
+    var updates: [FileProviderItem] = []
+
+    for item in items {
+      guard let row = unmatchedRows.removeValue(forKey: item.filename) else {
+        creates.append(item)
+        continue
+      }
+      if item.contentVersion != row.version.contentVersion {
+        updates.append(item)
+      }
+    }
+
+    // Rows whose name was not enumerated anymore.
+    let deletions = rows.filter { unmatchedRows[$0.name] != nil }
+    self.init(creates: creates, updates: updates, deletions: deletions)
+  }
+}
+
 extension NSFileProviderSyncAnchor {
+  var version: String {
+    self.string.components(separatedBy: "-")[0]
+  }
+
   var iteration: Int {
     Int(self.string
       .components(separatedBy: "-")[1])!
@@ -669,6 +872,9 @@ extension NSFileProviderSyncAnchor {
 
 class PollCoordinator {
   private var activeEnumerators: [FileProviderReplicatedEnumerator] = []
+  private var changedPaths = Set<String>()
+  private var batchPaths = Set<String>()
+  var isWatching = false
 
   func addActiveEnumerator(_ enumerator: FileProviderReplicatedEnumerator) {
     // Observed that the provider may add the enumerator more than once while it transitions.
@@ -690,7 +896,35 @@ class PollCoordinator {
     activeEnumerators.removeAll(where: { enumerator === $0 })
   }
 
+  // Paths of the containers that were reported changed since the last batch.
+  func markChanged(_ path: String) {
+    changedPaths.insert(path)
+  }
+
+  var hasChanges: Bool {
+    !changedPaths.isEmpty
+  }
+
+  // All active enumerators when polling. Only the ones that changed while watching. Their paths
+  // stay with the batch until it completes.
   func nextBatch() -> [FileProviderReplicatedEnumerator] {
-    return activeEnumerators
+    guard isWatching else {
+      changedPaths = []
+      return activeEnumerators
+    }
+    let batch = activeEnumerators.filter { changedPaths.contains($0.blinkIdentifier.path) }
+    batchPaths = Set(batch.map { $0.blinkIdentifier.path })
+    changedPaths = []
+    return batch
+  }
+
+  func completeBatch() {
+    batchPaths = []
+  }
+
+  // The batch did not complete, so its paths are still changed.
+  func requeueBatch() {
+    changedPaths.formUnion(batchPaths)
+    batchPaths = []
   }
 }
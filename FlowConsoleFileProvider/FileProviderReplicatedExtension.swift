@@ -90,6 +90,9 @@ public class FileProviderReplicatedExtension: NSObject, NSFileProviderReplicated
 
     DispatchQueue.global(qos: .background).asyncAfter(deadline: .now() + 5) {
       self.workingSet.resumeChangesTimerEvery(seconds: 5)
+      self.workingSet.watchChanges(on: { [weak self] in
+        self?.rootTranslator ?? Empty().eraseToAnyPublisher()
+      })
     }
 
     DispatchQueue.global(qos: .background).async {
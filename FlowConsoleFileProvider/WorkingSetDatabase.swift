@@ -26,6 +26,7 @@
 //
 ////////////////////////////////////////////////////////////////////////////////
 
+
 import FileProvider
 import Foundation
 import SQLite
@@ -41,6 +42,12 @@ private let anchorKey        = Expression<Int>("Anchor")
 private let nameKey          = Expression<String>("Name")
 private let containerPathKey = Expression<String>("ContainerPath")
 
+// Deleted items, by the anchor they were deleted at. Updates are read from the State itself.
+private let changeLogTable = Table("ChangeLog")
+
+// Columns of the State, in the order ItemRow(values:) reads them.
+private let itemColumns = "Item, Name, Container, ContainerPath, Version, Anchor, isContainer"
+
 fileprivate extension Connection {
   var userVersion: Int {
     get { return Int(try! scalar("PRAGMA user_version") as! Int64) }
@@ -50,12 +57,20 @@ fileprivate extension Connection {
 
 public class WorkingSetDatabase {
   private let db: Connection
-  static let dbVersion = 10
+  static let dbVersion = 11
+  // Anchors the change log goes back, from the newest one.
+  static let changeLogLength = 1000
   private let log: BlinkLogger
 
   private let stateTable = Table("State")
   private let reparentedTable = Table("Reparented")
 
+  // Statements for the frequent queries are compiled once per connection. They cannot be stepped
+  // from two threads at once, so they and transactions go through the lock, always taken before
+  // the connection's own.
+  private var statements: [String: Statement] = [:]
+  private let lock = NSRecursiveLock()
+
   var anchorVersion: String {
     get {
       return try! db.scalar("SELECT value FROM metadata WHERE key = 'anchor_version'") as? String ?? ""
@@ -74,7 +89,10 @@ public class WorkingSetDatabase {
       log.info("Versions changed.")
 
       try? FileManager().removeItem(at: pathURL)
+      try? FileManager().removeItem(atPath: path + "-wal")
+      try? FileManager().removeItem(atPath: path + "-shm")
       self.db = try Connection(path)
+      try db.execute("PRAGMA journal_mode = WAL")
 
       try db.run(stateTable.create {
         $0.column(itemKey, primaryKey: true)
@@ -85,6 +103,15 @@ public class WorkingSetDatabase {
         $0.column(nameKey)
         $0.column(containerPathKey)
       })
+      try db.run(stateTable.createIndex(containerKey, nameKey))
+      try db.run(stateTable.createIndex(containerPathKey))
+      try db.run(stateTable.createIndex(anchorKey))
+
+      try db.run(changeLogTable.create {
+        $0.column(anchorKey)
+        $0.column(itemKey)
+      })
+      try db.run(changeLogTable.createIndex(anchorKey))
 
       try! db.run("CREATE TABLE IF NOT EXISTS metadata (key TEXT PRIMARY KEY, value TEXT)")
 
@@ -94,6 +121,11 @@ public class WorkingSetDatabase {
       self.db = try Connection(path)
     }
 
+    // WAL lets reads go on while changes are written, and only needs to sync on checkpoints.
+    try db.execute("PRAGMA synchronous = NORMAL")
+    // Staging area for bulk updates. Temporary tables belong to the connection.
+    try db.execute("CREATE TEMP TABLE IF NOT EXISTS NewItems (\(itemColumns))")
+
     try FileManager().createDirectory(at: pathURL.deletingLastPathComponent(),
                                       withIntermediateDirectories: true,
                                       attributes: nil)
@@ -106,37 +138,24 @@ public class WorkingSetDatabase {
   }
 
   func item(_ itemIdentifier: NSFileProviderItemIdentifier) throws -> ItemRow? {
-    let query = stateTable.filter(itemKey == itemIdentifier.rawValue)
-
-    if let row = try db.pluck(query) {
-      return ItemRow(row)
-    } else {
-      return nil
-    }
+    try rows("SELECT \(itemColumns) FROM State WHERE Item = ?", itemIdentifier.rawValue).first
   }
 
   func item(from name: String, containerIdentifier: NSFileProviderItemIdentifier) throws -> ItemRow? {
-    let query = stateTable.filter(nameKey == name && containerKey == containerIdentifier.rawValue)
-
-    if let row = try db.pluck(query) {
-      return ItemRow(row)
-    } else {
-      return nil
-    }
+    try rows("SELECT \(itemColumns) FROM State WHERE Container = ? AND Name = ?",
+             containerIdentifier.rawValue, name).first
   }
 
   func items(in containerIdentifier: NSFileProviderItemIdentifier) throws -> [ItemRow] {
-    let query = stateTable.filter(containerKey == containerIdentifier.rawValue)
-
-    return try db.prepare(query).map { ItemRow($0) }
+    try rows("SELECT \(itemColumns) FROM State WHERE Container = ?", containerIdentifier.rawValue)
   }
 
   func isItemInSet(_ itemIdentifier: NSFileProviderItemIdentifier) throws -> Bool {
-    try db.scalar(stateTable.filter(itemKey == itemIdentifier.rawValue).exists)
+    try !values("SELECT 1 FROM State WHERE Item = ? LIMIT 1", itemIdentifier.rawValue).isEmpty
   }
 
   func isContentInSet(_ containerIdentifier: NSFileProviderItemIdentifier) throws -> Bool {
-    try db.scalar(stateTable.filter(containerKey == containerIdentifier.rawValue).exists)
+    try !values("SELECT 1 FROM State WHERE Container = ? LIMIT 1", containerIdentifier.rawValue).isEmpty
   }
 
   func containersInSet() throws -> [NSFileProviderItemIdentifier] {
@@ -152,20 +171,16 @@ public class WorkingSetDatabase {
 
     try transaction("updateItem") {
       // Check if an item with the same name and container already exists
-      let itemInContainerQuery = stateTable.filter(nameKey == row.name && containerKey == row.container.rawValue)
-
-      if let existingRow = try db.pluck(itemInContainerQuery) {
-        let existingItem = ItemRow(existingRow)
-
+      if let existingItem = try item(from: row.name, containerIdentifier: row.container) {
         // If replacing a different item, delete the old one and its sub-items if it's a container
         if existingItem.item != row.item {
           if existingItem.isContainer {
             log.debug("Item is replacing container \(existingItem.item.rawValue)")
-            let subItems = try deleteOldRowsNotInNewSet(within: existingItem.blinkIdentifier(), newSet: [])
+            let subItems = try deleteOldRows(within: existingItem.blinkIdentifier(), keepingNewItems: false)
             deletedItems.append(contentsOf: subItems)
           }
           deletedItems.append(existingItem)
-          try db.run(itemInContainerQuery.delete())
+          try run("DELETE FROM State WHERE Item = ?", existingItem.item.rawValue)
         }
       }
 
@@ -181,15 +196,8 @@ public class WorkingSetDatabase {
       }
 
       // Insert or replace the item
-      let upsert = stateTable.insert(or: .replace,
-                                     itemKey <- row.item.rawValue,
-                                     nameKey <- row.name,
-                                     containerKey <- row.container.rawValue,
-                                     containerPathKey <- row.containerPath,
-                                     versionKey <- row.version.contentVersion,
-                                     anchorKey <- row.anchor,
-                                     isContainerKey <- row.isContainer)
-      try db.run(upsert)
+      try run("INSERT OR REPLACE INTO State (\(itemColumns)) VALUES (?, ?, ?, ?, ?, ?, ?)", row.bindings)
+      try logDeletions(deletedItems, at: row.anchor)
     }
 
     return deletedItems
@@ -200,27 +208,27 @@ public class WorkingSetDatabase {
     try transaction("updateItems") {
       log.debug("updateItems \(items.count) InContainer \(blinkIdentifier.path)")
 
-      let newSet = items.map { $0.name }
-      deletedRows = try deleteOldRowsNotInNewSet(within: blinkIdentifier, newSet: newSet)
-
+      // The new set is staged, so it can be compared and moved over with a statement each.
+      try run("DELETE FROM temp.NewItems")
       for row in items {
-        let upsert = stateTable.insert(or: .replace,
-                                       itemKey <- row.item.rawValue,
-                                       nameKey <- row.name,
-                                       containerKey <- row.container.rawValue,
-                                       containerPathKey <- row.containerPath,
-                                       versionKey <- row.version.contentVersion,
-                                       anchorKey <- row.anchor,
-                                       isContainerKey <- row.isContainer)
-        try db.run(upsert)
+        try run("INSERT INTO temp.NewItems (\(itemColumns)) VALUES (?, ?, ?, ?, ?, ?, ?)", row.bindings)
       }
+
+      deletedRows = try deleteOldRows(within: blinkIdentifier, keepingNewItems: true)
+      try run("INSERT OR REPLACE INTO State (\(itemColumns)) SELECT \(itemColumns) FROM temp.NewItems")
+      try run("DELETE FROM temp.NewItems")
+
+      let anchor = try items.map { $0.anchor }.max() ?? newestAnchor()
+      try logDeletions(deletedRows, at: anchor)
     }
     return deletedRows
   }
 
+  // Deletions are logged at the given anchor, or at the newest one if none.
   func updateChangedItems(createRows: [ItemRow] = [],
                           updateRows: [ItemRow] = [],
-                          deleteRows: [ItemRow] = []) throws -> [ItemRow] {
+                          deleteRows: [ItemRow] = [],
+                          at anchor: Int? = nil) throws -> [ItemRow] {
     var deletedRows = deleteRows
     try transaction("updateChangedItems") {
       log.debug("updateChangedItems create \(createRows.count) update: \(updateRows.count) delete: \(deleteRows.count)")
@@ -230,109 +238,113 @@ public class WorkingSetDatabase {
       for row in deleteRows {
         if row.isContainer {
           let container = row.blinkIdentifier()
-          let deleted = try deleteOldRowsNotInNewSet(within: container, newSet: [])
+          let deleted = try deleteOldRows(within: container, keepingNewItems: false)
           deletedRows.append(contentsOf: deleted)
         }
-        try db.run(stateTable.filter(itemKey == row.item.rawValue).delete())
+        try run("DELETE FROM State WHERE Item = ?", row.item.rawValue)
       }
 
       for row in createRows {
-        let insert = stateTable.insert(
-          itemKey <- row.item.rawValue,
-          nameKey <- row.name,
-          containerKey <- row.container.rawValue,
-          containerPathKey <- row.containerPath,
-          versionKey <- row.version.contentVersion,
-          anchorKey <- row.anchor,
-          isContainerKey <- row.isContainer
-        )
-        try db.run(insert)
+        try run("INSERT INTO State (\(itemColumns)) VALUES (?, ?, ?, ?, ?, ?, ?)", row.bindings)
       }
 
       for row in updateRows {
-        let update = stateTable.filter(itemKey == row.item.rawValue)
-          .update(
-          nameKey <- row.name,
-          containerKey <- row.container.rawValue,
-          containerPathKey <- row.containerPath,
-          versionKey <- row.version.contentVersion,
-          anchorKey <- row.anchor,
-          isContainerKey <- row.isContainer
-        )
-        try db.run(update)
+        try run("""
+          UPDATE State SET Name = ?, Container = ?, ContainerPath = ?, Version = ?, Anchor = ?, isContainer = ?
+          WHERE Item = ?
+          """, Array(row.bindings.dropFirst()) + [row.item.rawValue])
       }
+
+      let logAnchor = try anchor ?? newestAnchor()
+      try logDeletions(deletedRows, at: logAnchor)
+      // The provider does not ask for anchors that far back.
+      try run("DELETE FROM ChangeLog WHERE Anchor < ?", Int64(logAnchor - Self.changeLogLength))
     }
     return deletedRows
   }
 
   func newestAnchor() throws -> Int {
     do {
-      return try db.scalar(stateTable.select(anchorKey.max)) ?? 0
+      let newest = try values("""
+        SELECT max(Anchor) FROM (SELECT max(Anchor) AS Anchor FROM State
+                                 UNION ALL SELECT max(Anchor) FROM ChangeLog)
+        """).first?.first
+      return (newest as? Int64).map { Int($0) } ?? 0
     } catch {
       log.error("Could not get anchor: \(error)")
       throw error
     }
   }
 
-  private func deleteOldRowsNotInNewSet(within container: BlinkFileItemIdentifier, newSet: [String]) throws -> [ItemRow] {
-    // Fetch rows under the given path level.
-    var deletedRows: [ItemRow] = []
+  // Rows written and items deleted after the anchor, in anchor order. Nil if the log does not go back that far.
+  func changes(since anchor: Int) throws -> (updated: [ItemRow], deleted: [NSFileProviderItemIdentifier])? {
+    var changes: (updated: [ItemRow], deleted: [NSFileProviderItemIdentifier])? = nil
+    try transaction("changes") {
+      let newest = try newestAnchor()
+      guard anchor <= newest, newest - anchor < Self.changeLogLength else {
+        return
+      }
+      let updated = try rows("SELECT \(itemColumns) FROM State WHERE Anchor > ? ORDER BY Anchor", Int64(anchor))
+      let deleted = try values("SELECT Item FROM ChangeLog WHERE Anchor > ? ORDER BY Anchor", Int64(anchor))
+        .compactMap { ($0[0] as? String).map { NSFileProviderItemIdentifier($0) } }
+      changes = (updated, deleted)
+    }
+    return changes
+  }
 
-    let containerItemsQuery = stateTable.filter(containerPathKey == container.path)
-
-    log.debug("deleteOldRowsNotInNewSet for \(container.path)")
-
-    for row in try db.prepare(containerItemsQuery) {
-      let itemName = row[nameKey]
-      if !newSet.contains(itemName) {
-        log.debug("\(itemName) - deleted")
-        if row[isContainerKey] == true {
-          let subPath = (row[containerPathKey] as NSString).appendingPathComponent(itemName)
-          let subPathQuery = stateTable.filter(containerPathKey.like("\(subPath)%"))
-          let subPathRows = try db.prepareRowIterator(subPathQuery).map { subRow in
-            let itemRow = ItemRow(subRow)
-            log.debug("\(itemRow.containerPath) \(itemRow.name) - deleted")
-            return itemRow
-          }
+  private func deleteOldRows(within container: BlinkFileItemIdentifier, keepingNewItems: Bool) throws -> [ItemRow] {
+    log.debug("deleteOldRows for \(container.path)")
 
-          if !subPathRows.isEmpty {
-            try db.run(subPathQuery.delete())
-            deletedRows.append(contentsOf: subPathRows)
-          }
-        }
+    // Rows at the path level, that are not in the staged new set if keeping it.
+    let condition = keepingNewItems ?
+      "ContainerPath = ? AND Name NOT IN (SELECT Name FROM temp.NewItems)" :
+      "ContainerPath = ?"
 
-        try db.run(stateTable.filter(itemKey == row[itemKey]).delete())
-        deletedRows.append(ItemRow(row))
-      } else {
-        log.debug("\(itemName) - in new set")
-      }
+    var deletedRows = try rows("SELECT \(itemColumns) FROM State WHERE \(condition)", container.path)
+    guard !deletedRows.isEmpty else {
+      return []
+    }
+
+    for row in deletedRows where row.isContainer {
+      let subPath = (row.containerPath as NSString).appendingPathComponent(row.name)
+      deletedRows.append(contentsOf: try rows("SELECT \(itemColumns) FROM State WHERE \(Self.subtreeCondition)",
+                                              Self.subtreeBindings(subPath)))
+      try run("DELETE FROM State WHERE \(Self.subtreeCondition)", Self.subtreeBindings(subPath))
     }
+    try run("DELETE FROM State WHERE \(condition)", container.path)
 
     return deletedRows
   }
 
   func moveOldRows(within containerPath: String, to newPath: String) throws {
-    // Find all rows under the specified containerPath
-    let subItemsQuery = stateTable.filter(containerPathKey.like("\(containerPath)%"))
+    // Replace the portion of the path from previousPath with newPath, for all rows under it.
+    log.debug("moveOldRows - \(containerPath) -> \(newPath)")
+    try run("UPDATE State SET ContainerPath = ? || substr(ContainerPath, ?) WHERE \(Self.subtreeCondition)",
+            [newPath, Int64(containerPath.unicodeScalars.count + 1)] + Self.subtreeBindings(containerPath))
+  }
 
-    for row in try db.prepare(subItemsQuery) {
-      let currentPath = row[containerPathKey]
+  // Rows anywhere under the directory at a path, as a range the ContainerPath index can walk.
+  // Unlike a prefix, it does not reach into siblings whose name starts the same.
+  private static let subtreeCondition = "ContainerPath = ? OR (ContainerPath > ? AND ContainerPath < ?)"
+  private static func subtreeBindings(_ path: String) -> [Binding?] {
+    // "0" is the character right after "/".
+    [path, path + "/", path + "0"]
+  }
 
-      // Replace the portion of the path from previousPath with newPath
-      let updatedPath = currentPath.replacingOccurrences(of: containerPath, with: newPath, options: .anchored)
-      log.debug("moveOldRow - \(currentPath) -> \(updatedPath)")
-      let updateQuery = stateTable.filter(itemKey == row[itemKey]).update(containerPathKey <- updatedPath)
-      try db.run(updateQuery)
+  private func logDeletions(_ rows: [ItemRow], at anchor: Int) throws {
+    for row in rows {
+      try run("INSERT INTO ChangeLog (Anchor, Item) VALUES (?, ?)", Int64(anchor), row.item.rawValue)
     }
   }
 
-
   private static func hasDatabaseVersionChanged(at path: String) throws -> Bool {
     let tmpDB = try Connection(path)
     return tmpDB.userVersion != dbVersion
   }
 
   private func transaction(_ name: String, block: () throws -> Void) throws {
+    lock.lock()
+    defer { lock.unlock() }
     do {
       try db.transaction {
         try block()
@@ -342,6 +354,49 @@ public class WorkingSetDatabase {
       throw error
     }
   }
+
+  private func prepared(_ sql: String) throws -> Statement {
+    if let statement = statements[sql] {
+      return statement
+    }
+    let statement = try db.prepare(sql)
+    statements[sql] = statement
+    return statement
+  }
+
+  private func run(_ sql: String, _ bindings: Binding?...) throws {
+    try run(sql, bindings)
+  }
+
+  private func run(_ sql: String, _ bindings: [Binding?]) throws {
+    lock.lock()
+    defer { lock.unlock() }
+    try prepared(sql).run(bindings)
+  }
+
+  private func values(_ sql: String, _ bindings: Binding?...) throws -> [[Binding?]] {
+    try values(sql, bindings)
+  }
+
+  private func values(_ sql: String, _ bindings: [Binding?]) throws -> [[Binding?]] {
+    lock.lock()
+    defer { lock.unlock() }
+    // Step until done, so the statement does not hold a read on the DB.
+    let statement = try prepared(sql).bind(bindings)
+    var values: [[Binding?]] = []
+    while let row = try statement.failableNext() {
+      values.append(row)
+    }
+    return values
+  }
+
+  private func rows(_ sql: String, _ bindings: Binding?...) throws -> [ItemRow] {
+    try rows(sql, bindings)
+  }
+
+  private func rows(_ sql: String, _ bindings: [Binding?]) throws -> [ItemRow] {
+    try values(sql, bindings).map { ItemRow(values: $0) }
+  }
 }
 
 public struct ItemRow {
@@ -379,6 +434,23 @@ public struct ItemRow {
     self.anchor = row[anchorKey]
   }
 
+  // From the columns in itemColumns order.
+  fileprivate init(values: [Binding?]) {
+    let version = Data.fromDatatypeValue(values[4] as! Blob)
+    self.item = NSFileProviderItemIdentifier(values[0] as! String)
+    self.name = values[1] as! String
+    self.container = NSFileProviderItemIdentifier(values[2] as! String)
+    self.containerPath = values[3] as! String
+    self.version = NSFileProviderItemVersion(contentVersion: version, metadataVersion: version)
+    self.anchor = Int(values[5] as! Int64)
+    self.isContainer = (values[6] as! Int64) != 0
+  }
+
+  fileprivate var bindings: [Binding?] {
+    [item.rawValue, name, container.rawValue, containerPath,
+     version.contentVersion.datatypeValue, Int64(anchor), isContainer.datatypeValue]
+  }
+
 }
 
 extension ItemRow {
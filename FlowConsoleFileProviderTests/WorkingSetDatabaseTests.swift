@@ -28,6 +28,7 @@
 
 
 import XCTest
+import FlowConsoleFiles
 @testable import FlowConsoleFileProvider
 
 final class WorkingSetTests: XCTestCase {
@@ -192,6 +193,111 @@ final class WorkingSetTests: XCTestCase {
 
     wait(for: [expectUpdates], timeout: 4)
   }
+
+  func testItemsChangedByName() throws {
+    let sameVersion = NSFileProviderItemVersion(contentVersion: "100.0".data(using: .utf8)!, metadataVersion: "100.0".data(using: .utf8)!)
+    let unchanged = ItemRow(item: NSFileProviderItemIdentifier.shortUUID(),
+                            name: "unchanged",
+                            container: .rootContainer,
+                            containerPath: "",
+                            version: sameVersion,
+                            isContainer: false,
+                            anchor: 1)
+    let rows = [TestRows.file1, TestRows.file2, unchanged]
+
+    func item(_ name: String, modified: TimeInterval) -> FileProviderItem {
+      FileProviderItem(blinkIdentifier: .generate(name: name, parent: .rootContainer),
+                       attributes: [.name: name,
+                                    .type: FileAttributeType.typeRegular,
+                                    .modificationDate: NSDate(timeIntervalSince1970: modified)])
+    }
+    let items = [item("file1", modified: 200), item("unchanged", modified: 100), item("file3", modified: 100)]
+
+    let changes = ItemsChanged(from: rows, to: items)
+    XCTAssertEqual(changes.creates.map { $0.filename }, ["file3"])
+    XCTAssertEqual(changes.updates.map { $0.filename }, ["file1"])
+    XCTAssertEqual(changes.deletions.map { $0.name }, ["file2"])
+
+    XCTAssertTrue(items[1].hasSameAttributes([.name: "unchanged",
+                                              .type: FileAttributeType.typeRegular,
+                                              .modificationDate: NSDate(timeIntervalSince1970: 100)]))
+    XCTAssertFalse(items[1].hasSameAttributes([.name: "unchanged",
+                                               .type: FileAttributeType.typeRegular,
+                                               .modificationDate: NSDate(timeIntervalSince1970: 101)]))
+  }
+
+  func testChangeLog() throws {
+    let location = FileManager.default.urls(for: .documentDirectory, in: .userDomainMask)[0]
+    let db = try WorkingSetDatabase(path: location.appendingPathComponent("workingset.tests.db").path(), reset: true)
+
+    let _ = try db.updateItemsInContainer(.rootContainer, items: [TestRows.file1,
+                                                                  TestRows.file2,
+                                                                  TestRows.container1,
+                                                                  TestRows.container1_file1])
+    // A sibling whose name starts as the container must not be taken with it.
+    let sibling = ItemRow(item: NSFileProviderItemIdentifier.shortUUID(),
+                          name: "file1",
+                          container: NSFileProviderItemIdentifier.shortUUID(),
+                          containerPath: "container1b",
+                          version: TestRows.version1,
+                          isContainer: false,
+                          anchor: 1)
+    let _ = try db.updateItem(sibling)
+
+    let deletedRows = try db.updateChangedItems(deleteRows: [TestRows.container1], at: 2)
+    XCTAssertEqual(Set(deletedRows.map { $0.item }), [TestRows.container1.item, TestRows.container1_file1.item])
+    XCTAssertTrue(try db.isItemInSet(sibling.item))
+    XCTAssertEqual(try db.newestAnchor(), 2)
+
+    var changes = try XCTUnwrap(try db.changes(since: 1))
+    XCTAssertTrue(changes.updated.isEmpty)
+    XCTAssertEqual(Set(changes.deleted), [TestRows.container1.item, TestRows.container1_file1.item])
+
+    let updatedFile2 = ItemRow(item: TestRows.file2.item,
+                               name: TestRows.file2.name,
+                               container: TestRows.file2.container,
+                               containerPath: TestRows.file2.containerPath,
+                               version: TestRows.version1,
+                               isContainer: false,
+                               anchor: 3)
+    let _ = try db.updateChangedItems(updateRows: [updatedFile2], at: 3)
+    changes = try XCTUnwrap(try db.changes(since: 2))
+    XCTAssertEqual(changes.updated.map { $0.item }, [TestRows.file2.item])
+    XCTAssertTrue(changes.deleted.isEmpty)
+    XCTAssertNil(try db.changes(since: 4))
+  }
+
+  func testUpdateManyItemsInContainer() throws {
+    let location = FileManager.default.urls(for: .documentDirectory, in: .userDomainMask)[0]
+    let db = try WorkingSetDatabase(path: location.appendingPathComponent("workingset.tests.db").path(), reset: true)
+    let rows = (0..<50_000).map { idx in
+      ItemRow(item: NSFileProviderItemIdentifier("item-\(idx)"),
+              name: "file\(idx)",
+              container: .rootContainer,
+              containerPath: "",
+              version: TestRows.version1,
+              isContainer: false,
+              anchor: 1)
+    }
+    let _ = try db.updateItemsInContainer(.rootContainer, items: rows)
+
+    measure {
+      let deletedRows = try! db.updateItemsInContainer(.rootContainer, items: Array(rows.dropLast()))
+      XCTAssertEqual(deletedRows.count, 1)
+      XCTAssertEqual(try! db.items(in: .rootContainer).count, rows.count - 1)
+      let _ = try! db.updateItemsInContainer(.rootContainer, items: rows)
+    }
+  }
+
+  func testWatchedContainerPaths() throws {
+    XCTAssertEqual(WorkingSet.containerPath(of: "/home/user", under: "/home/user"), "")
+    XCTAssertEqual(WorkingSet.containerPath(of: "/home/user/", under: "/home/user"), "")
+    XCTAssertEqual(WorkingSet.containerPath(of: "/home/user/a/b", under: "/home/user/"), "a/b")
+    XCTAssertEqual(WorkingSet.containerPath(of: "/a", under: "/"), "a")
+    XCTAssertEqual(WorkingSet.containerPath(of: "/", under: "/"), "")
+    XCTAssertNil(WorkingSet.containerPath(of: "/home/username", under: "/home/user"))
+    XCTAssertNil(WorkingSet.containerPath(of: "/tmp", under: "/home/user"))
+  }
 }
 
 enum TestRows {
@@ -128,6 +128,10 @@ extension Translator {
         switch t.fileType {
         case .typeDirectory:
           let mode = passingAttributes[FileAttributeKey.posixPermissions] as? NSNumber ?? NSNumber(value: Int16(0o755))
+          // Files are only skipped by time one by one.
+          if !args.checkTimes, let tarCopy = self.tarCopy(as: name, from: t, mode: mode, args: args) {
+            return tarCopy
+          }
           return self.copyDirectory(as: name, from: t, mode: mode, args: args)
         default:
           let copyFilePublisher = self.copyFile(from: t, name: name, size: size, attributes: passingAttributes)
@@ -198,6 +202,56 @@ extension Translator {
   }
 }
 
+extension Translator {
+  // Trees between Local and a TarTranslator go as one tar stream, falling back to
+  // the regular copy if the other side cannot run tar.
+  fileprivate func tarCopy(as name: String,
+                           from t: Translator,
+                           mode: NSNumber,
+                           args: CopyArguments) -> CopyProgressInfoPublisher? {
+    let remote: TarTranslator
+    let transfer: (@escaping (CopyProgressInfo) -> Void) -> AnyPublisher<Void, Error>
+
+    if let source = t as? TarTranslator, let local = self as? Local {
+      remote = source
+      transfer = { progress in
+        let extractor = TarExtractor(into: local.current, preserve: args.preserve, progress: progress)
+        return source.sendTar(to: extractor)
+          .tryMap { try extractor.finish() }
+          .eraseToAnyPublisher()
+      }
+    } else if let source = t as? Local, let destination = self as? TarTranslator {
+      remote = destination
+      transfer = { progress in
+        destination.receiveTar(from: TarArchiver(at: source.current, progress: progress), args: args)
+      }
+    } else {
+      return nil
+    }
+
+    return remote.canStreamTar()
+      .flatMap { canStream -> CopyProgressInfoPublisher in
+        guard canStream else {
+          return self.copyDirectory(as: name, from: t, mode: mode, args: args)
+        }
+
+        print("Copying directory \(t.current) as tar stream")
+        let progress = PassthroughSubject<CopyProgressInfo, Error>()
+        var cancellable: AnyCancellable? = nil
+        return progress.handleEvents(
+          receiveCancel: { cancellable = nil },
+          receiveRequest: { _ in
+            guard cancellable == nil else {
+              return
+            }
+            cancellable = transfer({ progress.send($0) })
+              .sink(receiveCompletion: { progress.send(completion: $0) },
+                    receiveValue: {})
+          }).eraseToAnyPublisher()
+      }.eraseToAnyPublisher()
+  }
+}
+
 fileprivate enum FileState {
   case copy(File)
   case attributes(File)
@@ -208,7 +262,32 @@ extension Translator {
                             name: String,
                             size: NSNumber,
                             attributes: FileAttributes) -> CopyProgressInfoPublisher {
+    if let source = t as? Local, let local = self as? Local {
+      return local.copyFile(from: source, name: name, size: size, attributes: attributes)
+    }
+    if let destination = self as? ServerSideTranslator,
+       destination.capabilities.contains(.copyData),
+       destination.sharesServer(with: t) {
+      // Start over through the client if the server could not copy, as long as nothing was reported yet.
+      var copying = false
+      return destination.serverCopy(from: t, name: name, size: size, attributes: attributes)
+        .handleEvents(receiveOutput: { _ in copying = true })
+        .catch { error -> CopyProgressInfoPublisher in
+          if copying {
+            return .fail(error: error)
+          }
+          print("Server side copy failed, copying through the client. \(error)")
+          return self.streamFile(from: t, name: name, size: size, attributes: attributes)
+        }.eraseToAnyPublisher()
+    }
+
+    return streamFile(from: t, name: name, size: size, attributes: attributes)
+  }
 
+  fileprivate func streamFile(from t: Translator,
+                              name: String,
+                              size: NSNumber,
+                              attributes: FileAttributes) -> CopyProgressInfoPublisher {
     let fullFile: String
     let file: AnyPublisher<File, Error>
     // If we are a directory, we create the file. If we are a file, we open truncated.
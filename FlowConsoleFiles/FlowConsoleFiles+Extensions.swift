@@ -42,38 +42,88 @@ public extension Translator {
 }
 
 extension Translator {
+  // Translators for the items at path, expanding any wildcards in it. Components before the
+  // first wildcard are walked to, and the rest is expanded from there. Translators that can
+  // expand on their server do it at once, otherwise it is listed one directory at a time.
   public func translatorsMatching(path: String) -> AnyPublisher<Translator, Error> {
-    // If the source path contains a wildcard, then list and filter
-    // (or do it anyway).
-    // ~/asdf/test* - go to asdf, list and
-    // /asdf*
-    let sourceRootPath: String
-    if path.contains("/") {
-      sourceRootPath = (path as NSString).deletingLastPathComponent
-    } else {
-      sourceRootPath = current
+    let components = path.components(separatedBy: "/")
+    guard let firstWildcard = components.firstIndex(where: Glob.hasMagic) else {
+      return self.cloneWalkTo(path)
+        .mapError { err in BlinkFilesError(errorDescription: "Could not walk to \(path)", originalError: err) }
+        .eraseToAnyPublisher()
     }
-    let sourceComponent = (path as NSString).lastPathComponent
-    var sourceRootTranslator: Translator? = nil
-    return self.cloneWalkTo(sourceRootPath)
-      .flatMap { s -> AnyPublisher<FileAttributes, Error> in
-        sourceRootTranslator = s
-        return s.directoryFilesAndAttributes().flatMap { $0.publisher }.eraseToAnyPublisher()
-      }.compactMap { (elem: FlowConsoleFiles.FileAttributes) -> String? in
-        let name = elem[.name] as! String
-        // Skip "." and ".."?
-        if wildcard(name, pattern: sourceComponent) {
-          return name
+
+    var rootPath = components[..<firstWildcard].joined(separator: "/")
+    if rootPath.isEmpty {
+      rootPath = path.starts(with: "/") ? "/" : current
+    }
+    let glob = Glob(components[firstWildcard...].joined(separator: "/"))
+
+    return self.cloneWalkTo(rootPath)
+      .flatMap { root -> AnyPublisher<Translator, Error> in
+        guard let remote = root as? GlobTranslator else {
+          return root.listingMatches(glob)
         }
-        return nil
-      }.flatMap { name in
-        sourceRootTranslator!.cloneWalkTo(name).mapError { err in BlinkFilesError(errorDescription: "Could not walk to \(name)", originalError: err)}
+        return remote.expand(glob)
+          .catch { _ in root.listingMatches(glob) }
+          .eraseToAnyPublisher()
       }.eraseToAnyPublisher()
   }
 
-  fileprivate func wildcard(_ string: String, pattern: String) -> Bool {
-    let pred = NSPredicate(format: "self LIKE %@", pattern)
-    return !NSArray(object: string).filtered(using: pred).isEmpty
+  fileprivate func listingMatches(_ glob: Glob) -> AnyPublisher<Translator, Error> {
+    // Alternatives from braces may match the same items.
+    var seen = Set<String>()
+    return glob.alternatives.publisher
+      .setFailureType(to: Error.self)
+      .flatMap(maxPublishers: .max(1)) { self.listingMatches($0[...]) }
+      .filter { seen.insert($0.current).inserted }
+      .eraseToAnyPublisher()
+  }
+
+  fileprivate func listingMatches(_ segments: ArraySlice<Glob.Segment>) -> AnyPublisher<Translator, Error> {
+    guard let segment = segments.first else {
+      return .just(self)
+    }
+    guard self.isDirectory else {
+      return Empty().eraseToAnyPublisher()
+    }
+    let rest = segments.dropFirst()
+
+    switch segment {
+    case .literal(let name):
+      return self.cloneWalkTo(name)
+        .catch { _ in Empty<Translator, Error>() }
+        .flatMap { $0.listingMatches(rest) }
+        .eraseToAnyPublisher()
+    case .globstar:
+      // Matching here, and then the same from every directory below.
+      let below = listingNames { name, type in type == .typeDirectory && !name.starts(with: ".") }
+        .flatMap(maxPublishers: .max(1)) { $0.listingMatches(segments) }
+      return self.listingMatches(rest)
+        .append(below)
+        .eraseToAnyPublisher()
+    case .tokens(let tokens):
+      return listingNames { name, _ in Glob.match(tokens, Array(name.utf8)) }
+        .flatMap { $0.listingMatches(rest) }
+        .eraseToAnyPublisher()
+    }
+  }
+
+  // Translators for the entries in the directory that pass the filter.
+  fileprivate func listingNames(_ isIncluded: @escaping (String, FileAttributeType?) -> Bool) -> AnyPublisher<Translator, Error> {
+    directoryFilesAndAttributes()
+      .flatMap { $0.publisher.setFailureType(to: Error.self) }
+      .compactMap { attrs -> String? in
+        guard let name = attrs[.name] as? String,
+              name != ".", name != "..",
+              isIncluded(name, attrs[.type] as? FileAttributeType) else {
+          return nil
+        }
+        return name
+      }
+      .flatMap { name in
+        self.cloneWalkTo(name).mapError { err in BlinkFilesError(errorDescription: "Could not walk to \(name)", originalError: err) }
+      }.eraseToAnyPublisher()
   }
 }
 
@@ -81,57 +131,75 @@ extension Translator {
   public func directoryFilesAndAttributesResolvingLinks() -> AnyPublisher<[FileAttributes], Error> {
     directoryFilesAndAttributes()
       .flatMap { filesAttributes -> AnyPublisher<[FileAttributes], Never> in
-        filesAttributes.publisher
-          .flatMap { attrs -> AnyPublisher<FileAttributes, Never> in
-            guard let type = attrs[.type] as? FileAttributeType,
-                  let name = attrs[.name] as? String,
-                  type == .typeSymbolicLink else {
-              return .just(attrs)
-            }
-
-            return cloneWalkTo(name)
-              .flatMap { $0.stat()
-                           .map { attrs in
-                             // Resolve it but make sure the name is still the symlink, otherwise it will be the destination.
-                             var attrs = attrs
-                             attrs[.name] = name
-                             return attrs
-                           }
+        linkTargets(in: filesAttributes)
+          .map { targets in
+            filesAttributes.map { attrs -> FileAttributes in
+              guard let name = attrs[.name] as? String,
+                    var target = targets[name] else {
+                return attrs
               }
-              .catch { _ in Just(attrs) }
-              .eraseToAnyPublisher()
-          }.map { $0 }
-          .collect()
-          .eraseToAnyPublisher()
+              // Resolve it but make sure the name is still the symlink, otherwise it will be the destination.
+              target[.name] = name
+              return target
+            }
+          }.eraseToAnyPublisher()
       }.eraseToAnyPublisher()
   }
 
   public func directoryFilesAndAttributesWithTargetLinks() -> AnyPublisher<[FileAttributes], Error>  {
     directoryFilesAndAttributes()
       .flatMap { filesAttributes -> AnyPublisher<[FileAttributes], Never> in
-        filesAttributes.publisher
-          .flatMap { attrs -> AnyPublisher<FileAttributes, Never> in
-            guard let type = attrs[.type] as? FileAttributeType,
-                  let name = attrs[.name] as? String,
-                  type == .typeSymbolicLink else {
-              return .just(attrs)
+        linkTargets(in: filesAttributes)
+          .map { targets in
+            filesAttributes.map { attrs -> FileAttributes in
+              guard let name = attrs[.name] as? String,
+                    let target = targets[name] else {
+                return attrs
+              }
+              var attrs = attrs
+              attrs[.symbolicLinkTargetInfo] = target
+              return attrs
             }
+          }.eraseToAnyPublisher()
+      }.eraseToAnyPublisher()
+  }
 
-            return cloneWalkTo(name)
-              .flatMap {
-                $0.stat()
-                  .map { targetAttrs in
-                    var attrs = attrs
-                    attrs[.symbolicLinkTargetInfo] = targetAttrs
-                    return attrs
-                  }
-              }
-              .catch { _ in Just(attrs) }
-              .eraseToAnyPublisher()
-          }.map { $0 }
-          .collect()
+  // Attributes of what the links in the listing point to, by name. Broken links are left out.
+  // Translators that can batch the stats do it at once, instead of a walk and stat per link.
+  fileprivate func linkTargets(in filesAttributes: [FileAttributes]) -> AnyPublisher<[String: FileAttributes], Never> {
+    let links = filesAttributes.compactMap { attrs -> String? in
+      guard let type = attrs[.type] as? FileAttributeType,
+            let name = attrs[.name] as? String,
+            type == .typeSymbolicLink else {
+        return nil
+      }
+      return name
+    }
+    if links.isEmpty {
+      return .just([:])
+    }
+
+    guard let batch = self as? BatchStatTranslator else {
+      return statEachLink(links)
+    }
+    return batch.statTargets(of: links)
+      .catch { _ in self.statEachLink(links) }
+      .eraseToAnyPublisher()
+  }
+
+  fileprivate func statEachLink(_ links: [String]) -> AnyPublisher<[String: FileAttributes], Never> {
+    links.publisher
+      .flatMap { name -> AnyPublisher<(String, FileAttributes)?, Never> in
+        cloneWalkTo(name)
+          .flatMap { $0.stat() }
+          .map { (name, $0) }
+          .catch { _ in Just(nil) }
           .eraseToAnyPublisher()
-      }.eraseToAnyPublisher()
+      }
+      .compactMap { $0 }
+      .collect()
+      .map { Dictionary($0, uniquingKeysWith: { first, _ in first }) }
+      .eraseToAnyPublisher()
   }
 
   public func mkdir(name: String) -> AnyPublisher<Translator, Error> {
@@ -113,11 +113,15 @@ public struct CopyProgressInfo {
   public let name: String
   public let written: UInt64
   public let size: UInt64
+  // Time spent on the file outside of moving its data (creating, closing, protocol exchanges),
+  // for copiers that measure it.
+  public let overhead: TimeInterval
   
-  public init(name: String, written: UInt64, size: UInt64) {
+  public init(name: String, written: UInt64, size: UInt64, overhead: TimeInterval = 0) {
     self.name = name
     self.written = written
     self.size = size
+    self.overhead = overhead
   }
 }
 public typealias CopyProgressInfoPublisher = AnyPublisher<CopyProgressInfo, Error>
@@ -130,6 +134,64 @@ public protocol CopierTo {
   func copy(to ts: Translator) -> CopyProgressInfoPublisher
 }
 
+// Translators that can stat many entries at once, instead of a round trip per entry.
+public protocol BatchStatTranslator: Translator {
+  // Attributes of what the names in the current directory point to, following links.
+  // Names that cannot be resolved are left out.
+  func statTargets(of names: [String]) -> AnyPublisher<[String: FileAttributes], Error>
+}
+
+// Translators that can move a whole tree as one tar stream, instead of an operation per file.
+// Directory copies between them and Local go through it when the other side can run tar.
+public protocol TarTranslator: Translator {
+  func canStreamTar() -> AnyPublisher<Bool, Error>
+  // Writes a tar of the directory at current, rooted at its name.
+  func sendTar(to w: Writer) -> AnyPublisher<Void, Error>
+  // Extracts the tar written by the archiver into the directory at current.
+  func receiveTar(from archiver: WriterTo, args: CopyArguments) -> AnyPublisher<Void, Error>
+}
+
+// Translators that can expand a glob on their server, instead of listing a directory per level.
+public protocol GlobTranslator: Translator {
+  // Translators for the items under current matching the glob. Fails if the server cannot
+  // expand it, so it can be listed instead.
+  func expand(_ glob: Glob) -> AnyPublisher<Translator, Error>
+}
+
+// Translators that can report changes in their tree as they happen, instead of being listed again.
+public protocol WatchTranslator: Translator {
+  // Directories under current whose contents changed, as absolute paths. Current is sent first,
+  // once the watch is in place. Fails if the server cannot watch, or when the watch stops, so
+  // the tree can be polled instead.
+  func watchChanges() -> AnyPublisher<String, Error>
+}
+
+// Operations a server advertises that can be run on its side, without moving data through us.
+public struct ServerCapabilities: OptionSet {
+  public var rawValue: UInt
+
+  public static let copyData = ServerCapabilities(rawValue: 1 << 0)
+  // Renames replace an existing destination atomically.
+  public static let atomicRename = ServerCapabilities(rawValue: 1 << 1)
+  public static let statvfs = ServerCapabilities(rawValue: 1 << 2)
+  public static let hardlink = ServerCapabilities(rawValue: 1 << 3)
+  // Transfer sizes follow the ones advertised by the server.
+  public static let limits = ServerCapabilities(rawValue: 1 << 4)
+
+  public init(rawValue: UInt) {
+    self.rawValue = rawValue
+  }
+}
+
+public protocol ServerSideTranslator: Translator {
+  var capabilities: ServerCapabilities { get }
+  // Whether the Translator reaches the same server, so data can be moved between both without leaving it.
+  func sharesServer(with t: Translator) -> Bool
+  // Copies the file at t as name if we are a directory, or over current otherwise. Same as a regular
+  // copy, but data does not leave the server. Only with copyData, and if sharing the server with t.
+  func serverCopy(from t: Translator, name: String, size: NSNumber, attributes: FileAttributes) -> CopyProgressInfoPublisher
+}
+
 extension AnyPublisher {
   @inlinable public static func just(_ output: Output) -> Self {
     .init(Just(output).setFailureType(to: Failure.self))
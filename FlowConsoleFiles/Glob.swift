@@ -0,0 +1,336 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import Foundation
+
+// Shell style patterns, compiled once and matched on the UTF-8 bytes of names.
+// Supports *, ?, [...] classes with ranges and ! or ^ negation, {a,b} alternatives, and ** for any
+// number of directories. Backslash escapes the next character. As in the shell, names starting
+// with a dot are only matched explicitly, and . or .. never are.
+public struct Glob {
+  enum Token: Equatable {
+    case literal(UInt8)
+    // ?, a single character.
+    case any
+    case star
+    case set([ClosedRange<UInt32>], negated: Bool)
+  }
+
+  enum Segment: Equatable {
+    case globstar
+    // Names without wildcards, that can be walked to instead of listed.
+    case literal(String)
+    case tokens([Token])
+  }
+
+  public let pattern: String
+  // Patterns after expanding braces, split by directory. A path matches if any of them does.
+  let alternatives: [[Segment]]
+
+  public init(_ pattern: String) {
+    self.pattern = pattern
+    self.alternatives = Self.expandBraces(Array(pattern.utf8)).map { Self.compile($0) }
+  }
+
+  public static func hasMagic(_ pattern: String) -> Bool {
+    pattern.utf8.contains { $0 == .star || $0 == .question || $0 == .openBracket || $0 == .openBrace }
+  }
+
+  // Deepest a match can be, in directories from the root. Nil if it can be at any depth.
+  public var maxDepth: Int? {
+    var depth = 0
+    for segments in alternatives {
+      if segments.contains(.globstar) {
+        return nil
+      }
+      depth = max(depth, segments.count)
+    }
+    return depth
+  }
+
+  // Whether the path, relative to where the glob is expanded, matches.
+  public func matches(_ path: String) -> Bool {
+    let components = path.utf8.split(separator: .slash).map { Array($0) }
+    return alternatives.contains { Self.match($0[...], components[...]) }
+  }
+
+  static func match(_ segments: ArraySlice<Segment>, _ components: ArraySlice<[UInt8]>) -> Bool {
+    guard let segment = segments.first else {
+      return components.isEmpty
+    }
+    guard let component = components.first else {
+      // Only trailing globstars match nothing.
+      return segments.allSatisfy { $0 == .globstar }
+    }
+
+    switch segment {
+    case .globstar:
+      if match(segments.dropFirst(), components) {
+        return true
+      }
+      return component.first != .dot && match(segments, components.dropFirst())
+    case .literal(let name):
+      return Array(name.utf8) == component && match(segments.dropFirst(), components.dropFirst())
+    case .tokens(let tokens):
+      return match(tokens, component) && match(segments.dropFirst(), components.dropFirst())
+    }
+  }
+
+  // Single name against a segment. A star backtracks to the last one seen, so it is linear for
+  // patterns with a single star and does not recurse for more.
+  static func match(_ tokens: [Token], _ name: [UInt8]) -> Bool {
+    if name == [.dot] || name == [.dot, .dot] {
+      return false
+    }
+    if name.first == .dot && tokens.first != .literal(.dot) {
+      return false
+    }
+
+    var t = 0
+    var n = 0
+    var starToken = -1
+    var starName = 0
+    while n < name.count {
+      if t < tokens.count {
+        switch tokens[t] {
+        case .star:
+          starToken = t
+          starName = n
+          t += 1
+          continue
+        case .literal(let byte) where byte == name[n]:
+          t += 1
+          n += 1
+          continue
+        case .any:
+          t += 1
+          n += scalar(in: name, at: n).length
+          continue
+        case .set(let ranges, let negated):
+          let (value, length) = scalar(in: name, at: n)
+          if ranges.contains(where: { $0.contains(value) }) != negated {
+            t += 1
+            n += length
+            continue
+          }
+        default:
+          break
+        }
+      }
+      guard starToken >= 0 else {
+        return false
+      }
+      // Let the last star take one more character and try again from there.
+      starName += scalar(in: name, at: starName).length
+      n = starName
+      t = starToken + 1
+    }
+    while t < tokens.count && tokens[t] == .star {
+      t += 1
+    }
+    return t == tokens.count
+  }
+
+  // Unicode scalar starting at i, and its length in bytes. Invalid bytes stand for themselves.
+  static func scalar(in bytes: [UInt8], at i: Int) -> (value: UInt32, length: Int) {
+    let lead = bytes[i]
+    let length: Int
+    switch lead {
+    case 0xF0...0xF7: length = 4
+    case 0xE0...0xEF: length = 3
+    case 0xC0...0xDF: length = 2
+    default: return (UInt32(lead), 1)
+    }
+    guard i + length <= bytes.count else {
+      return (UInt32(lead), 1)
+    }
+    var value = UInt32(lead) & (0xFF >> (length + 1))
+    for byte in bytes[(i + 1)..<(i + length)] {
+      guard byte & 0xC0 == 0x80 else {
+        return (UInt32(lead), 1)
+      }
+      value = value << 6 | UInt32(byte & 0x3F)
+    }
+    return (value, length)
+  }
+
+  // a{b,c{d,e}} becomes ab, acd and ace. Braces without a comma, or unbalanced, are literal.
+  static func expandBraces(_ pattern: [UInt8]) -> [[UInt8]] {
+    var i = 0
+    while i < pattern.count {
+      if pattern[i] == .backslash {
+        i += 2
+        continue
+      }
+      if pattern[i] == .openBrace, let group = braceGroup(pattern, at: i), !group.commas.isEmpty {
+        let (close, commas) = group
+        let prefix = pattern[..<i]
+        let suffix = pattern[(close + 1)...]
+        let bounds = [i] + commas + [close]
+        return (0..<(bounds.count - 1)).flatMap { k in
+          expandBraces(Array(prefix + pattern[(bounds[k] + 1)..<bounds[k + 1]] + suffix))
+        }
+      }
+      i += 1
+    }
+    return [pattern]
+  }
+
+  // Closing brace and top level commas for the group opening at start.
+  private static func braceGroup(_ pattern: [UInt8], at start: Int) -> (close: Int, commas: [Int])? {
+    var depth = 0
+    var commas: [Int] = []
+    var j = start
+    while j < pattern.count {
+      switch pattern[j] {
+      case .backslash:
+        j += 1
+      case .openBrace:
+        depth += 1
+      case .closeBrace:
+        depth -= 1
+        if depth == 0 {
+          return (j, commas)
+        }
+      case .comma where depth == 1:
+        commas.append(j)
+      default:
+        break
+      }
+      j += 1
+    }
+    return nil
+  }
+
+  static func compile(_ pattern: [UInt8]) -> [Segment] {
+    var segments: [Segment] = []
+    for component in pattern.split(separator: .slash) {
+      let segment: Segment
+      if component.elementsEqual([.star, .star]) {
+        // Consecutive globstars match the same.
+        if segments.last == .globstar {
+          continue
+        }
+        segment = .globstar
+      } else {
+        let tokens = compileTokens(Array(component))
+        let literal = tokens.compactMap { token -> UInt8? in
+          if case .literal(let byte) = token {
+            return byte
+          }
+          return nil
+        }
+        segment = literal.count == tokens.count ? .literal(String(decoding: literal, as: UTF8.self)) : .tokens(tokens)
+      }
+      segments.append(segment)
+    }
+    return segments
+  }
+
+  private static func compileTokens(_ component: [UInt8]) -> [Token] {
+    var tokens: [Token] = []
+    var i = 0
+    while i < component.count {
+      let byte = component[i]
+      switch byte {
+      case .backslash where i + 1 < component.count:
+        tokens.append(.literal(component[i + 1]))
+        i += 2
+        continue
+      case .star:
+        if tokens.last != .star {
+          tokens.append(.star)
+        }
+      case .question:
+        tokens.append(.any)
+      case .openBracket:
+        if let set = compileSet(component, at: i) {
+          tokens.append(set.token)
+          i = set.end + 1
+          continue
+        }
+        tokens.append(.literal(byte))
+      default:
+        tokens.append(.literal(byte))
+      }
+      i += 1
+    }
+    return tokens
+  }
+
+  // Class opening at start, and where it closes. A ] right after the opening is a member.
+  private static func compileSet(_ component: [UInt8], at start: Int) -> (token: Token, end: Int)? {
+    var i = start + 1
+    var negated = false
+    if i < component.count && (component[i] == .exclamation || component[i] == .caret) {
+      negated = true
+      i += 1
+    }
+
+    var ranges: [ClosedRange<UInt32>] = []
+    var first = true
+    while i < component.count {
+      if component[i] == .closeBracket && !first {
+        return (.set(ranges, negated: negated), i)
+      }
+      first = false
+      if component[i] == .backslash && i + 1 < component.count {
+        i += 1
+      }
+      let (low, length) = scalar(in: component, at: i)
+      i += length
+      // A dash before the closing bracket is a member.
+      if i + 1 < component.count && component[i] == .dash && component[i + 1] != .closeBracket {
+        let (high, length) = scalar(in: component, at: i + 1)
+        i += 1 + length
+        if low <= high {
+          ranges.append(low...high)
+        }
+      } else {
+        ranges.append(low...low)
+      }
+    }
+    return nil
+  }
+}
+
+fileprivate extension UInt8 {
+  static let dot = UInt8(ascii: ".")
+  static let slash = UInt8(ascii: "/")
+  static let backslash = UInt8(ascii: "\\")
+  static let star = UInt8(ascii: "*")
+  static let question = UInt8(ascii: "?")
+  static let exclamation = UInt8(ascii: "!")
+  static let caret = UInt8(ascii: "^")
+  static let dash = UInt8(ascii: "-")
+  static let comma = UInt8(ascii: ",")
+  static let openBracket = UInt8(ascii: "[")
+  static let closeBracket = UInt8(ascii: "]")
+  static let openBrace = UInt8(ascii: "{")
+  static let closeBrace = UInt8(ascii: "}")
+}
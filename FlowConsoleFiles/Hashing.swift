@@ -0,0 +1,205 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import Foundation
+import Combine
+import CryptoKit
+
+public struct HashError: Error {
+  public let msg: String
+  public var description: String {
+    return msg
+  }
+}
+
+public enum HashAlgorithm: String, CaseIterable {
+  case sha256
+  case blake3
+
+  // Command that prints "digest  path" lines, like coreutils, on a remote.
+  public var command: String {
+    switch self {
+    case .sha256: return "sha256sum"
+    case .blake3: return "b3sum"
+    }
+  }
+
+  // Only SHA-256 can be computed here. Others need both sides to hash remotely.
+  public var hashesLocally: Bool { self == .sha256 }
+}
+
+// Translators that can hash their files on the server, without moving the data.
+public protocol HashTranslator: Translator {
+  func canHash(using algorithm: HashAlgorithm) -> AnyPublisher<Bool, Error>
+  // Digests of the regular files at current, or under it, by path relative to it.
+  // A file at current is under the empty path.
+  func remoteDigests(using algorithm: HashAlgorithm) -> AnyPublisher<[String: String], Error>
+}
+
+// Digests of whole trees. Files are hashed by the server when it can, or streamed here otherwise,
+// with several of them in flight at once so hashing is not bound to a single core or a single read.
+public final class FileHasher {
+  public let algorithm: HashAlgorithm
+  // Files hashed at a time. A file is hashed in order, so parallelism comes across files.
+  public let maxConcurrentFiles: Int
+  // Every file hashes on its own serial queue, targeting this one, so they spread across cores.
+  private let queue = DispatchQueue(label: "FileHasher", qos: .utility, attributes: .concurrent)
+
+  public init(algorithm: HashAlgorithm = .sha256,
+              maxConcurrentFiles: Int = ProcessInfo.processInfo.activeProcessorCount * 2) {
+    self.algorithm = algorithm
+    self.maxConcurrentFiles = maxConcurrentFiles
+  }
+
+  // Digests of the regular files at t, or under it, by path relative to it. Hex encoded.
+  public func digests(of t: Translator) -> AnyPublisher<[String: String], Error> {
+    guard let remote = t as? HashTranslator else {
+      return localDigests(of: t)
+    }
+
+    return remote.canHash(using: algorithm)
+      .flatMap { canHash -> AnyPublisher<[String: String], Error> in
+        canHash ? remote.remoteDigests(using: self.algorithm) : self.localDigests(of: t)
+      }.eraseToAnyPublisher()
+  }
+
+  private func localDigests(of t: Translator) -> AnyPublisher<[String: String], Error> {
+    guard algorithm.hashesLocally else {
+      return .fail(error: HashError(msg: "\(algorithm.command) not available for \(t.current)"))
+    }
+
+    return files(at: t, path: "")
+      .flatMap(maxPublishers: .max(maxConcurrentFiles)) { (path, file) in
+        self.digest(of: file).map { (path, $0) }
+      }
+      .reduce([String: String]()) { digests, file in
+        var digests = digests
+        digests[file.0] = file.1
+        return digests
+      }
+      .eraseToAnyPublisher()
+  }
+
+  private func files(at t: Translator, path: String) -> AnyPublisher<(String, Translator), Error> {
+    guard t.isDirectory else {
+      return .just((path, t))
+    }
+
+    return t.directoryFilesAndAttributes()
+      .flatMap { $0.publisher.setFailureType(to: Error.self) }
+      .flatMap { attrs -> AnyPublisher<(String, Translator), Error> in
+        guard let name = attrs[.name] as? String, name != ".", name != "..",
+              let type = attrs[.type] as? FileAttributeType,
+              type == .typeRegular || type == .typeDirectory else {
+          return Empty().eraseToAnyPublisher()
+        }
+        let childPath = path.isEmpty ? name : "\(path)/\(name)"
+        return t.cloneWalkTo(name)
+          .flatMap { self.files(at: $0, path: childPath) }
+          .eraseToAnyPublisher()
+      }.eraseToAnyPublisher()
+  }
+
+  // Chunks come in order, with the reader keeping its read ahead while the last one is hashed.
+  private func digest(of t: Translator) -> AnyPublisher<String, Error> {
+    let fileQueue = DispatchQueue(label: "FileHasher-\(t.current)", target: queue)
+
+    return t.open(flags: O_RDONLY)
+      .flatMap { file in
+        file.read(max: SSIZE_MAX)
+          .receive(on: fileQueue)
+          .reduce(SHA256()) { hasher, data in
+            var hasher = hasher
+            data.regions.forEach { region in
+              region.withUnsafeBytes { (bytes: UnsafePointer<UInt8>) in
+                hasher.update(bufferPointer: UnsafeRawBufferPointer(start: bytes, count: region.count))
+              }
+            }
+            return hasher
+          }
+          .map { Self.hex($0.finalize()) }
+          .flatMap { digest in file.close().map { _ in digest } }
+      }.eraseToAnyPublisher()
+  }
+
+  static func hex<D: Sequence>(_ digest: D) -> String where D.Element == UInt8 {
+    digest.map { String(format: "%02x", $0) }.joined()
+  }
+
+  // Digests as printed by sha256sum and b3sum, by path relative to the directory they ran in.
+  // Names with newlines or backslashes are escaped, with the line starting with a backslash.
+  public static func parseDigests(_ output: String) -> [String: String] {
+    var digests: [String: String] = [:]
+    for var line in output.split(separator: "\n") {
+      let escaped = line.first == "\\"
+      if escaped {
+        line = line.dropFirst()
+      }
+      guard let separator = line.range(of: "  ") else {
+        continue
+      }
+      let digest = String(line[..<separator.lowerBound])
+      var path = String(line[separator.upperBound...])
+      if escaped {
+        path = path.replacingOccurrences(of: "\\\\", with: "\u{0}")
+          .replacingOccurrences(of: "\\n", with: "\n")
+          .replacingOccurrences(of: "\u{0}", with: "\\")
+      }
+      if path.hasPrefix("./") {
+        path.removeFirst(2)
+      }
+      digests[path] = digest
+    }
+    return digests
+  }
+}
+
+// Differences between two trees, by path relative to their roots.
+public struct HashComparison {
+  public let matching: Int
+  public let different: [String]
+  public let missing: [String]
+
+  public init(source: [String: String], destination: [String: String]) {
+    var matching = 0
+    var different: [String] = []
+    var missing: [String] = []
+    for (path, digest) in source {
+      switch destination[path] {
+      case .none: missing.append(path)
+      case .some(digest): matching += 1
+      default: different.append(path)
+      }
+    }
+    self.matching = matching
+    self.different = different.sorted()
+    self.missing = missing.sorted()
+  }
+
+  public var isMatching: Bool { different.isEmpty && missing.isEmpty }
+}
@@ -263,12 +263,89 @@ public class Local : Translator {
   }
 }
 
+extension Local {
+  // Local to local copies stay in the kernel. On APFS the file is cloned and shares its
+  // blocks with the source, otherwise copyfile moves the data while skipping holes.
+  // Only the progress is reported, as there are no blocks going through us.
+  func copyFile(from t: Local, name: String, size: NSNumber, attributes: FileAttributes) -> CopyProgressInfoPublisher {
+    let src = t.current
+    let dst = isDirectory ? (current as NSString).appendingPathComponent(name) : current
+
+    return Deferred {
+      Future<Void, Error> { promise in
+        Local.queue.async {
+          promise(Result { try Local.copyItem(at: src, to: dst, attributes: attributes) })
+        }
+      }
+    }
+    .flatMap { _ -> CopyProgressInfoPublisher in
+      [CopyProgressInfo(name: dst, written: size.uint64Value, size: size.uint64Value),
+       CopyProgressInfo(name: dst, written: 0, size: size.uint64Value)]
+        .publisher.setFailureType(to: Error.self).eraseToAnyPublisher()
+    }
+    .eraseToAnyPublisher()
+  }
+
+  static func copyItem(at src: String, to dst: String, attributes: FileAttributes) throws {
+    let existing = try? files.attributesOfItem(atPath: dst)
+
+    // The clone cannot replace a file, so clone next to it and move it over.
+    let tmp = ((dst as NSString).deletingLastPathComponent as NSString)
+      .appendingPathComponent(".\((dst as NSString).lastPathComponent).\(UUID().uuidString)")
+    if clonefile(src, tmp, 0) == 0 {
+      if rename(tmp, dst) != 0 {
+        let err = errno
+        unlink(tmp)
+        throw LocalFileError(msg: "Could not copy file. \(String(cString: strerror(err)))")
+      }
+    } else {
+      // Different volume, or a filesystem without clones.
+      let srcFd = Darwin.open(src, O_RDONLY)
+      guard srcFd >= 0 else {
+        throw LocalFileError(msg: "Could not open file. \(String(cString: strerror(errno)))")
+      }
+      defer { Darwin.close(srcFd) }
+      let dstFd = Darwin.open(dst, O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU)
+      guard dstFd >= 0 else {
+        throw LocalFileError(msg: "Could not create file. \(String(cString: strerror(errno)))")
+      }
+      defer { Darwin.close(dstFd) }
+      if fcopyfile(srcFd, dstFd, nil, copyfile_flags_t(COPYFILE_DATA | COPYFILE_DATA_SPARSE)) != 0 {
+        throw LocalFileError(msg: "Could not copy file. \(String(cString: strerror(errno)))")
+      }
+    }
+
+    // The clone carries all the attributes of the source. Leave the file as the regular
+    // copy would: what was asked to preserve, and otherwise those of a new or truncated file.
+    var attrs = attributes
+    if attrs[.posixPermissions] == nil {
+      attrs[.posixPermissions] = existing?[.posixPermissions] ?? NSNumber(value: S_IRWXU)
+    }
+    if attrs[.modificationDate] == nil {
+      attrs[.modificationDate] = Date()
+    }
+    if attrs[.creationDate] == nil {
+      attrs[.creationDate] = existing?[.creationDate] ?? Date()
+    }
+    do {
+      try files.setAttributes(attrs, ofItemAtPath: dst)
+    } catch {
+      throw LocalFileError(msg: "Cannot change attributes of file. \(error.localizedDescription)")
+    }
+  }
+}
+
 public class LocalFile : File {
   let channel: DispatchIO
   let fd: Int32
   let blockSize = 1024 * 1024
   var offset: Int64 = 0
   let queue: DispatchQueue
+  // Chunks read ahead of the demand.
+  public var readAheadDepth = 4
+  // Serve read(at:) from a memory map instead of reading every time.
+  public var mapsForRandomReads = false
+  private var map: LocalFileMap?
 
   init(at path: String, flags: Int32) throws {
     // Not sure if this can be nil, while errno is not
@@ -307,144 +384,195 @@ public class LocalFile : File {
 }
 
 extension LocalFile: Reader, WriterTo {
-  // Lock once the demand has been satistied, and unlock once there is new demand
-  // If demand is unlimited, you will never lock.
+  // Chunks are delivered as they are demanded, with readAheadDepth of them read ahead.
   public func read(max length: Int) -> AnyPublisher<DispatchData, Error> {
-    return readLoop(max: length)
-      .reduce(DispatchData.empty) { prevValue, newValue -> DispatchData in
-        var n = prevValue
-        n.append(newValue)
-        return n
-      }.eraseToAnyPublisher()
+    return LocalFileReader(self, from: offset, length: length) { self.offset += Int64($0) }
+      .publisher
+  }
+
+  // Reads at any offset, without moving the file offset.
+  public func read(at offset: off_t, max length: Int) -> AnyPublisher<DispatchData, Error> {
+    guard mapsForRandomReads else {
+      return LocalFileReader(self, from: offset, length: length).publisher
+    }
+
+    return Just(offset).tryMap { offset -> DispatchData in
+      let map = try self.queue.sync { () -> LocalFileMap in
+        if let map = self.map {
+          return map
+        }
+        let map = try LocalFileMap(fd: self.fd)
+        self.map = map
+        return map
+      }
+      return map.data(at: Int(offset), length: length)
+    }.eraseToAnyPublisher()
   }
 
   public func writeTo(_ w: Writer) -> AnyPublisher<Int, Error> {
-    // TODO It blocks with big files, and it may block with the Dispatch streams too
-    // A new block may be received, before the readLoop goes to send downstream.
-    // The new block will block the queue, and hence it will never go down.
-    // We cannot just simply remove the semaphore, because then the EOF may be received before all other
-    // operations are even processed.
-    return readLoop(max: SSIZE_MAX)
-      .print("writing to...")
+    // Only one write at a time. The reader stops once its read ahead is full,
+    // so a slow writer does not pile the file up in memory.
+    return read(max: SSIZE_MAX)
       .flatMap(maxPublishers: .max(1)) { data in
         return w.write(data, max: data.count)
       }.eraseToAnyPublisher()
   }
+}
 
-  func readLoop(max length: Int) -> AnyPublisher<DispatchData, Error> {
-    let io = self.channel
-    let subj = PassthroughSubject<DispatchData, Error>()
+// Reads a range of the file in chunks, one per unit of demand. Up to depth chunks are read
+// or kept ahead of the demand, so the disk is busy while the last one is processed, but memory
+// stays at chunkSize * depth for any file size. All state is handled on the queue of the file.
+final class LocalFileReader {
+  private final class Slot {
+    let length: Int
+    var data = DispatchData.empty
+    var isComplete = false
+
+    init(length: Int) {
+      self.length = length
+    }
+  }
 
-    var sema: DispatchSemaphore? = nil
+  private let file: LocalFile
+  private let subject = PassthroughSubject<DispatchData, Error>()
+  private let onDeliver: ((Int) -> Void)?
+  private var slots: [Slot] = []
+  private var nextOffset: off_t
+  private var remaining: Int
+  private var demand: Subscribers.Demand = .none
+  private var reachedEOF = false
+  private var isDone = false
+
+  init(_ file: LocalFile, from offset: off_t, length: Int, onDeliver: ((Int) -> Void)? = nil) {
+    self.file = file
+    self.nextOffset = offset
+    self.remaining = length
+    self.onDeliver = onDeliver
+  }
 
-    func wakeThread() {
-      // .signal() returns non-zero if a thread is woken. Otherwise, zero is returned.
-      while sema?.signal() == 0 { }
-    }
+  var publisher: AnyPublisher<DispatchData, Error> {
+    let queue = file.queue
+    return subject.handleEvents(
+      receiveCancel: { queue.async { self.cancel() } },
+      receiveRequest: { demand in queue.async { self.request(demand) } }
+    ).eraseToAnyPublisher()
+  }
 
-    var canceled = false
-    func onCancel() {
-      canceled = true
-      io.close(flags: .stop)
-      wakeThread()
+  private func request(_ demand: Subscribers.Demand) {
+    guard !isDone else {
+      return
     }
+    self.demand += demand
+    pump()
+  }
 
-    func ioHandler(_ done: Bool, data: DispatchData?, err: Int32) {
-      // termination events are sent without demand
-      // https://developer.apple.com/documentation/dispatch/dispatchio/1780666-close
-      if err == POSIXErrorCode.ECANCELED.rawValue {
-        return
-      }
+  private func cancel() {
+    // Reads in flight finish on their own and are dropped.
+    isDone = true
+    slots = []
+  }
 
-      if err != 0 {
-        let e = NSError(domain: NSPOSIXErrorDomain, code: Int(err), userInfo: nil)
-        subj.send(completion: .failure(LocalFileError(msg: "Error reading file: \(e.localizedDescription)")))
-        return
+  private func pump() {
+    while let head = slots.first, head.isComplete {
+      // Chunks past the end of the file come back empty and do not need demand.
+      if head.data.isEmpty {
+        slots.removeFirst()
+        continue
       }
-
-      // guard err == noErr else {
-      //     if err != POSIXErrorCode.ECANCELED.rawValue  {
-      //         subj.send(completion: .failure(.unknown))
-      //     }
-      //     return
-      // }
-
-      guard let data = data else {
-        return assertionFailure()
+      guard demand > 0 else {
+        break
       }
+      slots.removeFirst()
+      demand -= 1
+      onDeliver?(head.data.count)
+      subject.send(head.data)
+    }
 
-      offset += Int64(data.count)
-      // done and data.count == 0 is indicator of EOF with no more data, so finish.
-      let eof = done && data.count == 0
-      guard !eof else {
-        print("Completed - EOF")
-        return subj.send(completion: .finished)
-      }
+    if (reachedEOF || remaining == 0) && slots.isEmpty {
+      isDone = true
+      subject.send(completion: .finished)
+      return
+    }
 
-      print("Sending \(data.count)")
-      subj.send(data)
+    while !reachedEOF && remaining > 0 && slots.count < file.readAheadDepth {
+      startRead()
+    }
+  }
 
-      if done && offset == length {
-        print("Completed")
-        return subj.send(completion: .finished)
-      }
+  private func startRead() {
+    let slot = Slot(length: min(file.blockSize, remaining))
+    let offset = nextOffset
+    nextOffset += off_t(slot.length)
+    remaining -= slot.length
+    slots.append(slot)
 
-      print("Awaiting semaphore...")
-      sema?.wait()
-      guard !canceled else {
+    file.channel.read(offset: offset, length: slot.length, queue: file.queue) { (done, data, err) in
+      // Termination events are sent without demand
+      // https://developer.apple.com/documentation/dispatch/dispatchio/1780666-close
+      guard !self.isDone, err != POSIXErrorCode.ECANCELED.rawValue else {
         return
       }
-    }
 
-    func applyDemand(demand: Subscribers.Demand) {
-      print("Received demand")
-      if demand == Subscribers.Demand.unlimited {
-        sema = nil
+      if err != 0 {
+        let e = NSError(domain: NSPOSIXErrorDomain, code: Int(err), userInfo: nil)
+        self.isDone = true
+        self.slots = []
+        self.subject.send(completion: .failure(LocalFileError(msg: "Error reading file: \(e.localizedDescription)")))
         return
       }
 
-      let limit = demand.max!
-
-      if sema == nil {
-        // If we initiate the semaphore with a specific value, it has to be balanced to that value, and that is complicated.
-        // So start with 0 and work from there.
-        // https://lists.apple.com/archives/cocoa-dev/2014/Apr/msg00484.html
-        sema = DispatchSemaphore(value: limit - 1)
-      } else {
-        // increment currentSema by new limit
-        for _ in 0..<limit  {
-          print("New signals")
-          sema!.signal()
+      if let data = data {
+        slot.data.append(data)
+      }
+      if done {
+        slot.isComplete = true
+        if slot.data.count < slot.length {
+          self.reachedEOF = true
         }
+        self.pump()
       }
     }
+  }
+}
 
-    var offset: off_t = 0
-    func onRequest(_ demand: Subscribers.Demand) {
-      // Create a semaphore if necessary for the specified demand
-      // No demand, no scheduling.
-      // Switch between max and defined, defined to max.
-      if demand == Subscribers.Demand.none {
-        return
-      }
+// Memory map of a file, for random reads served straight from the page cache. The file is
+// expected not to change size while mapped. It is unmapped once no data from it is alive.
+final class LocalFileMap {
+  let base: UnsafeMutableRawPointer?
+  let size: Int
+
+  init(fd: Int32) throws {
+    var st = stat()
+    guard fstat(fd, &st) == 0 else {
+      throw LocalFileError(msg: "Could not map file. \(String(cString: strerror(errno)))")
+    }
+    self.size = Int(st.st_size)
+    guard size > 0 else {
+      self.base = nil
+      return
+    }
 
-      applyDemand(demand: demand)
+    let ptr = mmap(nil, size, PROT_READ, MAP_PRIVATE, fd, 0)
+    guard let ptr = ptr, ptr != MAP_FAILED else {
+      throw LocalFileError(msg: "Could not map file. \(String(cString: strerror(errno)))")
+    }
+    madvise(ptr, size, MADV_RANDOM)
+    self.base = ptr
+  }
 
-      if demand == Subscribers.Demand.unlimited {
-        // NOTE Unlimited read is memory heavy. Dispatch will load as much as it can in memory,
-        // independently of high - low water marks.
-        io.read(offset: 0, length: length, queue: self.queue, ioHandler: ioHandler)
-      } else {
-        // blockSize is coincidental with the demand, as we have set that value as the lower water mark.
-        io.read(offset: offset, length: blockSize, queue: self.queue, ioHandler: ioHandler)
-      }
+  func data(at offset: Int, length: Int) -> DispatchData {
+    guard let base = base, offset < size else {
+      return .empty
     }
+    let count = min(length, size - offset)
+    return DispatchData(bytesNoCopy: UnsafeRawBufferPointer(start: base + offset, count: count),
+                        deallocator: .custom(nil, { withExtendedLifetime(self) {} }))
+  }
 
-    // Put a buffer just in case the semaphore lifts the thread before the subject has received the demand.
-    return subj.buffer(size: 1, prefetch: .byRequest, whenFull: .customError({LocalFileError(msg: "Buffer full")})).handleEvents(
-      receiveCancel: onCancel,
-      receiveRequest: onRequest
-    ).eraseToAnyPublisher()
+  deinit {
+    if let base = base {
+      munmap(base, size)
+    }
   }
 }
 
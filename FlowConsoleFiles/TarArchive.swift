@@ -0,0 +1,660 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import Foundation
+import Combine
+
+public struct TarError: Error {
+  public let msg: String
+  public var description: String {
+    return msg
+  }
+}
+
+// ustar header, with the pax records GNU and BSD tar use for long names and large sizes.
+struct TarHeader {
+  static let blockSize = 512
+
+  enum Kind: UInt8 {
+    case file = 0x30          // "0"
+    case symlink = 0x32       // "2"
+    case directory = 0x35     // "5"
+    case paxHeader = 0x78     // "x"
+    case paxGlobal = 0x67     // "g"
+    case gnuLongName = 0x4C   // "L"
+    case gnuLongLink = 0x4B   // "K"
+  }
+
+  var path: String
+  var type: UInt8
+  var size: UInt64
+  var mode: UInt32
+  var mtime: TimeInterval
+  var linkName: String = ""
+
+  var kind: Kind? {
+    // Old archives use NUL for regular files, and "7" for contiguous ones.
+    if type == 0 || type == 0x37 {
+      return .file
+    }
+    return Kind(rawValue: type)
+  }
+
+  // The header block, preceded by a pax header when a field does not fit.
+  func encoded() -> Data {
+    var records = ""
+    if path.utf8.count > 100 {
+      records += Self.paxRecord("path", path)
+    }
+    if linkName.utf8.count > 100 {
+      records += Self.paxRecord("linkpath", linkName)
+    }
+    if size > 0o77777777777 {
+      records += Self.paxRecord("size", String(size))
+    }
+
+    var data = Data()
+    if !records.isEmpty {
+      let body = Data(records.utf8)
+      let pax = TarHeader(path: "PaxHeader", type: Kind.paxHeader.rawValue,
+                          size: UInt64(body.count), mode: 0o644, mtime: mtime)
+      data += pax.block()
+      data += body
+      data += Self.padding(for: UInt64(body.count))
+    }
+    data += block()
+    return data
+  }
+
+  private func block() -> Data {
+    var block = Data(count: Self.blockSize)
+    Self.put(path, in: &block, at: 0, length: 100)
+    Self.put(Self.octal(UInt64(mode & 0o7777), digits: 7), in: &block, at: 100, length: 8)
+    Self.put(Self.octal(0, digits: 7), in: &block, at: 108, length: 8)
+    Self.put(Self.octal(0, digits: 7), in: &block, at: 116, length: 8)
+    Self.put(Self.octal(min(size, 0o77777777777), digits: 11), in: &block, at: 124, length: 12)
+    Self.put(Self.octal(UInt64(max(mtime, 0)), digits: 11), in: &block, at: 136, length: 12)
+    block[156] = type
+    Self.put(linkName, in: &block, at: 157, length: 100)
+    Self.put("ustar\0" + "00", in: &block, at: 257, length: 8)
+
+    // The checksum is computed with its own field as spaces.
+    block.replaceSubrange(148..<156, with: [UInt8](repeating: 0x20, count: 8))
+    let sum = block.reduce(0) { $0 + UInt64($1) }
+    Self.put(Self.octal(sum, digits: 6) + "\0 ", in: &block, at: 148, length: 8)
+    return block
+  }
+
+  // nil for the zero blocks at the end of the archive.
+  static func parse(_ block: Data) throws -> TarHeader? {
+    let b = [UInt8](block.prefix(blockSize))
+    if b.allSatisfy({ $0 == 0 }) {
+      return nil
+    }
+
+    var check = b
+    check.replaceSubrange(148..<156, with: [UInt8](repeating: 0x20, count: 8))
+    guard number(b[148..<156]) == check.reduce(0, { $0 + UInt64($1) }) else {
+      throw TarError(msg: "Invalid tar header checksum.")
+    }
+
+    var path = string(b[0..<100])
+    let prefix = string(b[345..<500])
+    if string(b[257..<262]) == "ustar" && !prefix.isEmpty {
+      path = prefix + "/" + path
+    }
+    return TarHeader(path: path,
+                     type: b[156],
+                     size: number(b[124..<136]),
+                     mode: UInt32(truncatingIfNeeded: number(b[100..<108])),
+                     mtime: TimeInterval(number(b[136..<148])),
+                     linkName: string(b[157..<257]))
+  }
+
+  // Records of a pax header, "<length> <key>=<value>\n".
+  static func parsePax(_ data: Data) throws -> [String: String] {
+    var records: [String: String] = [:]
+    var rest = data[...]
+    while let space = rest.firstIndex(of: 0x20),
+          let length = Int(String(decoding: rest[rest.startIndex..<space], as: UTF8.self)),
+          length > 0, rest.count >= length {
+      // The length covers itself, the space and the newline.
+      guard length > rest.distance(from: rest.startIndex, to: space) + 1 else {
+        throw TarError(msg: "Invalid pax header record.")
+      }
+      let record = rest[rest.index(after: space)..<(rest.startIndex + length - 1)]
+      if let eq = record.firstIndex(of: 0x3D) {
+        let key = String(decoding: record[record.startIndex..<eq], as: UTF8.self)
+        records[key] = String(decoding: record[record.index(after: eq)...], as: UTF8.self)
+      }
+      rest = rest[(rest.startIndex + length)...]
+    }
+    return records
+  }
+
+  static func padding(for size: UInt64) -> Data {
+    let rem = Int(size % UInt64(blockSize))
+    return rem == 0 ? Data() : Data(count: blockSize - rem)
+  }
+
+  static func paxRecord(_ key: String, _ value: String) -> String {
+    let body = " \(key)=\(value)\n"
+    var length = body.utf8.count + 1
+    while String(length).count + body.utf8.count != length {
+      length = String(length).count + body.utf8.count
+    }
+    return "\(length)\(body)"
+  }
+
+  private static func octal(_ value: UInt64, digits: Int) -> String {
+    let s = String(value, radix: 8)
+    return String(repeating: "0", count: max(digits - s.count, 0)) + s
+  }
+
+  private static func put(_ s: String, in block: inout Data, at offset: Int, length: Int) {
+    let bytes = Array(s.utf8.prefix(length))
+    block.replaceSubrange(offset..<(offset + bytes.count), with: bytes)
+  }
+
+  private static func string(_ bytes: ArraySlice<UInt8>) -> String {
+    let end = bytes.firstIndex(of: 0) ?? bytes.endIndex
+    return String(decoding: bytes[bytes.startIndex..<end], as: UTF8.self)
+  }
+
+  private static func number(_ bytes: ArraySlice<UInt8>) -> UInt64 {
+    // GNU base-256 for values that do not fit in octal.
+    if let first = bytes.first, first & 0x80 != 0 {
+      return bytes.dropFirst().reduce(UInt64(first & 0x7F)) { ($0 << 8) | UInt64($1) }
+    }
+    let digits = bytes.drop { $0 == 0x20 }.prefix { $0 >= 0x30 && $0 <= 0x37 }
+    return digits.reduce(0) { ($0 << 3) | UInt64($1 - 0x30) }
+  }
+}
+
+// Streams a tar of a local tree, rooted at its name. Files are read as the writer asks for
+// more, so memory stays at one chunk whatever the size of the tree.
+public final class TarArchiver: WriterTo {
+  let parent: String
+  let name: String
+  let chunkSize = 256 * 1024
+  let progress: (CopyProgressInfo) -> Void
+
+  public init(at path: String, progress: @escaping (CopyProgressInfo) -> Void = { _ in }) {
+    self.parent = (path as NSString).deletingLastPathComponent
+    self.name = (path as NSString).lastPathComponent
+    self.progress = progress
+  }
+
+  public func writeTo(_ w: Writer) -> AnyPublisher<Int, Error> {
+    return AnySequence { TarArchiveIterator(self) }
+      .publisher
+      .tryMap { try $0.get() }
+      .flatMap(maxPublishers: .max(1)) { data in
+        w.write(data, max: data.count)
+      }.eraseToAnyPublisher()
+  }
+}
+
+fileprivate final class TarArchiveIterator: IteratorProtocol {
+  let archiver: TarArchiver
+  var entries: [String]
+  let enumerator: FileManager.DirectoryEnumerator?
+  var file: (fd: Int32, path: String, size: UInt64, remaining: UInt64)? = nil
+  var finished = false
+
+  init(_ archiver: TarArchiver) {
+    self.archiver = archiver
+    let root = (archiver.parent as NSString).appendingPathComponent(archiver.name)
+    self.entries = [archiver.name]
+    self.enumerator = FileManager.default.enumerator(atPath: root)
+  }
+
+  deinit {
+    if let file = file {
+      Darwin.close(file.fd)
+    }
+  }
+
+  func next() -> Result<DispatchData, Error>? {
+    do {
+      if file != nil {
+        return .success(try readFile())
+      }
+      while let entry = nextEntry() {
+        if let header = try header(for: entry) {
+          return .success(header)
+        }
+      }
+      guard !finished else {
+        return nil
+      }
+      finished = true
+      return .success(Self.dispatchData(Data(count: TarHeader.blockSize * 2)))
+    } catch {
+      finished = true
+      return .failure(error)
+    }
+  }
+
+  private func nextEntry() -> String? {
+    if !entries.isEmpty {
+      return entries.removeFirst()
+    }
+    guard let relative = enumerator?.nextObject() as? String else {
+      return nil
+    }
+    return (archiver.name as NSString).appendingPathComponent(relative)
+  }
+
+  private func header(for entry: String) throws -> DispatchData? {
+    let path = (archiver.parent as NSString).appendingPathComponent(entry)
+    var st = stat()
+    guard lstat(path, &st) == 0 else {
+      throw TarError(msg: "Could not stat \(path). \(String(cString: strerror(errno)))")
+    }
+
+    var header = TarHeader(path: entry, type: TarHeader.Kind.file.rawValue, size: 0,
+                           mode: UInt32(st.st_mode), mtime: TimeInterval(st.st_mtimespec.tv_sec))
+    switch st.st_mode & S_IFMT {
+    case S_IFDIR:
+      header.type = TarHeader.Kind.directory.rawValue
+      header.path += "/"
+    case S_IFLNK:
+      header.type = TarHeader.Kind.symlink.rawValue
+      header.linkName = try FileManager.default.destinationOfSymbolicLink(atPath: path)
+    case S_IFREG:
+      let fd = Darwin.open(path, O_RDONLY)
+      guard fd >= 0 else {
+        throw TarError(msg: "Could not open \(path). \(String(cString: strerror(errno)))")
+      }
+      header.size = UInt64(st.st_size)
+      file = (fd, path, header.size, header.size)
+      if header.size == 0 {
+        closeFile()
+      }
+    default:
+      // Sockets, devices and such do not travel.
+      return nil
+    }
+    return Self.dispatchData(header.encoded())
+  }
+
+  private func readFile() throws -> DispatchData {
+    guard let f = file else {
+      return .empty
+    }
+    let length = Int(min(UInt64(archiver.chunkSize), f.remaining))
+    var data = Data(count: length)
+    let read = data.withUnsafeMutableBytes { Darwin.read(f.fd, $0.baseAddress, length) }
+    guard read == length else {
+      // Files cannot change size once their header is out.
+      throw TarError(msg: "Could not read \(f.path). File changed while archiving.")
+    }
+    file!.remaining -= UInt64(length)
+    archiver.progress(CopyProgressInfo(name: f.path, written: UInt64(length), size: f.size))
+    if file!.remaining == 0 {
+      data += TarHeader.padding(for: f.size)
+      closeFile()
+    }
+    return Self.dispatchData(data)
+  }
+
+  private func closeFile() {
+    guard let f = file else {
+      return
+    }
+    Darwin.close(f.fd)
+    file = nil
+    archiver.progress(CopyProgressInfo(name: f.path, written: 0, size: f.size))
+  }
+
+  static func dispatchData(_ data: Data) -> DispatchData {
+    data.withUnsafeBytes { DispatchData(bytes: $0) }
+  }
+}
+
+// Extracts a tar stream into a local directory as it is written. Entries cannot escape the
+// directory, and attributes are applied following what the copy was asked to preserve.
+public final class TarExtractor: Writer {
+  private enum State {
+    case header
+    case file(fd: Int32, path: String, size: UInt64, remaining: UInt64, mode: UInt32, mtime: TimeInterval)
+    case collect(kind: TarHeader.Kind, remaining: UInt64, data: Data)
+    case skip(remaining: UInt64)
+    case end
+  }
+
+  let root: String
+  let preserve: CopyAttributesFlag
+  let progress: (CopyProgressInfo) -> Void
+  private let queue = DispatchQueue(label: "TarExtractor")
+  private var pending = Data()
+  private var state: State = .header
+  private var overrides: [String: String] = [:]
+  private var padding = 0
+  // Links and directory modes are applied once the tree is written, so that no entry is written
+  // through a link from the archive, and read-only directories can still be filled.
+  private var links: [(path: String, target: String)] = []
+  private var directoryModes: [(path: String, mode: mode_t)] = []
+  // Directories checked not to be links.
+  private var verifiedDirectories = Set<String>()
+
+  public init(into root: String, preserve: CopyAttributesFlag,
+              progress: @escaping (CopyProgressInfo) -> Void = { _ in }) {
+    self.root = root
+    self.preserve = preserve
+    self.progress = progress
+  }
+
+  deinit {
+    if case let .file(fd, _, _, _, _, _) = state {
+      Darwin.close(fd)
+    }
+  }
+
+  public func write(_ buf: DispatchData, max length: Int) -> AnyPublisher<Int, Error> {
+    return Deferred {
+      Future { promise in
+        self.queue.async {
+          promise(Result {
+            try self.consume(buf)
+            return buf.count
+          })
+        }
+      }
+    }.eraseToAnyPublisher()
+  }
+
+  // Throws if the stream stopped in the middle of the archive.
+  public func finish() throws {
+    try queue.sync {
+      switch state {
+      case .end, .header where pending.isEmpty:
+        break
+      default:
+        throw TarError(msg: "Archive is truncated.")
+      }
+
+      for link in links {
+        // Links made in this loop may now be in the way.
+        try checkNoLinks(above: link.path)
+        var st = stat()
+        if lstat(link.path, &st) == 0 {
+          guard (st.st_mode & S_IFMT) != S_IFDIR else {
+            throw TarError(msg: "Refusing to replace directory \(link.path) with a link.")
+          }
+          unlink(link.path)
+        }
+        try FileManager.default.createSymbolicLink(atPath: link.path, withDestinationPath: link.target)
+      }
+      links = []
+      // Deepest first, so a parent does not lock its children.
+      for directory in directoryModes.reversed() {
+        chmod(directory.path, directory.mode)
+      }
+      directoryModes = []
+    }
+  }
+
+  private func consume(_ buf: DispatchData) throws {
+    if case .end = state {
+      return
+    }
+    // File contents go straight from the buffer when nothing else is pending.
+    if pending.isEmpty, case .file = state {
+      var handled = 0
+      for region in buf.regions {
+        try region.withUnsafeBytes { (bytes: UnsafePointer<UInt8>) in
+          handled += try writeFile(UnsafeRawBufferPointer(start: bytes, count: region.count))
+        }
+        if case .file = state {
+          continue
+        }
+        break
+      }
+      if handled == buf.count {
+        return
+      }
+      append(buf, from: handled)
+    } else {
+      append(buf, from: 0)
+    }
+
+    var pos = 0
+    defer { pending.removeSubrange(0..<pos) }
+    while pos < pending.count {
+      if padding > 0, case .header = state {
+        let n = min(padding, pending.count - pos)
+        padding -= n
+        pos += n
+        continue
+      }
+
+      switch state {
+      case .end:
+        pos = pending.count
+      case .header:
+        guard pending.count - pos >= TarHeader.blockSize else {
+          return
+        }
+        let block = pending.subdata(in: pos..<(pos + TarHeader.blockSize))
+        pos += TarHeader.blockSize
+        try start(try TarHeader.parse(block))
+      case .file:
+        pos += try pending.withUnsafeBytes { bytes in
+          try writeFile(UnsafeRawBufferPointer(rebasing: bytes[pos...]))
+        }
+      case let .collect(kind, remaining, data):
+        let n = Int(min(remaining, UInt64(pending.count - pos)))
+        let data = data + pending.subdata(in: pos..<(pos + n))
+        pos += n
+        if remaining == UInt64(n) {
+          try collected(kind, data)
+        } else {
+          state = .collect(kind: kind, remaining: remaining - UInt64(n), data: data)
+        }
+      case let .skip(remaining):
+        let n = Int(min(remaining, UInt64(pending.count - pos)))
+        pos += n
+        state = remaining == UInt64(n) ? .header : .skip(remaining: remaining - UInt64(n))
+      }
+    }
+  }
+
+  private func append(_ buf: DispatchData, from offset: Int) {
+    let start = pending.count
+    pending.count += buf.count - offset
+    pending.withUnsafeMutableBytes { p in
+      _ = buf.copyBytes(to: UnsafeMutableRawBufferPointer(rebasing: p[start...]), from: offset..<buf.count)
+    }
+  }
+
+  private func start(_ header: TarHeader?) throws {
+    guard var header = header else {
+      state = .end
+      return
+    }
+    if let path = overrides["path"] {
+      header.path = path
+    }
+    if let link = overrides["linkpath"] {
+      header.linkName = link
+    }
+    if let size = overrides["size"].flatMap(UInt64.init) {
+      header.size = size
+    }
+    if let mtime = overrides["mtime"].flatMap(Double.init) {
+      header.mtime = mtime
+    }
+    let kind = header.kind
+    if kind != .paxHeader && kind != .gnuLongName && kind != .gnuLongLink {
+      overrides = [:]
+    }
+
+    padding = TarHeader.padding(for: header.size).count
+    switch kind {
+    case .paxHeader, .gnuLongName, .gnuLongLink:
+      state = .collect(kind: kind!, remaining: header.size, data: Data())
+      if header.size == 0 {
+        try collected(kind!, Data())
+      }
+      return
+    case .paxGlobal, .none:
+      state = header.size > 0 ? .skip(remaining: header.size) : .header
+      return
+    default:
+      break
+    }
+
+    let path = try destination(for: header.path)
+    try checkNoLinks(above: path)
+    switch kind {
+    case .directory:
+      var st = stat()
+      if lstat(path, &st) == 0 && (st.st_mode & S_IFMT) == S_IFLNK {
+        throw TarError(msg: "Refusing to extract \(path) over a link.")
+      }
+      try FileManager.default.createDirectory(atPath: path, withIntermediateDirectories: true)
+      if preserve.contains(.permissions) {
+        directoryModes.append((path, mode_t(header.mode & 0o7777)))
+      }
+      state = .header
+    case .symlink:
+      links.append((path, header.linkName))
+      state = .header
+    default:
+      try FileManager.default.createDirectory(atPath: (path as NSString).deletingLastPathComponent,
+                                              withIntermediateDirectories: true)
+      // An existing link is replaced, not written through.
+      var st = stat()
+      if lstat(path, &st) == 0 && (st.st_mode & S_IFMT) == S_IFLNK {
+        unlink(path)
+      }
+      let fd = Darwin.open(path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW, S_IRWXU)
+      guard fd >= 0 else {
+        throw TarError(msg: "Could not create \(path). \(String(cString: strerror(errno)))")
+      }
+      state = .file(fd: fd, path: path, size: header.size, remaining: header.size,
+                    mode: header.mode, mtime: header.mtime)
+      if header.size == 0 {
+        try closeFile()
+      }
+    }
+  }
+
+  private func collected(_ kind: TarHeader.Kind, _ data: Data) throws {
+    switch kind {
+    case .paxHeader:
+      overrides.merge(try TarHeader.parsePax(data)) { $1 }
+    case .gnuLongName:
+      overrides["path"] = String(decoding: data.prefix { $0 != 0 }, as: UTF8.self)
+    case .gnuLongLink:
+      overrides["linkpath"] = String(decoding: data.prefix { $0 != 0 }, as: UTF8.self)
+    default:
+      break
+    }
+    state = .header
+  }
+
+  // Writes what belongs to the current file, and returns how much was used.
+  private func writeFile(_ bytes: UnsafeRawBufferPointer) throws -> Int {
+    guard case let .file(fd, path, size, remaining, mode, mtime) = state else {
+      return 0
+    }
+    let n = Int(min(remaining, UInt64(bytes.count)))
+    var written = 0
+    while written < n {
+      let rc = Darwin.write(fd, bytes.baseAddress! + written, n - written)
+      guard rc > 0 else {
+        throw TarError(msg: "Could not write \(path). \(String(cString: strerror(errno)))")
+      }
+      written += rc
+    }
+    if n > 0 {
+      progress(CopyProgressInfo(name: path, written: UInt64(n), size: size))
+    }
+    state = .file(fd: fd, path: path, size: size, remaining: remaining - UInt64(n), mode: mode, mtime: mtime)
+    if remaining == UInt64(n) {
+      try closeFile()
+      // The padding of the file may come in this same buffer.
+      let pad = min(padding, bytes.count - n)
+      padding -= pad
+      return n + pad
+    }
+    return n
+  }
+
+  private func closeFile() throws {
+    guard case let .file(fd, path, size, _, mode, mtime) = state else {
+      return
+    }
+    Darwin.close(fd)
+    state = .header
+
+    var attrs: FileAttributes = [:]
+    if preserve.contains(.permissions) {
+      attrs[.posixPermissions] = NSNumber(value: mode & 0o7777)
+    }
+    if preserve.contains(.timestamp) {
+      attrs[.modificationDate] = Date(timeIntervalSince1970: mtime)
+    }
+    if !attrs.isEmpty {
+      try FileManager.default.setAttributes(attrs, ofItemAtPath: path)
+    }
+    progress(CopyProgressInfo(name: path, written: 0, size: size))
+  }
+
+  private func destination(for entry: String) throws -> String {
+    let components = entry.split(separator: "/").filter { $0 != "." }
+    guard !components.isEmpty, !components.contains("..") else {
+      throw TarError(msg: "Refusing to extract \(entry) outside of the destination.")
+    }
+    return (root as NSString).appendingPathComponent(components.joined(separator: "/"))
+  }
+
+  // Fails if a directory between the root and the path is a link, already there or not from us,
+  // as writing under it could land outside of the destination.
+  private func checkNoLinks(above path: String) throws {
+    var directory = (path as NSString).deletingLastPathComponent
+    var unchecked: [String] = []
+    while directory.count > root.count && !verifiedDirectories.contains(directory) {
+      unchecked.append(directory)
+      directory = (directory as NSString).deletingLastPathComponent
+    }
+    // From the top, so what is under a link is never looked at.
+    for directory in unchecked.reversed() {
+      var st = stat()
+      if lstat(directory, &st) == 0 {
+        guard (st.st_mode & S_IFMT) != S_IFLNK else {
+          throw TarError(msg: "Refusing to extract \(path) through the link \(directory).")
+        }
+        verifiedDirectories.insert(directory)
+      }
+    }
+  }
+}
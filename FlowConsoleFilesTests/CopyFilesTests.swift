@@ -66,6 +66,43 @@ class CopyFilesTests: XCTestCase {
     XCTAssertTrue(totalWritten == 6191846351)
   }
   
+  func testLocalCopyFastPath() throws {
+    let dir = (NSTemporaryDirectory() as NSString).appendingPathComponent(UUID().uuidString)
+    try FileManager.default.createDirectory(atPath: dir, withIntermediateDirectories: true)
+    defer { try? FileManager.default.removeItem(atPath: dir) }
+    let src = (dir as NSString).appendingPathComponent("source")
+    let content = Data((0..<(3 * 1024 * 1024)).map { UInt8($0 % 251) })
+    FileManager.default.createFile(atPath: src, contents: content,
+                                   attributes: [.posixPermissions: NSNumber(value: Int16(0o640))])
+    try FileManager.default.createDirectory(atPath: (dir as NSString).appendingPathComponent("dest"),
+                                            withIntermediateDirectories: false)
+
+    var totalWritten: UInt64 = 0
+    let expectFileCopied = self.expectation(description: "File Copied")
+    let c = Local().cloneWalkTo((dir as NSString).appendingPathComponent("dest"))
+      .flatMap { destDir -> CopyProgressInfoPublisher in
+        Local().cloneWalkTo(src)
+          .flatMap { destDir.copy(from: [$0]) }
+          .eraseToAnyPublisher()
+      }.sink(receiveCompletion: { completion in
+        if case .failure(let error) = completion {
+          XCTFail("Crash \(error)")
+        }
+        expectFileCopied.fulfill()
+      }, receiveValue: { report in
+        totalWritten += report.written
+      })
+
+    wait(for: [expectFileCopied], timeout: 10)
+    c.cancel()
+
+    let dst = (dir as NSString).appendingPathComponent("dest/source")
+    XCTAssertEqual(totalWritten, UInt64(content.count))
+    XCTAssertEqual(FileManager.default.contents(atPath: dst), content)
+    let attrs = try FileManager.default.attributesOfItem(atPath: dst)
+    XCTAssertEqual((attrs[.posixPermissions] as? NSNumber)?.int16Value, 0o640)
+  }
+
   func testCopyFrom() throws {
     self.continueAfterFailure = false
     let expectStructureCopied = self.expectation(description: "Structure Copied")
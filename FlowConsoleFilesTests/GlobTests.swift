@@ -0,0 +1,99 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import XCTest
+import Combine
+
+@testable import FlowConsoleFiles
+
+class GlobTests: XCTestCase {
+  var cancellableBag: [AnyCancellable] = []
+
+  func testMatch() {
+    XCTAssertTrue(Glob("*.gz").matches("a.gz"))
+    XCTAssertFalse(Glob("*.gz").matches("a.gz.1"))
+    XCTAssertFalse(Glob("*.gz").matches(".hidden.gz"))
+    XCTAssertTrue(Glob(".*.gz").matches(".hidden.gz"))
+    XCTAssertFalse(Glob(".*").matches(".."))
+    XCTAssertTrue(Glob("2024-??.log").matches("2024-01.log"))
+    XCTAssertTrue(Glob("?.txt").matches("é.txt"))
+    XCTAssertTrue(Glob("[a-c]*").matches("beta"))
+    XCTAssertFalse(Glob("[!a-c]*").matches("beta"))
+    XCTAssertTrue(Glob("[]x]").matches("]"))
+    XCTAssertTrue(Glob("[é-ë]").matches("ê"))
+    XCTAssertTrue(Glob("a\\*b").matches("a*b"))
+    XCTAssertFalse(Glob("a\\*b").matches("axb"))
+    XCTAssertTrue(Glob("*a*b*c*").matches("xxaxxbxxcxx"))
+    XCTAssertFalse(Glob("*a*b*c*").matches("xxaxxcxxbxx"))
+  }
+
+  func testBracesAndGlobstar() {
+    let glob = Glob("logs/{app,db}/**/*.{gz,log}")
+    XCTAssertEqual(glob.alternatives.count, 4)
+    XCTAssertNil(glob.maxDepth)
+    XCTAssertTrue(glob.matches("logs/app/x.gz"))
+    XCTAssertTrue(glob.matches("logs/db/2024/01/x.log"))
+    XCTAssertFalse(glob.matches("logs/web/x.log"))
+    XCTAssertFalse(glob.matches("logs/app/.cache/x.log"))
+
+    XCTAssertEqual(Glob.expandBraces(Array("a{b,c{d,e}}f".utf8)).map { String(decoding: $0, as: UTF8.self) },
+                   ["abf", "acdf", "acef"])
+    XCTAssertEqual(Glob("a{b}c").alternatives, [[.literal("a{b}c")]])
+    XCTAssertEqual(Glob("logs/*/2024-*.gz").maxDepth, 3)
+  }
+
+  func testTranslatorsMatching() throws {
+    let fm = FileManager.default
+    let base = (NSTemporaryDirectory() as NSString).appendingPathComponent(UUID().uuidString)
+    defer { try? fm.removeItem(atPath: base) }
+
+    for dir in ["logs/a/2024", "logs/b", "logs/.hidden"] {
+      try fm.createDirectory(atPath: (base as NSString).appendingPathComponent(dir), withIntermediateDirectories: true)
+    }
+    for file in ["logs/a/x.log", "logs/a/2024/y.log", "logs/b/z.log", "logs/b/z.txt", "logs/.hidden/h.log"] {
+      fm.createFile(atPath: (base as NSString).appendingPathComponent(file), contents: Data())
+    }
+
+    var matched: [String] = []
+    let expectDone = self.expectation(description: "Matched")
+    Local().translatorsMatching(path: "\(base)/logs/**/*.{log,none}")
+      .sink(receiveCompletion: { completion in
+        if case .failure(let error) = completion {
+          XCTFail("\(error)")
+        }
+        expectDone.fulfill()
+      }, receiveValue: { matched.append($0.current) })
+      .store(in: &cancellableBag)
+    wait(for: [expectDone], timeout: 5)
+
+    let expected = ["logs/a/x.log", "logs/a/2024/y.log", "logs/b/z.log"]
+      .map { (base as NSString).appendingPathComponent($0) }
+    XCTAssertEqual(Set(matched.map { ($0 as NSString).standardizingPath }),
+                   Set(expected.map { ($0 as NSString).standardizingPath }))
+  }
+}
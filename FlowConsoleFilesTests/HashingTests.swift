@@ -0,0 +1,90 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import XCTest
+import Combine
+import CryptoKit
+
+@testable import FlowConsoleFiles
+
+class HashingTests: XCTestCase {
+  var cancellableBag: [AnyCancellable] = []
+
+  func testLocalDigests() throws {
+    let fm = FileManager.default
+    let base = (NSTemporaryDirectory() as NSString).appendingPathComponent(UUID().uuidString)
+    defer { try? fm.removeItem(atPath: base) }
+
+    // Files over a read chunk, empty, and a nested one.
+    let nested = (base as NSString).appendingPathComponent("dir")
+    try fm.createDirectory(atPath: nested, withIntermediateDirectories: true)
+    let big = Data((0..<(3 * 1024 * 1024 + 7)).map { UInt8($0 % 251) })
+    fm.createFile(atPath: (base as NSString).appendingPathComponent("abc"), contents: Data("abc".utf8))
+    fm.createFile(atPath: (base as NSString).appendingPathComponent("empty"), contents: Data())
+    fm.createFile(atPath: (nested as NSString).appendingPathComponent("big"), contents: big)
+
+    var digests: [String: String]? = nil
+    let expectDone = self.expectation(description: "Hashed")
+    Local().walkTo(base)
+      .flatMap { FileHasher(maxConcurrentFiles: 2).digests(of: $0) }
+      .sink(receiveCompletion: { completion in
+        if case .failure(let error) = completion {
+          XCTFail("\(error)")
+        }
+        expectDone.fulfill()
+      }, receiveValue: { digests = $0 })
+      .store(in: &cancellableBag)
+    wait(for: [expectDone], timeout: 10)
+
+    XCTAssertEqual(digests?.count, 3)
+    XCTAssertEqual(digests?["abc"], "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad")
+    XCTAssertEqual(digests?["empty"], "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855")
+    XCTAssertEqual(digests?["dir/big"], FileHasher.hex(SHA256.hash(data: big)))
+  }
+
+  func testParseAndCompareDigests() {
+    let output = """
+    ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad  ./abc
+    e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855  ./dir/with  spaces
+    \\e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855  ./new\\nline
+    """
+    let remote = FileHasher.parseDigests(output)
+    XCTAssertEqual(remote.count, 3)
+    XCTAssertNotNil(remote["dir/with  spaces"])
+    XCTAssertNotNil(remote["new\nline"])
+
+    var local = remote
+    local["abc"] = "00"
+    local["missing"] = "00"
+    let comparison = HashComparison(source: local, destination: remote)
+    XCTAssertEqual(comparison.matching, 2)
+    XCTAssertEqual(comparison.different, ["abc"])
+    XCTAssertEqual(comparison.missing, ["missing"])
+    XCTAssertFalse(comparison.isMatching)
+  }
+}
@@ -128,6 +128,50 @@ class LocalFilesTests: XCTestCase {
     //file.close()
   }
   
+  func testFileReadChunks() throws {
+    let path = (NSTemporaryDirectory() as NSString).appendingPathComponent(UUID().uuidString)
+    let content = Data((0..<(5 * 1024 * 1024 + 17)).map { UInt8($0 % 251) })
+    FileManager.default.createFile(atPath: path, contents: content, attributes: nil)
+    defer { try? FileManager.default.removeItem(atPath: path) }
+
+    let file = try LocalFile(at: path, flags: O_RDONLY)
+    var received = Data()
+    var chunks = 0
+    let expectRead = self.expectation(description: "Read complete")
+
+    // Demand one chunk at a time, like a slow writer would.
+    file.read(max: SSIZE_MAX)
+      .flatMap(maxPublishers: .max(1)) { data -> AnyPublisher<DispatchData, Error> in
+        Just(data).delay(for: 0.01, scheduler: DispatchQueue.main)
+          .setFailureType(to: Error.self).eraseToAnyPublisher()
+      }
+      .sink(receiveCompletion: { completion in
+        if case .failure(let error) = completion {
+          XCTFail("\(error)")
+        }
+        expectRead.fulfill()
+      }, receiveValue: { data in
+        chunks += 1
+        XCTAssertLessThanOrEqual(data.count, file.blockSize)
+        received.append(contentsOf: data)
+      }).store(in: &cancellableBag)
+
+    wait(for: [expectRead], timeout: 10)
+    XCTAssertEqual(received, content)
+    XCTAssertEqual(chunks, 6)
+
+    // Random reads from the map do not move the offset.
+    file.mapsForRandomReads = true
+    let expectMapped = self.expectation(description: "Mapped read")
+    file.read(at: 1024 * 1024 + 3, max: 10)
+      .sink(receiveCompletion: { _ in expectMapped.fulfill() },
+            receiveValue: { data in
+              XCTAssertEqual(Data(data), content[(1024 * 1024 + 3)..<(1024 * 1024 + 13)])
+            }).store(in: &cancellableBag)
+    wait(for: [expectMapped], timeout: 1)
+    XCTAssertEqual(file.offset, Int64(content.count))
+  }
+
   func testFileWriteTo() throws {
     self.continueAfterFailure = false
     // For SFTP it will be useful to have the channel reachable, and then stop it through a timer to test the reconnect.
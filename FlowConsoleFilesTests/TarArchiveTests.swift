@@ -0,0 +1,174 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import XCTest
+import Combine
+
+@testable import FlowConsoleFiles
+
+class TarArchiveTests: XCTestCase {
+  var cancellableBag: [AnyCancellable] = []
+
+  func testArchiveRoundTrip() throws {
+    let fm = FileManager.default
+    let base = (NSTemporaryDirectory() as NSString).appendingPathComponent(UUID().uuidString)
+    defer { try? fm.removeItem(atPath: base) }
+
+    // A tree with an empty file, a file over a chunk, a long name and a link.
+    let src = (base as NSString).appendingPathComponent("tree")
+    let longDir = (src as NSString).appendingPathComponent(String(repeating: "d", count: 90))
+    try fm.createDirectory(atPath: longDir, withIntermediateDirectories: true)
+    let big = Data((0..<(300 * 1024 + 5)).map { UInt8($0 % 253) })
+    fm.createFile(atPath: (src as NSString).appendingPathComponent("empty"), contents: Data())
+    fm.createFile(atPath: (longDir as NSString).appendingPathComponent(String(repeating: "f", count: 40)),
+                  contents: big, attributes: [.posixPermissions: NSNumber(value: Int16(0o600))])
+    try fm.createSymbolicLink(atPath: (src as NSString).appendingPathComponent("link"), withDestinationPath: "empty")
+
+    let dst = (base as NSString).appendingPathComponent("out")
+    try fm.createDirectory(atPath: dst, withIntermediateDirectories: true)
+
+    var written: UInt64 = 0
+    let extractor = TarExtractor(into: dst, preserve: [.permissions]) { written += $0.written }
+    let expectDone = self.expectation(description: "Extracted")
+    TarArchiver(at: src).writeTo(extractor)
+      .sink(receiveCompletion: { completion in
+        if case .failure(let error) = completion {
+          XCTFail("\(error)")
+        }
+        expectDone.fulfill()
+      }, receiveValue: { _ in })
+      .store(in: &cancellableBag)
+    wait(for: [expectDone], timeout: 10)
+
+    XCTAssertNoThrow(try extractor.finish())
+    XCTAssertEqual(written, UInt64(big.count))
+    let out = (dst as NSString).appendingPathComponent("tree")
+    let bigCopy = ((out as NSString).appendingPathComponent(String(repeating: "d", count: 90)) as NSString)
+      .appendingPathComponent(String(repeating: "f", count: 40))
+    XCTAssertEqual(fm.contents(atPath: bigCopy), big)
+    XCTAssertEqual((try fm.attributesOfItem(atPath: bigCopy)[.posixPermissions] as? NSNumber)?.int16Value, 0o600)
+    XCTAssertEqual(fm.contents(atPath: (out as NSString).appendingPathComponent("empty")), Data())
+    XCTAssertEqual(try fm.destinationOfSymbolicLink(atPath: (out as NSString).appendingPathComponent("link")), "empty")
+  }
+
+  func testExtractorRejectsEscapingPaths() throws {
+    let header = TarHeader(path: "../outside", type: TarHeader.Kind.file.rawValue, size: 0, mode: 0o644, mtime: 0)
+    let dst = NSTemporaryDirectory()
+    let extractor = TarExtractor(into: dst, preserve: [])
+    let data = header.encoded()
+    let expectFailure = self.expectation(description: "Rejected")
+    extractor.write(data.withUnsafeBytes { DispatchData(bytes: $0) }, max: data.count)
+      .sink(receiveCompletion: { completion in
+        if case .failure = completion {
+          expectFailure.fulfill()
+        }
+      }, receiveValue: { _ in })
+      .store(in: &cancellableBag)
+    wait(for: [expectFailure], timeout: 1)
+  }
+
+  func testExtractorDoesNotWriteThroughLinks() throws {
+    let fm = FileManager.default
+    let base = (NSTemporaryDirectory() as NSString).appendingPathComponent(UUID().uuidString)
+    defer { try? fm.removeItem(atPath: base) }
+    let dst = (base as NSString).appendingPathComponent("out")
+    let outside = (base as NSString).appendingPathComponent("outside")
+    try fm.createDirectory(atPath: dst, withIntermediateDirectories: true)
+    try fm.createDirectory(atPath: outside, withIntermediateDirectories: true)
+
+    // The link is only made at the end, so the file lands in a real directory.
+    var extractor = TarExtractor(into: dst, preserve: [])
+    XCTAssertNoThrow(try extract([(TarHeader(path: "d", type: TarHeader.Kind.symlink.rawValue, size: 0, mode: 0o777,
+                                             mtime: 0, linkName: outside), Data()),
+                                  (TarHeader(path: "d/file", type: TarHeader.Kind.file.rawValue, size: 2, mode: 0o644,
+                                             mtime: 0), Data("hi".utf8))],
+                                 into: extractor))
+    XCTAssertThrowsError(try extractor.finish(), "The link would replace the directory")
+    XCTAssertFalse(fm.fileExists(atPath: (outside as NSString).appendingPathComponent("file")))
+
+    // A link already in the destination is not followed either.
+    let linked = (base as NSString).appendingPathComponent("linked")
+    try fm.createDirectory(atPath: linked, withIntermediateDirectories: true)
+    try fm.createSymbolicLink(atPath: (linked as NSString).appendingPathComponent("e"), withDestinationPath: outside)
+    extractor = TarExtractor(into: linked, preserve: [])
+    XCTAssertThrowsError(try extract([(TarHeader(path: "e/file", type: TarHeader.Kind.file.rawValue, size: 2,
+                                                 mode: 0o644, mtime: 0), Data("hi".utf8))],
+                                     into: extractor))
+    XCTAssertFalse(fm.fileExists(atPath: (outside as NSString).appendingPathComponent("file")))
+  }
+
+  func testExtractorFillsReadOnlyDirectories() throws {
+    let fm = FileManager.default
+    let dst = (NSTemporaryDirectory() as NSString).appendingPathComponent(UUID().uuidString)
+    try fm.createDirectory(atPath: dst, withIntermediateDirectories: true)
+    let readOnly = (dst as NSString).appendingPathComponent("ro")
+    defer {
+      chmod(readOnly, 0o755)
+      try? fm.removeItem(atPath: dst)
+    }
+
+    let extractor = TarExtractor(into: dst, preserve: [.permissions])
+    XCTAssertNoThrow(try extract([(TarHeader(path: "ro", type: TarHeader.Kind.directory.rawValue, size: 0, mode: 0o555,
+                                             mtime: 0), Data()),
+                                  (TarHeader(path: "ro/file", type: TarHeader.Kind.file.rawValue, size: 2, mode: 0o444,
+                                             mtime: 0), Data("hi".utf8))],
+                                 into: extractor))
+    XCTAssertNoThrow(try extractor.finish())
+    XCTAssertEqual(fm.contents(atPath: (readOnly as NSString).appendingPathComponent("file")), Data("hi".utf8))
+    XCTAssertEqual((try fm.attributesOfItem(atPath: readOnly)[.posixPermissions] as? NSNumber)?.int16Value, 0o555)
+  }
+
+  func testMalformedPaxRecord() throws {
+    XCTAssertThrowsError(try TarHeader.parsePax(Data("2 x".utf8)))
+    XCTAssertEqual(try TarHeader.parsePax(Data(TarHeader.paxRecord("path", "a/b").utf8)), ["path": "a/b"])
+  }
+
+  // Writes the entries to the extractor as one archive, and waits for it.
+  private func extract(_ entries: [(TarHeader, Data)], into extractor: TarExtractor) throws {
+    var archive = Data()
+    for (header, content) in entries {
+      archive += header.encoded() + content + TarHeader.padding(for: UInt64(content.count))
+    }
+    archive += Data(count: 2 * TarHeader.blockSize)
+
+    var failure: Error? = nil
+    let expectDone = self.expectation(description: "Extracted")
+    extractor.write(archive.withUnsafeBytes { DispatchData(bytes: $0) }, max: archive.count)
+      .sink(receiveCompletion: { completion in
+        if case .failure(let error) = completion {
+          failure = error
+        }
+        expectDone.fulfill()
+      }, receiveValue: { _ in })
+      .store(in: &cancellableBag)
+    wait(for: [expectDone], timeout: 5)
+    if let failure = failure {
+      throw failure
+    }
+  }
+}
@@ -52,20 +52,39 @@ public class SSHAgentKey {
 //  var expiration: Int
   public let signer: Signer
   public let name: String
+  // Encoded once, as every identities request and signature lookup needs them.
+  // Nil if the public key cannot be encoded, in which case the key is not offered.
+  let blob: Data?
+  let encodedIdentity: Data?
+  let blobHash: String?
 
   init(_ key: Signer, named: String, constraints: [SSHAgentConstraint]? = nil) {
     self.signer = key
     self.name = named
     self.constraints = constraints
+    if let encoded = try? key.publicKey.encode() {
+      // Get rid of the blob size, as requests refer to the key by the blob only.
+      let blob = encoded.subdata(in: 4..<encoded.count)
+      self.blob = blob
+      self.encodedIdentity = encoded + SSHEncode.data(from: named)
+      self.blobHash = SSHAuthMemo.hash(keyBlob: blob)
+    } else {
+      self.blob = nil
+      self.encodedIdentity = nil
+      self.blobHash = nil
+    }
   }
 }
 
 public class SSHAgent {
-  public private(set) var ring: [SSHAgentKey] = []
+  public private(set) var ring: [SSHAgentKey] = [] {
+    didSet { index = Dictionary(ring.compactMap { k in k.blob.map { ($0, k) } }, uniquingKeysWith: { first, _ in first }) }
+  }
+  private var index: [Data: SSHAgentKey] = [:]
   // NOTE Instead of the Agent tracking the constraints, we could have a delegate for that.
   // NOTE The Agent name won't be relevant when doing Jumps between hosts, but at least you will know the first originator.
   var superAgent: SSHAgent? = nil
-  var agentForward: Set<AnyCancellable> = []
+  private var forwards: [ObjectIdentifier: AgentForward] = [:]
 
   public init() {}
 
@@ -147,17 +166,27 @@ public class SSHAgent {
   func request(_ message: Data, context: SSHAgentRequestType, client: SSHClient) throws -> Data {
       switch context {
         case .requestIdentities:
-          let ring = try encodedRing()
+          var ring = offeredKeys()
+          // libssh offers the keys in the order we give them, so the one that
+          // worked last time for this host goes first.
+          if let hint = client.agentKeyHint, let idx = ring.firstIndex(where: { $0.blobHash == hint }), idx > 0 {
+            ring.insert(ring.remove(at: idx), at: 0)
+          }
+          client.agentKeysOffered = ring.compactMap { $0.blobHash }
           var keys: UInt32 = UInt32(ring.count).bigEndian
           var respType = SSHAgentResponseType.answerIdentities.rawValue
-          let preamble = Data(bytes: &respType, count: MemoryLayout<CChar>.size) +
-            Data(bytes: &keys, count: MemoryLayout<UInt32>.size)
+          var reply = Data(capacity: ring.reduce(5) { $0 + ($1.encodedIdentity?.count ?? 0) })
+          reply.append(&respType, count: MemoryLayout<CChar>.size)
+          withUnsafeBytes(of: &keys) { reply.append(contentsOf: $0) }
+          ring.forEach { reply.append($0.encodedIdentity!) }
 
-          return ring.reduce(preamble) { $0 + $1 }
+          return reply
         case .requestSignature:
           guard let signature = try encodedSignature(message, for: client) else {
             throw SSHKeyError.general(title: "Could not find proposed key")
           }
+          var msg = message
+          client.agentSignedKey = SSHAuthMemo.hash(keyBlob: SSHDecode.bytes(&msg))
           var respType = SSHAgentResponseType.responseSignature.rawValue
 
           return Data(bytes: &respType, count: MemoryLayout<CChar>.size)
@@ -167,9 +196,9 @@ public class SSHAgent {
       }
   }
 
-  func encodedRing() throws -> [Data] {
-    (try superAgent?.encodedRing() ?? []) +
-      (try ring.map { (try $0.signer.publicKey.encode()) + SSHEncode.data(from: $0.name) })
+  // Keys of the parent agents first, as they are the ones that would answer.
+  func offeredKeys() -> [SSHAgentKey] {
+    (superAgent?.offeredKeys() ?? []) + ring.filter { $0.encodedIdentity != nil }
   }
 
   func encodedSignature(_ message: Data, for client: SSHClient) throws -> Data? {
@@ -200,52 +229,77 @@ public class SSHAgent {
   }
 
   fileprivate func lookupKey(blob: Data) -> SSHAgentKey? {
-    // Get rid of the blob size from encode before comparing.
-    ring.first { (try? $0.signer.publicKey.encode()[4...]) == blob }
+    index[blob]
   }
 }
 
 extension SSHAgent {
+  /// Serve agent requests from a forwarded channel. Every channel is handled on its own,
+  /// so a channel closing or busy does not affect the others.
   func forward(to stream: Stream) {
-    // Read, process and write
-    // Reads up to max - it may read less if the channel closes before.
-    stream.read(max: 4)
-      .flatMap { data -> AnyPublisher<DispatchData, Error> in
-        var payloadSizeData = data as AnyObject as! Data
-        if data.count < 4 {
-          return .fail(error: SSHError(title: "Agent Channel closed before read could complete"))
-        }
-        let payloadSize = Int(SSHDecode.uint32(&payloadSizeData))
-        return stream.read(max: payloadSize)
+    let id = ObjectIdentifier(stream)
+    let forward = AgentForward(self, on: stream)
+    forwards[id] = forward
+    stream.handleCompletion = { [weak self] in self?.forwards.removeValue(forKey: id) }
+    stream.handleFailure = { [weak self] _ in self?.forwards.removeValue(forKey: id) }
+    stream.connect(stdout: forward)
+  }
+}
+
+/// Frames the requests of a forwarded agent channel. Data is accumulated on a buffer that
+/// is kept for the lifetime of the channel, and all the requests that are complete on a read
+/// are answered with a single write.
+fileprivate class AgentForward: Writer {
+  weak var agent: SSHAgent?
+  let stream: Stream
+  var buffer = Data(capacity: 16 * 1024)
+  // Start of the first message that has not been answered yet.
+  var offset = 0
+
+  init(_ agent: SSHAgent, on stream: Stream) {
+    self.agent = agent
+    self.stream = stream
+  }
+
+  func write(_ buf: DispatchData, max length: Int) -> AnyPublisher<Int, Error> {
+    buf.regions.forEach { buffer.append(contentsOf: $0) }
+
+    var replies = Data()
+    while buffer.count - offset >= 4 {
+      var header = buffer[offset..<offset + 4]
+      let size = Int(SSHDecode.uint32(&header))
+      guard buffer.count - offset - 4 >= size else {
+        break
       }
-      .flatMap { data -> AnyPublisher<Int, Error> in
-        var payload = data as AnyObject as! Data
-        if data.count < 1 {
-          return .fail(error: SSHError(title: "Agent Channel closed before read could complete"))
-        }
-
-        let typeValue = SSHDecode.uint8(&payload)
-
-        var replyData: Data
-        if let type = SSHAgentRequestType(rawValue: typeValue) {
-          replyData = (try? self.request(payload, context: type, client: stream.client)) ?? errorData
-        } else {
-          replyData = errorData
-        }
-
-        let reply = SSHEncode.data(from: UInt32(replyData.count)) + replyData
-        let dd = reply.withUnsafeBytes { DispatchData(bytes: $0) }
-
-        return stream.write(dd, max: dd.count)
-      }.sink(
-        receiveCompletion: { c in
-          // Completion. Log errors and escape
-          if ssh_channel_is_eof(stream.channel) == 0 {
-            self.forward(to: stream)
-          } else {
-            self.agentForward = []
-          }
-        }, receiveValue: { _ in }).store(in: &agentForward)
+      var payload = buffer[offset + 4..<offset + 4 + size]
+      offset += 4 + size
+
+      var replyData = errorData
+      if size > 0,
+         let type = SSHAgentRequestType(rawValue: SSHDecode.uint8(&payload)),
+         let agent = agent,
+         let reply = try? agent.request(payload, context: type, client: stream.client) {
+        replyData = reply
+      }
+      replies.append(SSHEncode.data(from: UInt32(replyData.count)))
+      replies.append(replyData)
+    }
+
+    // Reuse the buffer once everything is consumed, and compact it when the
+    // unanswered part is not at the front anymore.
+    if offset == buffer.count {
+      buffer.removeAll(keepingCapacity: true)
+      offset = 0
+    } else if offset > 0 {
+      buffer.removeSubrange(0..<offset)
+      offset = 0
+    }
+
+    guard !replies.isEmpty else {
+      return .just(buf.count)
+    }
+    let dd = replies.withUnsafeBytes { DispatchData(bytes: $0) }
+    return stream.write(dd, max: dd.count).map { _ in buf.count }.eraseToAnyPublisher()
   }
 }
 
@@ -294,49 +348,36 @@ public enum SSHEncode {
 }
 
 public enum SSHDecode {
+  // The cursor moves by slicing, so the rest of the message is not copied on
+  // every field. Indexes are relative to startIndex because of that.
   static func string(_ bytes: inout Data) -> String? {
-    let length = SSHDecode.uint32(&bytes)
-    guard let str = String(data: bytes[0..<length], encoding: .utf8) else {
+    let length = Int(SSHDecode.uint32(&bytes))
+    let start = bytes.startIndex
+    guard let str = String(data: bytes[start..<start + length], encoding: .utf8) else {
       return nil
     }
-    bytes = bytes.advanced(by: Int(length))
+    bytes = bytes[(start + length)...]
     return str
   }
 
   static func bytes(_ bytes: inout Data) -> Data {
-    let length = SSHDecode.uint32(&bytes)
-    let d = bytes.subdata(in: 0..<Int(length))
-    bytes = bytes.advanced(by: Int(length))
+    let length = Int(SSHDecode.uint32(&bytes))
+    let start = bytes.startIndex
+    let d = bytes.subdata(in: start..<start + length)
+    bytes = bytes[(start + length)...]
     return d
   }
 
   static func uint8(_ bytes: inout Data) -> UInt8 {
-    let length = MemoryLayout<UInt8>.size
-    let d = bytes.subdata(in: 0..<length)
-    let value = UInt8(bigEndian: d.withUnsafeBytes { ptr in
-      ptr.load(as: UInt8.self)
-    })
-
-    if bytes.count == Int(length) {
-      bytes = Data()
-    } else {
-      bytes = bytes.advanced(by: Int(length))
-    }
+    let value = bytes[bytes.startIndex]
+    bytes = bytes[(bytes.startIndex + 1)...]
     return value
   }
 
   static func uint32(_ bytes: inout Data) -> UInt32 {
-    let length = MemoryLayout<UInt32>.size
-    let d = bytes.subdata(in: 0..<Int(length))
-    let value = UInt32(bigEndian: d.withUnsafeBytes { ptr in
-      ptr.load(as: UInt32.self)
-    })
-
-    if bytes.count == Int(length) {
-      bytes = Data()
-    } else {
-      bytes = bytes.advanced(by: Int(length))
-    }
+    let start = bytes.startIndex
+    let value = bytes[start..<start + 4].reduce(UInt32(0)) { $0 << 8 | UInt32($1) }
+    bytes = bytes[(start + 4)...]
     return value
   }
 }
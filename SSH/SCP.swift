@@ -243,211 +243,169 @@ extension SCPClient {
 
 extension SCPClient: Writer {
   public func write(_ buf: DispatchData, max length: Int) -> AnyPublisher<Int, Error> {
+    let writing = Writing(self, data: buf)
+    return .demandingSubject(writing.pb,
+                             receiveRequest: { _ in writing.write() },
+                             receiveCancel: { self.ssh.perform { writing.finish() } },
+                             on: ssh.rloop)
+  }
+
+  // Writes the buffer in place, from an offset, as much as the window and the write scheduler
+  // allow on every pass. When the window is exhausted, it waits for the channel to tell that
+  // writes won't block instead of going around the run loop. When the scheduler does not grant
+  // more, it yields to the other channels on the client.
+  class Writing {
+    let parent: SCPClient
+    let data: DispatchData
+    var offset = 0
     let pb = PassthroughSubject<Int, Error>()
-    
-    func write(_ data: DispatchData) {
-      let window = Int(ssh_channel_window_size(self.channel))
-      if window == 0 {
-        self.ssh.rloop.perform { write(data) }
+    // Registered on the first pass, as the scheduler belongs to the client loop.
+    var writeFlow: SSHWriteScheduler.Flow? = nil
+    var callbacks: ssh_channel_callbacks_struct? = nil
+    var isWaitingForWindow = false
+    var isDone = false
+
+    var channel: ssh_channel { parent.channel! }
+
+    init(_ parent: SCPClient, data: DispatchData) {
+      self.parent = parent
+      self.data = data
+    }
+
+    func write() {
+      guard !isDone else {
         return
       }
-      
-      let size = min(data.count, window)
-      
-      let rc = data.withUnsafeBytes { bytes -> Int32 in
-        return ssh_scp_write(self.scp, bytes, size)
+
+      let scheduler = parent.ssh.writeScheduler
+      if writeFlow == nil {
+        writeFlow = scheduler.register(.bulk(weight: 2))
+      }
+      let flow = writeFlow!
+
+      var written = 0
+      var failure: Int32? = nil
+      var window = Int(ssh_channel_window_size(channel))
+      var allowance = scheduler.grant(flow, wanting: min(window, data.count - offset))
+      data.enumerateBytes { bytes, index, stop in
+        // Skip regions already written.
+        let end = index + bytes.count
+        guard end > offset else {
+          return
+        }
+        while offset < end {
+          if window == 0 || allowance == 0 {
+            stop = true
+            return
+          }
+          let size = min(end - offset, window, allowance)
+          let rc = ssh_scp_write(parent.scp, bytes.baseAddress! + (offset - index), size)
+          // Should never be SSH_AGAIN
+          if rc < 0 {
+            failure = rc
+            stop = true
+            return
+          }
+          scheduler.didWrite(flow, bytes: size)
+          offset += size
+          written += size
+          allowance -= size
+          window = Int(ssh_channel_window_size(channel))
+        }
       }
-      
-      // Should never be SSH_AGAIN
-      if rc < 0 {
-        pb.send(completion: .failure(SSHError(rc, forSession: self.ssh.session)))
+
+      if let rc = failure {
+        fail(SSHError(rc, forSession: parent.ssh.session))
         return
       }
-      
-      pb.send(size)
-      let nextData = data.subdata(in: size..<data.count)
-      
-      if size == data.count {
+      if written > 0 {
+        pb.send(written)
+      }
+      if offset == data.count {
+        finish()
         pb.send(completion: .finished)
         return
       }
-      
-      // Schedule next write in the rloop, so we can let it perform
-      return self.ssh.rloop.perform { write(nextData) }
-    }
-    
-    func writeBlock(_ data: DispatchData) {
-      self.ssh.rloop.perform { write(data) }
+      if window > 0 {
+        parent.ssh.perform { self.write() }
+        return
+      }
+      waitForWindow()
     }
-    
-    return pb.handleEvents(receiveRequest: { _ in writeBlock(buf) })
-      .eraseToAnyPublisher()
-  }
-}
 
-extension SCPClient {
-  // Perform a copy where SCPClient is the Source, and the Translator is the Sink.
-  // In this scenario the Source is driving the operation, so we do not know
-  // what we will receive to copy.
-  public func copy(to t: Translator) -> CopyProgressInfoPublisher {
-    // This could potentially block. We are assuming this won't be an issue with a well behaved SCP provider.
-    // We could poll before, as the function just reads char by char.
-    // ssh_channel_poll(channel, window)
-    // Retry if <= 0
-    // The read was non-blocking, and it returned a rc = 0. Would the same happen here?
-    var currentDir = t
-    var dirsFifo: [Translator] = []
-    
-    // Ensure we pull actions one by one.
-    return pullSourceAction().flatMap(maxPublishers: .max(1)) { req -> CopyProgressInfoPublisher in
-      // We nest the publisher so that we don't pull another action until the current one
-      // has been processed by the underneath flow.
-      return Just(req).flatMap { req -> AnyPublisher<ssh_scp_request_types, Error> in
-        switch req {
-        case SSH_SCP_REQUEST_NEWDIR:
-          // Walk to the directory, and create if it does not exist.
-          let name = String(cString: ssh_scp_request_get_filename(self.scp))
-          let mode = mode_t(ssh_scp_request_get_permissions(self.scp))
-          
-          // walk and capture the error
-          return currentDir.cloneWalkTo(name)
-            .catch { err -> AnyPublisher<Translator, Error> in
-              // If directory does not exist, try to create it.
-              return currentDir.mkdir(name: name, mode: mode)
-                .flatMap { _ in currentDir.cloneWalkTo(name) }.eraseToAnyPublisher()
-            }
-            .flatMap { dir -> AnyPublisher<ssh_scp_request_types, Error> in
-              dirsFifo.insert(currentDir, at: 0)
-              currentDir = dir
-              return self.connection().tryMap { scp -> ssh_scp_request_types in
-                let rc = ssh_scp_accept_request(scp)
-                if rc != SSH_OK {
-                  // TODO Deny request to remote side
-                  throw FileError(title: "Could not accept new directory request", in: self.ssh.session)
-                }
-                return req
-              }.eraseToAnyPublisher()
-            }.eraseToAnyPublisher()
-        case SSH_SCP_REQUEST_ENDDIR:
-          currentDir = dirsFifo[0]
-          dirsFifo.removeFirst()
-          return .just(req)
-        default:
-          return .just(req)
-        }
+    private func waitForWindow() {
+      guard !isWaitingForWindow else {
+        return
       }
-      .filter { $0 == SSH_SCP_REQUEST_NEWFILE }
-      .flatMap(maxPublishers: .max(1)) { req -> CopyProgressInfoPublisher in
-        let size: UInt64 = ssh_scp_request_get_size64(self.scp)
-        let name = String(cString: ssh_scp_request_get_filename(self.scp))
-        let mode = mode_t(ssh_scp_request_get_permissions(self.scp))
-        
-        return self.copyFileTo(translator: currentDir, usingName: name, length: size, mode: mode)
-      }.eraseToAnyPublisher()
-    }.eraseToAnyPublisher()
-    
-    // TODO How do you stop it? On cancel, you could close scp.
-    // You could provide a flag for cancellation.
-  }
-  
-  // Pull actions and finish when there are no more.
-  // Note the action is served in the rloop, so everything following will be there.
-  // The function limits Demand to one, so it expects to be called multiple times.
-  func pullSourceAction() -> AnyPublisher<ssh_scp_request_types, Error> {
-    let pb = PassthroughSubject<ssh_scp_request_types, Error>()
-    
-    func pull() {
-      let req = ssh_scp_pull_request(scp)
-      
-      // Switch has some type issues here
-      if req == SSH_SCP_REQUEST_EOF.rawValue {
-        pb.send(completion: .finished)
+      if callbacks == nil && startCallbacks() != SSH_OK {
+        fail(SSHError(title: "Could not initialize callbacks.", forSession: parent.ssh.session))
         return
-      } else if req == SSH_ERROR {
-        pb.send(completion: .failure(SSHError(req, forSession: self.ssh.session)))
-      } else {
-        pb.send(ssh_scp_request_types(UInt32(req)))
       }
-    }
-    
-    // Buffer to make sure we do not lose requests (as the pull may be called
-    // before the pb has demand).
-    return pb.buffer(size: 1, prefetch: .byRequest, whenFull: .dropOldest)
-      .handleEvents(receiveRequest: { _ in pull() })
-      .subscribe(on: self.ssh.rloop)
-      .eraseToAnyPublisher()
-  }
-  
-  // Flow when receiving a file to copy. Create on Translator and then Write to it.
-  func copyFileTo(translator: Translator, usingName name: String, length: UInt64, mode: mode_t) -> CopyProgressInfoPublisher {
-    return translator.create(name: name, mode: mode).flatMap { file -> CopyProgressInfoPublisher in
-      var totalWritten: UInt64 = 0
-      
-      return self.writeTo(file, length: length).map { written in
-        totalWritten += UInt64(written)
-        return CopyProgressInfo(name: name, written: totalWritten, size: length)
-      }.eraseToAnyPublisher()
-    }.eraseToAnyPublisher()
-  }
-  
-  func writeTo(_ t: Writer, length: UInt64) -> AnyPublisher<Int, Error> {
-    let pb = PassthroughSubject<DispatchData, Error>()
-    var totalWritten = 0
-    
-    func readNonBlock() {
-      // Won't block, as the read can return 0.
-      // We may want to know better the size of the window
-      
-      // Operations may need a write before we can receive anything.
-      var windowAvail = 65536
-      
-      if totalWritten > 0 {
-        windowAvail = Int(ssh_channel_poll(self.channel, 0))
-        
-        if windowAvail == 0 {
-          // Schedule another read if not ready yet
-          self.ssh.rloop.schedule(after: .init(Date(timeIntervalSinceNow: 0.01))) {
-            readNonBlock()
-          }
-          return
-        } else if windowAvail < 0 {
-          pb.send(completion: .failure(SSHError(Int32(windowAvail), forSession: self.ssh.session)))
-          return
-        }
+      isWaitingForWindow = true
+      // Check again in a while in case the window was adjusted before the callbacks were set.
+      parent.ssh.rloop.schedule(after: .init(Date(timeIntervalSinceNow: 0.05))) {
+        self.windowAvailable()
       }
-      
-      let buf = UnsafeMutableRawBufferPointer.allocate(byteCount: Int(windowAvail), alignment: MemoryLayout<CUnsignedChar>.alignment)
-      let rc = ssh_scp_read(scp, buf.baseAddress, Int(windowAvail))
-      if rc == SSH_ERROR {
-        pb.send(completion: .failure(SSHError(rc, forSession: self.ssh.session)))
+    }
+
+    fileprivate func windowAvailable() {
+      guard isWaitingForWindow else {
         return
       }
-      
-      let shrk = buf[0..<Int(rc)]
-      let buffer = UnsafeRawBufferPointer(rebasing: shrk)
-      let data = DispatchData(bytesNoCopy: buffer, deallocator: .custom(nil){ buf.deallocate() })
-      pb.send(data)
-      
-      totalWritten += data.count
-      if totalWritten == length {
-        pb.send(completion: .finished)
-        return
+      isWaitingForWindow = false
+      write()
+    }
+
+    private func fail(_ error: Error) {
+      finish()
+      pb.send(completion: .failure(error))
+    }
+
+    func finish() {
+      isDone = true
+      isWaitingForWindow = false
+      if let flow = writeFlow {
+        parent.ssh.writeScheduler.unregister(flow)
+        writeFlow = nil
+      }
+      if callbacks != nil {
+        callbacks!.userdata = nil
+        ssh_remove_channel_callbacks(channel, &callbacks!)
+        callbacks = nil
       }
-      // No need to reloop, next will come from demand.
     }
-    
-    return pb.handleEvents(receiveRequest: { _ in
-      // We may either put the buffer, or we need the perform in rloop. I opted for this here as it does both,
-      // schedule the read at the rloop so the pb will receive the demand,
-      // and remove a subscriber as the operation will obviously be done at the rloop.
-      self.ssh.rloop.perform { readNonBlock() }
-    })
-    .flatMap(maxPublishers: .max(1)) { data -> AnyPublisher<Int, Error> in
-      if data.count == 0 {
-        return .just(0)
+
+    private func startCallbacks() -> Int32 {
+      callbacks = ssh_channel_callbacks_struct()
+      ssh_init_channel_callbacks(&callbacks!)
+      callbacks!.userdata = UnsafeMutableRawPointer(Unmanaged.passUnretained(self).toOpaque())
+      callbacks!.channel_write_wontblock_function = self.writeWontBlockCallback
+      return ssh_add_channel_callbacks(channel, &callbacks!)
+    }
+
+    private let writeWontBlockCallback: ssh_channel_write_wontblock_callback = { (session, channel, bytes, userdata) -> Int32 in
+      guard let userdata = userdata else {
+        return 0
       }
-      return t.write(data, max: data.count)
+      let ctxt = Unmanaged<Writing>.fromOpaque(userdata).takeUnretainedValue()
+      ctxt.parent.ssh.perform { ctxt.windowAvailable() }
+      return 0
     }
-    .eraseToAnyPublisher()
+  }
+}
+
+extension SCPClient {
+  // Perform a copy where SCPClient is the Source, and the Translator is the Sink.
+  // In this scenario the Source is driving the operation, so we do not know
+  // what we will receive to copy. Progress is reported per file, with the total
+  // written to it and its overhead.
+  public func copy(to t: Translator) -> CopyProgressInfoPublisher {
+    let sink = SCPSink(self, to: t)
+    return sink.progress
+      // Files are written concurrently, so progress does not wait on demand.
+      .buffer(size: Int.max, prefetch: .keepFull, whenFull: .dropOldest)
+      .handleEvents(receiveSubscription: { _ in self.ssh.perform { sink.start() } },
+                    receiveCancel: { self.ssh.perform { sink.cancel() } })
+      .eraseToAnyPublisher()
   }
 }
@@ -0,0 +1,462 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+import Combine
+import Foundation
+import FlowConsoleFiles
+import LibSSH
+
+
+/**
+ Receives a recursive SCP transfer into a Translator, with remote reads overlapping local writes.
+
+ The protocol is sequential, so the channel is read in order, but each file is handed to its own
+ local writer and the next request is pulled without waiting for it to be written. The data
+ waiting to be written is bounded by `maxPendingFiles` and `maxPendingBytes`, and reading
+ pauses until the writers catch up. Directories are created as their requests arrive, without
+ waiting either, and the files inside write once their directory is ready. Small files are
+ buffered whole and written with a single write.
+
+ Everything but the local writes runs on the loop of the client.
+ */
+final class SCPSink {
+  static let maxPendingFiles = 32
+  static let maxPendingBytes = 16 * 1024 * 1024
+  static let smallFileSize = 256 * 1024
+  static let chunkSize = 256 * 1024
+
+  let client: SCPClient
+  var ssh: SSHClient { client.ssh }
+  var scp: ssh_scp { client.scp }
+  var channel: ssh_channel { client.channel! }
+
+  let progress = PassthroughSubject<CopyProgressInfo, Error>()
+
+  private var dirs: [AnyPublisher<Translator, Error>]
+  private var jobs: [ObjectIdentifier: FileJob] = [:]
+  private var dirCreations: [AnyCancellable] = []
+  private var pendingBytes = 0
+  // File being read from the channel.
+  private var reading: FileJob? = nil
+  private var sourceDone = false
+  private var isDone = false
+  private var isWaitingForData = false
+  private var callbacks: ssh_channel_callbacks_struct? = nil
+
+  init(_ client: SCPClient, to root: Translator) {
+    self.client = client
+    self.dirs = [.just(root)]
+  }
+
+  func start() {
+    if startCallbacks() != SSH_OK {
+      fail(SSHError(title: "Could not initialize callbacks.", forSession: ssh.session))
+      return
+    }
+    step()
+  }
+
+  func cancel() {
+    finish()
+    jobs.values.forEach { $0.cancel() }
+    jobs = [:]
+    dirCreations = []
+  }
+
+  // Either keep reading the current file or pull the next request, while there is room.
+  private func step() {
+    guard !isDone else {
+      return
+    }
+    if reading != nil {
+      readFile()
+      return
+    }
+    guard !sourceDone else {
+      completeIfDone()
+      return
+    }
+    guard jobs.count < Self.maxPendingFiles, pendingBytes < Self.maxPendingBytes else {
+      // Resumed once a writer is done with something.
+      return
+    }
+
+    let req = ssh_scp_pull_request(scp)
+    let requested = Date()
+    if req == SSH_SCP_REQUEST_EOF.rawValue {
+      sourceDone = true
+      completeIfDone()
+      return
+    } else if req == SSH_ERROR {
+      fail(SSHError(req, forSession: ssh.session))
+      return
+    } else if req == SSH_AGAIN {
+      waitForData()
+      return
+    }
+
+    switch ssh_scp_request_types(UInt32(req)) {
+    case SSH_SCP_REQUEST_NEWDIR:
+      let name = String(cString: ssh_scp_request_get_filename(scp))
+      let mode = mode_t(ssh_scp_request_get_permissions(scp))
+      guard ssh_scp_accept_request(scp) == SSH_OK else {
+        fail(FileError(title: "Could not accept new directory request", in: ssh.session))
+        return
+      }
+      dirs.insert(createDirectory(name, mode: mode, in: dirs[0]), at: 0)
+    case SSH_SCP_REQUEST_ENDDIR:
+      dirs.removeFirst()
+    case SSH_SCP_REQUEST_NEWFILE:
+      let size = ssh_scp_request_get_size64(scp)
+      let name = String(cString: ssh_scp_request_get_filename(scp))
+      let mode = mode_t(ssh_scp_request_get_permissions(scp))
+      guard ssh_scp_accept_request(scp) == SSH_OK else {
+        fail(FileError(title: "Could not accept new file request", in: ssh.session))
+        return
+      }
+      let job = FileJob(self, name: name, size: size, mode: mode, requested: requested)
+      jobs[ObjectIdentifier(job)] = job
+      job.start(in: dirs[0])
+      reading = job
+    default:
+      // Warnings
+      break
+    }
+    ssh.perform { self.step() }
+  }
+
+  private func readFile() {
+    guard let job = reading else {
+      return
+    }
+    // Small files go to the writer in one piece.
+    let isSmall = job.size <= UInt64(Self.smallFileSize)
+
+    while job.read < job.size || (job.size == 0 && !job.readDone) {
+      let left = Int(job.size - job.read)
+      if left > 0 {
+        let available = Int(ssh_channel_poll(channel, 0))
+        if available < 0 {
+          fail(SSHError(Int32(available), forSession: ssh.session))
+          return
+        } else if available == 0 {
+          waitForData()
+          return
+        }
+        if pendingBytes >= Self.maxPendingBytes && !isSmall {
+          return
+        }
+
+        let size = min(available, left, Self.chunkSize)
+        let buf = UnsafeMutableRawBufferPointer.allocate(byteCount: size, alignment: MemoryLayout<CUnsignedChar>.alignment)
+        let rc = ssh_scp_read(scp, buf.baseAddress, size)
+        if rc < 0 {
+          buf.deallocate()
+          fail(SSHError(rc, forSession: ssh.session))
+          return
+        }
+        let data = DispatchData(bytesNoCopy: UnsafeRawBufferPointer(rebasing: buf[0..<Int(rc)]),
+                                deallocator: .custom(nil) { buf.deallocate() })
+        job.read += UInt64(rc)
+        pendingBytes += Int(rc)
+        if isSmall {
+          job.buffered.append(data)
+        } else {
+          job.enqueue(data)
+        }
+      } else {
+        // Empty files still have to read the status of the transfer.
+        var byte: UInt8 = 0
+        if ssh_scp_read(scp, &byte, 0) < 0 {
+          fail(SSHError(title: "Could not read file status", forSession: ssh.session))
+          return
+        }
+      }
+      job.readDone = job.read == job.size
+    }
+
+    if !job.buffered.isEmpty {
+      job.enqueue(job.buffered)
+      job.buffered = .empty
+    }
+    job.finishReading()
+    reading = nil
+    ssh.perform { self.step() }
+  }
+
+  private func createDirectory(_ name: String, mode: mode_t, in parent: AnyPublisher<Translator, Error>) -> AnyPublisher<Translator, Error> {
+    let dir = parent.flatMap { parent in
+      // Try to create first, as the usual case is a new tree. mkdir moves the translator
+      // into the new directory, and the parent is shared with its other entries.
+      parent.clone().mkdir(name: name, mode: mode)
+        .catch { _ in parent.cloneWalkTo(name) }
+    }.eraseToAnyPublisher()
+
+    // Start right away, and replay the result to the files inside.
+    let ready = ReplaySubject<Translator>()
+    dir.receive(on: ssh.rloop)
+      .sink(receiveCompletion: { completion in
+        if case .failure(let error) = completion {
+          ready.fail(error)
+          self.fail(error)
+        }
+      }, receiveValue: { ready.send($0) })
+      .store(in: &dirCreations)
+    return ready.publisher
+  }
+
+  fileprivate func didWrite(_ job: FileJob, bytes: Int) {
+    pendingBytes -= bytes
+    step()
+  }
+
+  fileprivate func didFinish(_ job: FileJob) {
+    jobs.removeValue(forKey: ObjectIdentifier(job))
+    step()
+  }
+
+  fileprivate func fail(_ error: Error) {
+    guard !isDone else {
+      return
+    }
+    cancel()
+    progress.send(completion: .failure(error))
+  }
+
+  private func completeIfDone() {
+    if sourceDone && jobs.isEmpty && !isDone {
+      finish()
+      progress.send(completion: .finished)
+    }
+  }
+
+  private func finish() {
+    isDone = true
+    if callbacks != nil {
+      callbacks!.userdata = nil
+      ssh_remove_channel_callbacks(channel, &callbacks!)
+      callbacks = nil
+    }
+  }
+
+  // MARK: Waiting for data
+
+  private func waitForData() {
+    guard !isWaitingForData else {
+      return
+    }
+    isWaitingForData = true
+    // The data callback resumes. Check again in a while in case data arrived before we listened.
+    ssh.rloop.schedule(after: .init(Date(timeIntervalSinceNow: 0.05))) {
+      self.dataAvailable()
+    }
+  }
+
+  private func dataAvailable() {
+    guard isWaitingForData else {
+      return
+    }
+    isWaitingForData = false
+    step()
+  }
+
+  private func startCallbacks() -> Int32 {
+    callbacks = ssh_channel_callbacks_struct()
+    ssh_init_channel_callbacks(&callbacks!)
+    callbacks!.userdata = UnsafeMutableRawPointer(Unmanaged.passUnretained(self).toOpaque())
+    callbacks!.channel_data_function = self.hasDataCallback
+    return ssh_add_channel_callbacks(channel, &callbacks!)
+  }
+
+  private let hasDataCallback: ssh_channel_data_callback = { (session, channel, buf, length, is_stderr, userdata) -> Int32 in
+    guard let userdata = userdata else {
+      return 0
+    }
+    let ctxt = Unmanaged<SCPSink>.fromOpaque(userdata).takeUnretainedValue()
+    // Leave the data on the channel, scp reads it.
+    ctxt.ssh.perform { ctxt.dataAvailable() }
+    return 0
+  }
+}
+
+// Writes one file as its data arrives. State only changes on the client loop.
+fileprivate final class FileJob {
+  unowned let sink: SCPSink
+  let name: String
+  let size: UInt64
+  let mode: mode_t
+  let requested: Date
+
+  var read: UInt64 = 0
+  var readDone = false
+  var buffered = DispatchData.empty
+  private var queue: [DispatchData] = []
+  private var readingFinished = false
+  private var file: File? = nil
+  private var isWriting = false
+  private var written: UInt64 = 0
+  private var overhead: TimeInterval = 0
+  private var cancellables: [AnyCancellable] = []
+
+  init(_ sink: SCPSink, name: String, size: UInt64, mode: mode_t, requested: Date) {
+    self.sink = sink
+    self.name = name
+    self.size = size
+    self.mode = mode
+    self.requested = requested
+  }
+
+  func start(in dir: AnyPublisher<Translator, Error>) {
+    dir.flatMap { $0.create(name: self.name, mode: self.mode) }
+      .receive(on: sink.ssh.rloop)
+      .sink(receiveCompletion: { completion in
+        if case .failure(let error) = completion {
+          self.sink.fail(error)
+        }
+      }, receiveValue: { file in
+        self.file = file
+        self.overhead += Date().timeIntervalSince(self.requested)
+        self.drain()
+      })
+      .store(in: &cancellables)
+  }
+
+  func enqueue(_ data: DispatchData) {
+    queue.append(data)
+    drain()
+  }
+
+  func finishReading() {
+    readingFinished = true
+    drain()
+  }
+
+  func cancel() {
+    cancellables = []
+  }
+
+  private func drain() {
+    guard let file = file, !isWriting else {
+      return
+    }
+
+    guard !queue.isEmpty else {
+      if readingFinished {
+        close(file)
+      }
+      return
+    }
+
+    let data = queue.removeFirst()
+    isWriting = true
+    file.write(data, max: data.count)
+      .receive(on: sink.ssh.rloop)
+      .sink(receiveCompletion: { completion in
+        if case .failure(let error) = completion {
+          self.sink.fail(error)
+          return
+        }
+        self.isWriting = false
+        self.sink.didWrite(self, bytes: data.count)
+        self.drain()
+      }, receiveValue: { written in
+        self.written += UInt64(written)
+        self.sink.progress.send(CopyProgressInfo(name: self.name, written: self.written, size: self.size, overhead: self.overhead))
+      })
+      .store(in: &cancellables)
+  }
+
+  private func close(_ file: File) {
+    isWriting = true
+    let closing = Date()
+    file.close()
+      .receive(on: sink.ssh.rloop)
+      .sink(receiveCompletion: { completion in
+        if case .failure(let error) = completion {
+          self.sink.fail(error)
+          return
+        }
+        self.overhead += Date().timeIntervalSince(closing)
+        // The final report, also the only one for empty files.
+        self.sink.progress.send(CopyProgressInfo(name: self.name, written: self.written, size: self.size, overhead: self.overhead))
+        self.cancellables = []
+        self.sink.didFinish(self)
+      }, receiveValue: { _ in })
+      .store(in: &cancellables)
+  }
+}
+
+// Holds the result of a publisher for subscribers that come later.
+fileprivate final class ReplaySubject<Output> {
+  private var result: Result<Output, Error>? = nil
+  private var waiting: [PassthroughSubject<Output, Error>] = []
+  private let lock = NSLock()
+
+  var publisher: AnyPublisher<Output, Error> {
+    Deferred { () -> AnyPublisher<Output, Error> in
+      self.lock.lock()
+      defer { self.lock.unlock() }
+      switch self.result {
+      case .success(let value)?:
+        return .just(value)
+      case .failure(let error)?:
+        return .fail(error: error)
+      case nil:
+        let subject = PassthroughSubject<Output, Error>()
+        self.waiting.append(subject)
+        return subject.buffer(size: 1, prefetch: .keepFull, whenFull: .dropOldest).eraseToAnyPublisher()
+      }
+    }.eraseToAnyPublisher()
+  }
+
+  func send(_ value: Output) {
+    complete(.success(value))
+  }
+
+  func fail(_ error: Error) {
+    complete(.failure(error))
+  }
+
+  private func complete(_ result: Result<Output, Error>) {
+    lock.lock()
+    self.result = result
+    let waiting = self.waiting
+    self.waiting = []
+    lock.unlock()
+    waiting.forEach { subject in
+      switch result {
+      case .success(let value):
+        subject.send(value)
+        subject.send(completion: .finished)
+      case .failure(let error):
+        subject.send(completion: .failure(error))
+      }
+    }
+  }
+}
@@ -61,11 +61,60 @@ public class SFTPClient {
   let sftp: sftp_session
   let rloop: RunLoop
   let channel: ssh_channel
+  // All files on the session share the flow. Writes go in blocks, so allow a couple per turn.
+  let writeFlow: SSHWriteScheduler.Flow
   var log: SSHLogger { get { client.log } }
+  // Exec channels on the same connection may be used for faster paths, like tar for
+  // trees or find for listings. Turn off for accounts restricted to SFTP.
+  public var usesExec = true
+  // What the remote can run. Checked once per session.
+  var hasTar: Bool? = nil
+  var hasFind: Bool? = nil
+  var hashCommands: [HashAlgorithm: Bool] = [:]
+  private var batchChannel: SFTPBatch? = nil
+  private var batchFailed = false
+
+  // Extensions advertised by the server that we know how to use.
+  lazy var capabilities: ServerCapabilities = {
+    let extensions: [(String, String, ServerCapabilities)] = [
+      ("copy-data", "1", .copyData),
+      ("posix-rename@openssh.com", "1", .atomicRename),
+      ("statvfs@openssh.com", "2", .statvfs),
+      ("hardlink@openssh.com", "1", .hardlink),
+      ("limits@openssh.com", "1", .limits),
+    ]
+    return extensions.reduce(into: []) { caps, ext in
+      if sftp_extension_supported(self.sftp, ext.0, ext.1) != 0 {
+        caps.insert(ext.2)
+      }
+    }
+  }()
+
+  static let defaultBlockSize = 32 * 1024
+  // Larger blocks than this do not move data faster, and take more of the window.
+  static let maxBlockSize = 256 * 1024
+  // Size of reads and writes on files. Follows the limits of the server when advertised, and
+  // never more than the scheduler can grant in a turn, as blocks are written whole.
+  // Only from the client loop.
+  lazy var blockSize: Int = {
+    guard self.capabilities.contains(.limits), let batch = self.batch() else {
+      return Self.defaultBlockSize
+    }
+    do {
+      let limits = try batch.limits()
+      let advertised = [limits.maxReadLength, limits.maxWriteLength].filter { $0 > 0 }.min()
+      let maxBlockSize = min(Self.maxBlockSize, self.client.writeScheduler.bulkBudgetPerTurn)
+      return advertised.map { Int(min($0, UInt64(maxBlockSize))) } ?? Self.defaultBlockSize
+    } catch {
+      self.log.message("Could not read SFTP limits. \(error)", SSH_LOG_INFO)
+      return Self.defaultBlockSize
+    }
+  }()
   
   init?(on channel: ssh_channel, client: SSHClient) {
     self.client = client
     self.channel = channel
+    self.writeFlow = client.writeScheduler.register(.bulk(weight: 2))
     
     guard let sftp = sftp_new_channel(client.session, channel) else {
       return nil
@@ -85,7 +134,29 @@ public class SFTPClient {
     }
   }
   
+  // Channel for pipelined metadata requests, opened on first use. If it cannot be opened,
+  // for example over the session limit of the server, requests go through libssh. Only
+  // from the client loop.
+  func batch() -> SFTPBatch? {
+    if batchChannel == nil && !batchFailed {
+      do {
+        batchChannel = try SFTPBatch(on: client)
+      } catch {
+        log.message("SFTP batch channel not available. \(error)", SSH_LOG_INFO)
+        batchFailed = true
+      }
+    }
+    return batchChannel
+  }
+
+  func dropBatch() {
+    batchChannel = nil
+    batchFailed = true
+  }
+  
   deinit {
+    let (client, flow) = (self.client, self.writeFlow)
+    client.perform { client.writeScheduler.unregister(flow) }
     self.client.closeSFTP(sftp)
     print("SFTP Out!!")
   }
@@ -118,12 +189,28 @@ public class SFTPTranslator: FlowConsoleFiles.Translator {
     self.path = base.path
     self.fileType = base.fileType
   }
+
+  // For items the server already told us about, without walking to them.
+  convenience init(from base: SFTPTranslator, at path: String, type: FileAttributeType) {
+    self.init(from: base)
+    self.path = path
+    self.fileType = type
+  }
   
   func connection() -> AnyPublisher<sftp_session, Error> {
     return .init(Just(sftp).subscribe(on: rloop).setFailureType(to: Error.self))
   }
   
   private func canonicalize(_ path: String) throws -> (String, FileAttributeType) {
+    if let batch = sftpClient.batch() {
+      do {
+        return try canonicalize(path, with: batch)
+      } catch let error as SSHError {
+        log.message("SFTP batch failed, canonicalizing through libssh. \(error)", SSH_LOG_WARN)
+        sftpClient.dropBatch()
+      }
+    }
+
     ssh_channel_set_blocking(channel, 1)
     defer { ssh_channel_set_blocking(channel, 0) }
     
@@ -155,6 +242,35 @@ public class SFTPTranslator: FlowConsoleFiles.Translator {
     return (String(cString: canonicalPath), type)
   }
   
+  // realpath, stat and opendir go out together, on the path as given, which resolves to
+  // the same item. The directory handle is closed without waiting for the reply.
+  private func canonicalize(_ path: String, with batch: SFTPBatch) throws -> (String, FileAttributeType) {
+    let target = path.isEmpty ? "." : path
+    let replies = try batch.send([.realpath(target), .stat(target), .opendir(target)])
+    if case let .handle(handle) = replies[2] {
+      try batch.post(.close(handle))
+    }
+
+    guard case let .name(canonicalPath) = replies[0] else {
+      throw FileError.Fail(msg: "Could not canonicalize path")
+    }
+    guard case let .attrs(attrs) = replies[1] else {
+      throw FileError.Fail(msg: "\(canonicalPath) No such file or directory.")
+    }
+
+    switch attrs.permissions.map({ mode_t(truncatingIfNeeded: $0) & S_IFMT }) {
+    case S_IFDIR:
+      guard case .handle = replies[2] else {
+        throw FileError.Fail(msg: "No permission.")
+      }
+      return (canonicalPath, .typeDirectory)
+    case S_IFREG:
+      return (canonicalPath, .typeRegular)
+    default:
+      return (canonicalPath, .typeUnknown)
+    }
+  }
+  
   public func clone() -> Translator {
     return SFTPTranslator(from: self)
   }
@@ -391,6 +507,13 @@ public class SFTPTranslator: FlowConsoleFiles.Translator {
         newPath = (newPath as NSString).appendingPathComponent(newName)
       }
       
+      // Plain SFTP renames fail if the destination exists.
+      if self.sftpClient.capabilities.contains(.atomicRename), let batch = self.sftpClient.batch() {
+        let request = SSHEncode.data(from: Data(self.path.utf8)) + SSHEncode.data(from: Data(newPath.utf8))
+        try batch.perform(.extended("posix-rename@openssh.com", request), failing: "Could not rename file")
+        return true
+      }
+      
       let rc = sftp_rename(sftp, self.path, newPath)
       if rc != SSH_OK {
         throw FileError(title: "Could not rename file", in: self.session)
@@ -479,7 +602,7 @@ public class SFTPFile : FlowConsoleFiles.File {
   
   var inflightReads: [UInt32] = []
   var inflightWrites: [UInt32] = []
-  let blockSize = 32 * 1024
+  let blockSize: Int
   let maxConcurrentOps = 20
   var demand: Subscribers.Demand = .none
   var pub: PassthroughSubject<DispatchData, Error>!
@@ -487,6 +610,7 @@ public class SFTPFile : FlowConsoleFiles.File {
   init(_ file: sftp_file, in sftpClient: SFTPClient) {
     self.sftpClient = sftpClient
     self.file = file
+    self.blockSize = sftpClient.blockSize
     
     sftp_file_set_nonblocking(file)
   }
@@ -692,7 +816,10 @@ extension SFTPFile: FlowConsoleFiles.Writer {
         }
       }
       
-      // Schedule more writes
+      // Schedule more writes, as long as the connection lets this channel write.
+      let scheduler = sftpClient.client.writeScheduler
+      var allowance = scheduler.grant(sftpClient.writeFlow,
+                                      wanting: min(write.count, (self.maxConcurrentOps - inflightWrites.count) * self.blockSize))
       while inflightWrites.count < self.maxConcurrentOps && write.count > 0 {
         var asyncRequest: UInt32 = 0
         let length = write.count < self.blockSize ? write.count : self.blockSize
@@ -701,6 +828,10 @@ extension SFTPFile: FlowConsoleFiles.Writer {
         if ssh_channel_window_size(self.channel) < length {
           break
         }
+        // Blocks are written whole, the rest has to wait for the next turn.
+        if allowance < length {
+          break
+        }
         
         let rc = write.withUnsafeBytes { bytes -> Int32 in
           return sftp_async_write(self.file, bytes, length, &asyncRequest)
@@ -712,6 +843,8 @@ extension SFTPFile: FlowConsoleFiles.Writer {
         }
         
         inflightWrites.append(asyncRequest)
+        scheduler.didWrite(sftpClient.writeFlow, bytes: length)
+        allowance -= length
         write = write.subdata(in: length..<write.count)
       }
       
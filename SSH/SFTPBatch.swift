@@ -0,0 +1,478 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import Combine
+import Foundation
+
+import FlowConsoleFiles
+import LibSSH
+
+
+/**
+ Metadata requests sent together on a second SFTP channel, with the replies read once all
+ of them are out. libssh waits for the reply of each request before sending the next one,
+ so a batch here costs about one round trip where it would cost one per request.
+ It speaks the few SFTP v3 messages it needs. Calls block, and must be made on the client loop
+ like the rest of SFTP calls.
+ */
+final class SFTPBatch {
+  enum Request {
+    case stat(String)
+    case realpath(String)
+    case opendir(String)
+    case close(Data)
+    // SFTP v3 open flags (SSH_FXF_*), and permissions for files created by it.
+    case open(String, flags: UInt32, permissions: UInt32?)
+    case extended(String, Data)
+  }
+
+  enum Reply {
+    case attrs(Attributes)
+    case name(String)
+    case handle(Data)
+    case status(code: UInt32, message: String)
+    case extended(Data)
+  }
+
+  struct Attributes {
+    var size: UInt64? = nil
+    var permissions: UInt32? = nil
+    var mtime: UInt32? = nil
+  }
+
+  // From limits@openssh.com. Zero when the server has no limit.
+  struct Limits {
+    let maxPacketLength: UInt64
+    let maxReadLength: UInt64
+    let maxWriteLength: UInt64
+    let maxOpenHandles: UInt64
+  }
+
+  // SFTP v3 message types.
+  private enum Message: UInt8 {
+    case initialize = 1
+    case version = 2
+    case open = 3
+    case close = 4
+    case opendir = 11
+    case realpath = 16
+    case stat = 17
+    case status = 101
+    case handle = 102
+    case name = 104
+    case attrs = 105
+    case extended = 200
+    case extendedReply = 201
+  }
+
+  // Requests written before reading replies. Keeps the replies within our window.
+  static let maxInFlight = 256
+  // Larger replies are not something we asked for. Same bound as sftp-server.
+  static let maxReplyLength = 256 * 1024
+
+  let client: SSHClient
+  let channel: ssh_channel
+  private var nextId: UInt32 = 1
+  // Requests whose replies nobody waits for. They are dropped when read.
+  private var posted = Set<UInt32>()
+
+  init(on client: SSHClient) throws {
+    guard let channel = ssh_channel_new(client.session) else {
+      throw SSHError(title: "Could not create channel")
+    }
+    self.client = client
+    self.channel = channel
+
+    ssh_channel_set_blocking(channel, 1)
+    defer { ssh_channel_set_blocking(channel, 0) }
+    var rc = ssh_channel_open_session(channel)
+    if rc == SSH_OK {
+      rc = ssh_channel_request_sftp(channel)
+    }
+    if rc != SSH_OK {
+      throw SSHError(rc, forSession: client.session)
+    }
+
+    try write(packet(.initialize, SSHEncode.data(from: UInt32(3))))
+    let (type, _) = try readPacket()
+    guard type == Message.version.rawValue else {
+      throw SSHError(title: "Unexpected SFTP version reply")
+    }
+  }
+
+  deinit {
+    client.closeChannel(channel)
+  }
+
+  func send(_ requests: [Request]) throws -> [Reply] {
+    ssh_channel_set_blocking(channel, 1)
+    defer { ssh_channel_set_blocking(channel, 0) }
+
+    var replies: [Reply?] = Array(repeating: nil, count: requests.count)
+    var start = 0
+    while start < requests.count {
+      let end = min(start + Self.maxInFlight, requests.count)
+      var waiting: [UInt32: Int] = [:]
+      var out = Data()
+      for idx in start..<end {
+        let (id, data) = encode(requests[idx])
+        waiting[id] = idx
+        out += data
+      }
+      try write(out)
+
+      while !waiting.isEmpty {
+        let (type, body) = try readPacket()
+        var rest = body[...]
+        let id = try Self.uint32(&rest)
+        if posted.remove(id) != nil {
+          continue
+        }
+        guard let idx = waiting.removeValue(forKey: id) else {
+          throw SSHError(title: "Unexpected SFTP reply")
+        }
+        replies[idx] = try decode(type, &rest)
+      }
+      start = end
+    }
+    return replies.map { $0! }
+  }
+
+  // Sends the request without waiting for its reply.
+  func post(_ request: Request) throws {
+    ssh_channel_set_blocking(channel, 1)
+    defer { ssh_channel_set_blocking(channel, 0) }
+
+    let (id, data) = encode(request)
+    try write(data)
+    posted.insert(id)
+  }
+
+  private func encode(_ request: Request) -> (UInt32, Data) {
+    let id = nextId
+    nextId &+= 1
+    let idData = SSHEncode.data(from: id)
+    switch request {
+    case .stat(let path):
+      return (id, packet(.stat, idData + SSHEncode.data(from: Data(path.utf8))))
+    case .realpath(let path):
+      return (id, packet(.realpath, idData + SSHEncode.data(from: Data(path.utf8))))
+    case .opendir(let path):
+      return (id, packet(.opendir, idData + SSHEncode.data(from: Data(path.utf8))))
+    case .close(let handle):
+      return (id, packet(.close, idData + SSHEncode.data(from: handle)))
+    case .open(let path, let flags, let permissions):
+      var attrs = SSHEncode.data(from: UInt32(0))
+      if let permissions = permissions {
+        attrs = SSHEncode.data(from: UInt32(SSH_FILEXFER_ATTR_PERMISSIONS)) + SSHEncode.data(from: permissions)
+      }
+      return (id, packet(.open, idData + SSHEncode.data(from: Data(path.utf8)) + SSHEncode.data(from: flags) + attrs))
+    case .extended(let name, let data):
+      return (id, packet(.extended, idData + SSHEncode.data(from: Data(name.utf8)) + data))
+    }
+  }
+
+  private func decode(_ type: UInt8, _ body: inout Data) throws -> Reply {
+    switch Message(rawValue: type) {
+    case .attrs:
+      return .attrs(try Self.attributes(&body))
+    case .handle:
+      return .handle(try Self.bytes(&body))
+    case .name:
+      // Realpath replies carry a single name.
+      guard try Self.uint32(&body) > 0,
+            let name = String(data: try Self.bytes(&body), encoding: .utf8) else {
+        throw SSHError(title: "Invalid SFTP name reply")
+      }
+      return .name(name)
+    case .status:
+      let code = try Self.uint32(&body)
+      let message = body.count >= 4 ? (String(data: try Self.bytes(&body), encoding: .utf8) ?? "") : ""
+      return .status(code: code, message: message)
+    case .extendedReply:
+      return .extended(Data(body))
+    default:
+      throw SSHError(title: "Unexpected SFTP reply type \(type)")
+    }
+  }
+
+  // For requests answered with a status. Throws the message of the server if it failed.
+  func perform(_ request: Request, failing title: String) throws {
+    let reply = try send([request])[0]
+    switch reply {
+    case .status(code: UInt32(SSH_FX_OK), _):
+      return
+    case .status(_, let message):
+      throw FileError.Fail(msg: "\(title). \(message)")
+    default:
+      throw SSHError(title: "Unexpected SFTP reply")
+    }
+  }
+
+  func limits() throws -> Limits {
+    guard case var .extended(body) = try send([.extended("limits@openssh.com", Data())])[0],
+          body.count >= 32 else {
+      throw SSHError(title: "Invalid SFTP limits reply")
+    }
+    return Limits(maxPacketLength: try Self.uint64(&body),
+                  maxReadLength: try Self.uint64(&body),
+                  maxWriteLength: try Self.uint64(&body),
+                  maxOpenHandles: try Self.uint64(&body))
+  }
+
+  // Replies come from the server, so unlike SSHDecode, fields are checked against what is left
+  // and a short reply throws instead of trapping.
+  static func uint8(_ body: inout Data) throws -> UInt8 {
+    guard let value = body.first else {
+      throw SSHError(title: "Truncated SFTP reply")
+    }
+    body = body.dropFirst()
+    return value
+  }
+
+  static func uint32(_ body: inout Data) throws -> UInt32 {
+    guard body.count >= 4 else {
+      throw SSHError(title: "Truncated SFTP reply")
+    }
+    return SSHDecode.uint32(&body)
+  }
+
+  static func uint64(_ body: inout Data) throws -> UInt64 {
+    UInt64(try uint32(&body)) << 32 | UInt64(try uint32(&body))
+  }
+
+  static func bytes(_ body: inout Data) throws -> Data {
+    var rest = body
+    let length = Int(try uint32(&rest))
+    guard rest.count >= length else {
+      throw SSHError(title: "Truncated SFTP reply")
+    }
+    return SSHDecode.bytes(&body)
+  }
+
+  static func data(from int: UInt64) -> Data {
+    SSHEncode.data(from: UInt32(truncatingIfNeeded: int >> 32)) + SSHEncode.data(from: UInt32(truncatingIfNeeded: int))
+  }
+
+  private static func attributes(_ body: inout Data) throws -> Attributes {
+    var attrs = Attributes()
+    let flags = try Self.uint32(&body)
+    if flags & UInt32(SSH_FILEXFER_ATTR_SIZE) != 0 {
+      attrs.size = try Self.uint64(&body)
+    }
+    if flags & UInt32(SSH_FILEXFER_ATTR_UIDGID) != 0 {
+      _ = try Self.uint32(&body)
+      _ = try Self.uint32(&body)
+    }
+    if flags & UInt32(SSH_FILEXFER_ATTR_PERMISSIONS) != 0 {
+      attrs.permissions = try Self.uint32(&body)
+    }
+    if flags & UInt32(SSH_FILEXFER_ATTR_ACMODTIME) != 0 {
+      _ = try Self.uint32(&body)
+      attrs.mtime = try Self.uint32(&body)
+    }
+    // Extended attributes are not used.
+    return attrs
+  }
+
+  private func packet(_ type: Message, _ payload: Data) -> Data {
+    SSHEncode.data(from: UInt32(payload.count + 1)) + Data([type.rawValue]) + payload
+  }
+
+  private func write(_ data: Data) throws {
+    let rc = data.withUnsafeBytes { ssh_channel_write(channel, $0.baseAddress, UInt32(data.count)) }
+    if rc != data.count {
+      throw SSHError(title: "Could not write SFTP request")
+    }
+  }
+
+  private func readPacket() throws -> (UInt8, Data) {
+    var header = try read(4)
+    let length = Int(try Self.uint32(&header))
+    // A packet carries at least its type.
+    guard length > 0, length <= Self.maxReplyLength else {
+      throw SSHError(title: "Invalid SFTP packet length \(length)")
+    }
+    var body = try read(length)
+    let type = try Self.uint8(&body)
+    return (type, Data(body))
+  }
+
+  private func read(_ count: Int) throws -> Data {
+    var data = Data(count: count)
+    var received = 0
+    while received < count {
+      let rc = data.withUnsafeMutableBytes { buf in
+        ssh_channel_read(channel, buf.baseAddress! + received, UInt32(count - received), 0)
+      }
+      if rc < 0 || (rc == 0 && (ssh_channel_is_eof(channel) != 0 || ssh_channel_is_open(channel) == 0)) {
+        throw SSHError(title: "SFTP batch channel closed")
+      }
+      received += Int(rc)
+    }
+    return data
+  }
+}
+
+extension SFTPTranslator: BatchStatTranslator {
+  public func statTargets(of names: [String]) -> AnyPublisher<[String: FileAttributes], Error> {
+    if names.isEmpty {
+      return .just([:])
+    }
+    guard sftpClient.usesExec, sftpClient.hasFind != false else {
+      return batchStat(names)
+    }
+
+    return findTargets(names)
+      .handleEvents(receiveOutput: { _ in self.sftpClient.hasFind = true })
+      .catch { error -> AnyPublisher<[String: FileAttributes], Error> in
+        self.log.message("Remote find not usable, stating through SFTP. \(error)", SSH_LOG_INFO)
+        self.sftpClient.hasFind = false
+        return self.batchStat(names)
+      }.eraseToAnyPublisher()
+  }
+
+  // A single exec of GNU find, following the links. Broken links come back as links and are
+  // left out. Names are sent in chunks to stay within command line limits.
+  private func findTargets(_ names: [String]) -> AnyPublisher<[String: FileAttributes], Error> {
+    var chunks: [[String]] = [[]]
+    var length = 0
+    for name in names {
+      if length > 32 * 1024 {
+        chunks.append([])
+        length = 0
+      }
+      chunks[chunks.count - 1].append(name)
+      length += name.utf8.count + 6
+    }
+
+    return chunks.publisher
+      .setFailureType(to: Error.self)
+      .flatMap(maxPublishers: .max(1)) { chunk -> AnyPublisher<[String: FileAttributes], Error> in
+        let paths = chunk.map { ("./" + $0).shellQuoted }.joined(separator: " ")
+        let output = SFTPExecOutput(maxLength: 16 * 1024 * 1024)
+        return self.exec("cd \(self.path.shellQuoted) && find -L \(paths) -maxdepth 0 -printf '%y\\t%s\\t%m\\t%T@\\t%p\\0'",
+                         stdout: output)
+          .tryMap { status in
+            if output.isTruncated {
+              throw FileError.Fail(msg: "Remote find output too large")
+            }
+            let targets = Self.parseFind(output.data)
+            if targets.isEmpty, let status = status, status != 0 {
+              throw FileError.Fail(msg: "find exited with status \(status)")
+            }
+            return targets
+          }.eraseToAnyPublisher()
+      }
+      .reduce([String: FileAttributes]()) { $0.merging($1) { first, _ in first } }
+      .eraseToAnyPublisher()
+  }
+
+  static func parseFind(_ data: Data) -> [String: FileAttributes] {
+    var targets: [String: FileAttributes] = [:]
+    for record in data.split(separator: 0) {
+      let fields = String(decoding: record, as: UTF8.self).split(separator: "\t", maxSplits: 4,
+                                                                  omittingEmptySubsequences: false)
+      guard fields.count == 5,
+            let size = UInt64(fields[1]),
+            let mode = Int16(fields[2], radix: 8),
+            let mtime = Double(fields[3]) else {
+        continue
+      }
+      let type: FileAttributeType
+      switch fields[0] {
+      case "f": type = .typeRegular
+      case "d": type = .typeDirectory
+      // With -L, only broken links are still links.
+      case "l": continue
+      default: type = .typeBlockSpecial
+      }
+      var name = String(fields[4])
+      if name.hasPrefix("./") {
+        name.removeFirst(2)
+      }
+      targets[name] = [.type: type,
+                       .name: name,
+                       .size: NSNumber(value: size),
+                       .posixPermissions: mode,
+                       .modificationDate: NSDate(timeIntervalSince1970: mtime)]
+    }
+    return targets
+  }
+
+  private func batchStat(_ names: [String]) -> AnyPublisher<[String: FileAttributes], Error> {
+    connection().tryMap { _ -> [String: FileAttributes] in
+      guard let batch = self.sftpClient.batch() else {
+        throw FileError.Fail(msg: "SFTP batch channel not available")
+      }
+      let replies: [SFTPBatch.Reply]
+      do {
+        replies = try batch.send(names.map { .stat((self.path as NSString).appendingPathComponent($0)) })
+      } catch {
+        self.sftpClient.dropBatch()
+        throw error
+      }
+
+      var targets: [String: FileAttributes] = [:]
+      for (name, reply) in zip(names, replies) {
+        if case let .attrs(attrs) = reply {
+          targets[name] = self.parseItemAttributes(attrs, name: name)
+        }
+      }
+      return targets
+    }.eraseToAnyPublisher()
+  }
+
+  func parseItemAttributes(_ attrs: SFTPBatch.Attributes, name: String) -> FileAttributes {
+    var item: FileAttributes = [.name: name]
+
+    if let permissions = attrs.permissions {
+      switch mode_t(truncatingIfNeeded: permissions) & S_IFMT {
+      case S_IFREG:
+        item[.type] = FileAttributeType.typeRegular
+      case S_IFDIR:
+        item[.type] = FileAttributeType.typeDirectory
+      case S_IFLNK:
+        item[.type] = FileAttributeType.typeSymbolicLink
+      case S_IFCHR, S_IFBLK, S_IFIFO, S_IFSOCK:
+        item[.type] = FileAttributeType.typeBlockSpecial
+      default:
+        item[.type] = FileAttributeType.typeUnknown
+      }
+      // Get rid of the upper 4 bits (which are the file type)
+      item[.posixPermissions] = Int16(permissions & 0x0FFF)
+    }
+    if let size = attrs.size {
+      item[.size] = NSNumber(value: size)
+    }
+    if let mtime = attrs.mtime, mtime > 0 {
+      item[.modificationDate] = NSDate(timeIntervalSince1970: Double(mtime))
+    }
+    return item
+  }
+}
@@ -0,0 +1,112 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import Combine
+import Foundation
+
+import FlowConsoleFiles
+import LibSSH
+
+
+extension SFTPTranslator: ServerSideTranslator {
+  // Each part of a server side copy blocks the client loop until the server is done with it, and
+  // the loop may be shared with other sessions. Parts are kept small, so a slow disk on the server
+  // stalls them for a short time only, at the cost of a round trip per part.
+  static let serverCopyLength: UInt64 = 4 * 1024 * 1024
+
+  public var capabilities: ServerCapabilities { sftpClient.capabilities }
+
+  // Both paths are opened through our session. Only the same connection is sure to see the same
+  // files, as a matching host name may still resolve to another server, or be forwarded elsewhere.
+  public func sharesServer(with t: Translator) -> Bool {
+    guard let other = t as? SFTPTranslator else {
+      return false
+    }
+    return sftpClient.client === other.sftpClient.client
+  }
+
+  public func serverCopy(from t: Translator,
+                         name: String,
+                         size: NSNumber,
+                         attributes: FileAttributes) -> CopyProgressInfoPublisher {
+    let fullFile = isDirectory ? (current as NSString).appendingPathComponent(name) : current
+    let length = size.uint64Value
+
+    return connection().tryMap { _ -> (SFTPBatch, Data, Data) in
+      guard let batch = self.sftpClient.batch() else {
+        throw FileError.Fail(msg: "SFTP batch channel not available")
+      }
+      let replies = try batch.send([
+        .open(t.current, flags: UInt32(SSH_FXF_READ), permissions: nil),
+        .open(fullFile, flags: UInt32(SSH_FXF_WRITE | SSH_FXF_CREAT | SSH_FXF_TRUNC), permissions: UInt32(S_IRWXU))
+      ])
+      switch (replies[0], replies[1]) {
+      case let (.handle(source), .handle(destination)):
+        return (batch, source, destination)
+      default:
+        for case let .handle(handle) in replies {
+          try batch.post(.close(handle))
+        }
+        throw FileError.Fail(msg: "Could not open \(t.current) and \(fullFile) for copy. \(replies)")
+      }
+    }
+    .flatMap { (batch, source, destination) -> CopyProgressInfoPublisher in
+      let closeFiles = self.connection().tryMap { _ -> Void in
+        try batch.perform(.close(source), failing: "Could not close \(t.current)")
+        try batch.perform(.close(destination), failing: "Could not close \(fullFile)")
+      }
+
+      return stride(from: UInt64(0), to: length, by: Int(Self.serverCopyLength)).publisher
+        .setFailureType(to: Error.self)
+        .flatMap(maxPublishers: .max(1)) { offset in
+          self.connection().tryMap { _ -> CopyProgressInfo in
+            let part = min(Self.serverCopyLength, length - offset)
+            // The last part goes to the end, in case the file grew.
+            let request = SSHEncode.data(from: source) + SFTPBatch.data(from: offset) +
+              SFTPBatch.data(from: offset + part < length ? part : 0) +
+              SSHEncode.data(from: destination) + SFTPBatch.data(from: offset)
+            try batch.perform(.extended("copy-data", request), failing: "Could not copy \(t.current)")
+            return CopyProgressInfo(name: fullFile, written: part, size: length)
+          }
+        }
+        .tryCatch { error in
+          closeFiles.flatMap { _ -> CopyProgressInfoPublisher in .fail(error: error) }
+        }
+        .append(
+          closeFiles
+            .flatMap { _ in self.isDirectory ?
+              self.cloneWalkTo(name).flatMap { $0.wstat(attributes) }.eraseToAnyPublisher() :
+              self.wstat(attributes)
+            }
+            .map { _ in CopyProgressInfo(name: fullFile, written: 0, size: length) }
+        )
+        .eraseToAnyPublisher()
+    }
+    .eraseToAnyPublisher()
+  }
+}
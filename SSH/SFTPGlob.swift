@@ -0,0 +1,95 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import Combine
+import Foundation
+
+import FlowConsoleFiles
+import LibSSH
+
+
+// Globs are expanded with a single find on the remote, listing the tree as deep as the glob
+// can match, and matched here so the result is the same as listing it.
+extension SFTPTranslator: GlobTranslator {
+  public func expand(_ glob: Glob) -> AnyPublisher<Translator, Error> {
+    guard sftpClient.usesExec, sftpClient.hasFind != false else {
+      return .fail(error: FileError.Fail(msg: "Remote find not available"))
+    }
+
+    let depth = glob.maxDepth.map { " -maxdepth \($0)" } ?? ""
+    let output = SFTPExecOutput(maxLength: 64 * 1024 * 1024)
+    return exec("cd \(path.shellQuoted) && find . -mindepth 1\(depth) -printf '%y\\t%p\\0'", stdout: output)
+      .tryMap { status -> [(String, Character)] in
+        // A partial listing would silently miss matches.
+        if output.isTruncated {
+          throw FileError.Fail(msg: "Remote find output too large")
+        }
+        // Unreadable directories make find fail, but everything else is still listed.
+        if output.data.isEmpty, let status = status, status != 0 {
+          self.sftpClient.hasFind = false
+          throw FileError.Fail(msg: "find exited with status \(status)")
+        }
+        self.sftpClient.hasFind = true
+        return Self.parseFindPaths(output.data).filter { glob.matches($0.0) }
+      }
+      .flatMap { matches -> AnyPublisher<Translator, Error> in
+        matches.publisher
+          .setFailureType(to: Error.self)
+          .flatMap(maxPublishers: .max(1)) { (relativePath, type) -> AnyPublisher<Translator, Error> in
+            switch type {
+            case "f":
+              return .just(SFTPTranslator(from: self, at: self.appending(relativePath), type: .typeRegular))
+            case "d":
+              return .just(SFTPTranslator(from: self, at: self.appending(relativePath), type: .typeDirectory))
+            default:
+              // Links and others are walked, so they resolve as with a listing.
+              return self.cloneWalkTo(relativePath)
+            }
+          }.eraseToAnyPublisher()
+      }.eraseToAnyPublisher()
+  }
+
+  private func appending(_ relativePath: String) -> String {
+    (path as NSString).appendingPathComponent(relativePath)
+  }
+
+  // Type and path relative to where find ran, from %y\t%p records.
+  static func parseFindPaths(_ data: Data) -> [(String, Character)] {
+    data.split(separator: 0).compactMap { record in
+      let line = String(decoding: record, as: UTF8.self)
+      guard let tab = line.firstIndex(of: "\t"), let type = line.first else {
+        return nil
+      }
+      var path = String(line[line.index(after: tab)...])
+      if path.hasPrefix("./") {
+        path.removeFirst(2)
+      }
+      return (path, type)
+    }
+  }
+}
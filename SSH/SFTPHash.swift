@@ -0,0 +1,83 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import Combine
+import Foundation
+
+import FlowConsoleFiles
+import LibSSH
+
+
+// Files are hashed by sha256sum or b3sum on the remote, so verifying them does not read them back.
+extension SFTPTranslator: HashTranslator {
+  public func canHash(using algorithm: HashAlgorithm) -> AnyPublisher<Bool, Error> {
+    guard sftpClient.usesExec else {
+      return .just(false)
+    }
+    if let canHash = sftpClient.hashCommands[algorithm] {
+      return .just(canHash)
+    }
+
+    let output = SFTPExecOutput()
+    return exec("command -v \(algorithm.command)", stdout: output)
+      .map { status in status == 0 && !output.text.isEmpty }
+      .catch { _ in Just(false) }
+      .handleEvents(receiveOutput: { canHash in
+        self.log.message("Remote \(algorithm.command) available: \(canHash)", SSH_LOG_INFO)
+        self.sftpClient.hashCommands[algorithm] = canHash
+      })
+      .setFailureType(to: Error.self)
+      .eraseToAnyPublisher()
+  }
+
+  public func remoteDigests(using algorithm: HashAlgorithm) -> AnyPublisher<[String: String], Error> {
+    let command: String
+    if isDirectory {
+      command = "cd \(path.shellQuoted) && find . -type f -exec \(algorithm.command) -- {} +"
+    } else {
+      command = "\(algorithm.command) -- \(path.shellQuoted)"
+    }
+
+    // About 70 bytes per file.
+    let output = SFTPExecOutput(maxLength: 256 * 1024 * 1024)
+    return exec(command, stdout: output)
+      .tryMap { status in
+        if let status = status, status != 0 {
+          throw FileError.Fail(msg: "Remote \(algorithm.command) exited with status \(status)")
+        }
+        if output.isTruncated {
+          throw FileError.Fail(msg: "Remote \(algorithm.command) output too large")
+        }
+        let digests = FileHasher.parseDigests(output.text)
+        if self.isDirectory {
+          return digests
+        }
+        return digests.first.map { ["": $0.value] } ?? [:]
+      }.eraseToAnyPublisher()
+  }
+}
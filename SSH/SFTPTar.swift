@@ -0,0 +1,136 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import Combine
+import Foundation
+
+import FlowConsoleFiles
+import LibSSH
+
+
+// Trees are moved with tar running on the remote, over an exec channel on the same
+// connection. One stream instead of several round trips per file.
+extension SFTPTranslator: TarTranslator {
+  public func canStreamTar() -> AnyPublisher<Bool, Error> {
+    guard sftpClient.usesExec else {
+      return .just(false)
+    }
+    if let hasTar = sftpClient.hasTar {
+      return .just(hasTar)
+    }
+
+    let output = SFTPExecOutput()
+    return exec("tar --version", stdout: output)
+      .map { _ in output.text.lowercased().contains("tar") }
+      .catch { _ in Just(false) }
+      .handleEvents(receiveOutput: { hasTar in
+        self.log.message("Remote tar available: \(hasTar)", SSH_LOG_INFO)
+        self.sftpClient.hasTar = hasTar
+      })
+      .setFailureType(to: Error.self)
+      .eraseToAnyPublisher()
+  }
+
+  public func sendTar(to w: Writer) -> AnyPublisher<Void, Error> {
+    let parent = (path as NSString).deletingLastPathComponent
+    let name = (path as NSString).lastPathComponent
+    return exec("tar -C \(parent.shellQuoted) -cf - \(name.shellQuoted)", stdout: w)
+      .tryMap { status in
+        if let status = status, status != 0 {
+          throw FileError.Fail(msg: "Remote tar exited with status \(status)")
+        }
+      }.eraseToAnyPublisher()
+  }
+
+  public func receiveTar(from archiver: WriterTo, args: CopyArguments) -> AnyPublisher<Void, Error> {
+    var flags = ""
+    if args.preserve.contains(.permissions) {
+      flags += " -p"
+    }
+    if !args.preserve.contains(.timestamp) {
+      flags += " -m"
+    }
+    // Errors go to stdout, as nothing else does while extracting.
+    let output = SFTPExecOutput()
+    return exec("tar -C \(path.shellQuoted) -xf -\(flags) 2>&1", stdout: output, stdin: archiver)
+      .tryMap { status in
+        if let status = status, status != 0 {
+          throw FileError.Fail(msg: "Remote tar exited with status \(status). \(output.text)")
+        }
+      }.eraseToAnyPublisher()
+  }
+
+  // Exit status of the command, if the server sent it.
+  func exec(_ command: String, stdout: Writer, stdin: WriterTo? = nil) -> AnyPublisher<Int32?, Error> {
+    sftpClient.client.requestExec(command: command)
+      .flatMap { stream -> AnyPublisher<Int32?, Error> in
+        let done = PassthroughSubject<Int32?, Error>()
+        weak var weakStream = stream
+        stream.handleCompletion = {
+          done.send(weakStream?.exitStatus)
+          done.send(completion: .finished)
+        }
+        stream.handleFailure = { done.send(completion: .failure($0)) }
+        stream.connect(stdout: stdout, stdin: stdin)
+        return done
+          .handleEvents(receiveCancel: { stream.cancel() })
+          .eraseToAnyPublisher()
+      }.eraseToAnyPublisher()
+  }
+}
+
+// Collects the output of a command, up to maxLength. Callers that need all of it check isTruncated.
+class SFTPExecOutput: Writer {
+  private let maxLength: Int
+  private(set) var data = Data()
+  private(set) var isTruncated = false
+
+  init(maxLength: Int = 16 * 1024) {
+    self.maxLength = maxLength
+  }
+
+  var text: String {
+    String(decoding: data, as: UTF8.self).trimmingCharacters(in: .whitespacesAndNewlines)
+  }
+
+  func write(_ buf: DispatchData, max length: Int) -> AnyPublisher<Int, Error> {
+    if data.count + buf.count > maxLength {
+      isTruncated = true
+    }
+    if data.count < maxLength {
+      data.append(contentsOf: buf.prefix(maxLength - data.count))
+    }
+    return .just(buf.count)
+  }
+}
+
+extension String {
+  var shellQuoted: String {
+    "'" + replacingOccurrences(of: "'", with: "'\\''") + "'"
+  }
+}
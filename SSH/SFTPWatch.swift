@@ -0,0 +1,98 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import Combine
+import Foundation
+
+import FlowConsoleFiles
+import LibSSH
+
+
+// Changes are watched with inotifywait, or fswatch on macOS servers, running on the remote over an
+// exec channel on the same connection. It sends a line per changed path, so an idle tree costs nothing.
+extension SFTPTranslator: WatchTranslator {
+  static let watchEstablished = "Watches established."
+
+  public func watchChanges() -> AnyPublisher<String, Error> {
+    guard sftpClient.usesExec else {
+      return .fail(error: FileError.Fail(msg: "Remote watch not available"))
+    }
+
+    // inotifywait reports when its watches are in place on stderr, fswatch does not say, so we do.
+    let quotedPath = path.shellQuoted
+    let script = """
+      if command -v inotifywait >/dev/null 2>&1; then
+        exec inotifywait -m -r -e create,delete,modify,move,attrib --format '%w%f' \(quotedPath) 2>&1
+      elif command -v fswatch >/dev/null 2>&1; then
+        echo '\(Self.watchEstablished)'; exec fswatch -r \(quotedPath)
+      else
+        exit 127
+      fi
+      """
+
+    let root = path
+    let changes = PassthroughSubject<String, Error>()
+    let lines = SFTPLineWriter { line in
+      if line == Self.watchEstablished {
+        changes.send(root)
+      } else if line.hasPrefix("/") {
+        // Anything else is inotifywait talking.
+        changes.send((line as NSString).deletingLastPathComponent)
+      }
+    }
+
+    let watch = exec("sh -c \(script.shellQuoted)", stdout: lines)
+      .tryMap { status -> String in
+        if status == 127 {
+          throw FileError.Fail(msg: "No inotifywait or fswatch on remote")
+        }
+        throw FileError.Fail(msg: "Remote watch exited with status \(status.map { String($0) } ?? "unknown")")
+      }
+    return changes.merge(with: watch).eraseToAnyPublisher()
+  }
+}
+
+// Calls back with each complete line written to it, as it comes.
+class SFTPLineWriter: Writer {
+  private var pending = Data()
+  private let onLine: (String) -> Void
+
+  init(onLine: @escaping (String) -> Void) {
+    self.onLine = onLine
+  }
+
+  func write(_ buf: DispatchData, max length: Int) -> AnyPublisher<Int, Error> {
+    pending.append(contentsOf: buf)
+    while let newline = pending.firstIndex(of: UInt8(ascii: "\n")) {
+      let line = pending[pending.startIndex..<newline]
+      pending.removeSubrange(pending.startIndex...newline)
+      onLine(String(decoding: line, as: UTF8.self))
+    }
+    return .just(buf.count)
+  }
+}
@@ -191,7 +191,13 @@ class SOCKSProtocol: NWProtocolFramerImplementation {
   func handleInput(framer: NWProtocolFramer.Instance) -> Int {
     while true {
       if clientVersion == 0 {
-        return handshake(framer: framer)
+        let next = handshake(framer: framer)
+        // Clients may send the request right behind the greeting without waiting
+        // for our answer. Keep parsing, as no new input may wake us up for it.
+        if clientVersion == 0 {
+          return next
+        }
+        continue
       }
       if bound {
         return pipe(framer: framer)
@@ -354,6 +360,68 @@ extension NWParameters {
   }
 }
 
+/**
+ Addresses for domain requests, kept for a short time so a burst of requests to
+ the same host only resolves it once. Safe to use from any thread.
+ */
+final class SOCKSResolverCache {
+  let ttl: TimeInterval
+  let maxEntries: Int
+  private var entries: [String: (address: String, expires: Date)] = [:]
+  private let lock = NSLock()
+
+  init(ttl: TimeInterval = 60, maxEntries: Int = 512) {
+    self.ttl = ttl
+    self.maxEntries = maxEntries
+  }
+
+  /// Address for the host, or the host itself if it cannot be resolved, so the
+  /// remote side still gets a chance to do it.
+  func resolve(_ host: String) -> String {
+    let now = Date()
+    lock.lock()
+    if let entry = entries[host], entry.expires > now {
+      lock.unlock()
+      return entry.address
+    }
+    lock.unlock()
+
+    guard let address = Self.lookup(host) else {
+      return host
+    }
+
+    lock.lock()
+    if entries.count >= maxEntries {
+      entries = entries.filter { $0.value.expires > now }
+    }
+    if entries.count < maxEntries {
+      entries[host] = (address, now.addingTimeInterval(ttl))
+    }
+    lock.unlock()
+    return address
+  }
+
+  static func lookup(_ host: String) -> String? {
+    var hints = addrinfo()
+    hints.ai_family = AF_UNSPEC
+    hints.ai_socktype = SOCK_STREAM
+
+    var result: UnsafeMutablePointer<addrinfo>? = nil
+    guard getaddrinfo(host, nil, &hints, &result) == 0, let info = result else {
+      return nil
+    }
+    defer { freeaddrinfo(result) }
+
+    var name = [CChar](repeating: 0, count: Int(NI_MAXHOST))
+    guard getnameinfo(info.pointee.ai_addr, info.pointee.ai_addrlen,
+                      &name, socklen_t(name.count),
+                      nil, 0, NI_NUMERICHOST) == 0 else {
+      return nil
+    }
+    return String(cString: name)
+  }
+}
+
 public class SOCKSServer {
   let client: SSHClient
   var log: SSHLogger { get { client.log }}
@@ -362,6 +430,19 @@ public class SOCKSServer {
   let port: NWEndpoint.Port
   var connections: [NWConnection] = []
 
+  /// Channel opens in flight at the same time. Bursts, like a browser loading a page,
+  /// wait here instead of getting channels refused by the server.
+  public var maxConcurrentOpens = 8
+  /// Resolve domain requests on this side and forward to the address instead.
+  /// Names then go through the local DNS, but are cached between requests.
+  public var resolvesLocally = false
+  let resolver = SOCKSResolverCache()
+  private let resolverQueue = DispatchQueue(label: "SOCKS.resolver", attributes: .concurrent)
+  private var opening = 0
+  private var pendingOpens: [(@escaping () -> Void) -> Void] = []
+  private var stats: [String: SSHTunnelStats] = [:]
+  private let maxTrackedDestinations = 256
+
   public init(_ port: UInt16 = 1080, proxy client: SSHClient) throws {
     //listener.newConnectionHandler = { [weak self] in self?.handleConnectionUpdates($0) }
     //listener.stateUpdateHandler = { [weak self] in self?.handleListenerUpdates($0) }
@@ -374,6 +455,11 @@ public class SOCKSServer {
     try startListening()
   }
 
+  /// Throughput and setup latency per "host:port" requested by the clients.
+  public var destinationStats: [String: SSHTunnelStats.Snapshot] {
+    queue.sync { stats.mapValues { $0.snapshot } }
+  }
+
   func startListening() throws {
     self.listener = try NWListener(using: .SOCKS, on: self.port)
 
@@ -406,68 +492,116 @@ public class SOCKSServer {
   
   func receiveNextMessage(_ conn: NWConnection) {
     conn.receiveMessage { (content, context, isComplete, error) in
-      if let message = context?.protocolMetadata(definition: SOCKSProtocol.definition) as? NWProtocolFramer.Message,
-         let content = content,
-         let msg = SOCKSMessage(content, type: message.socksAddressType) {
-        // We could offer a delegate call here instead, with the promise of reusability at one point.
-        // Not important for us right now.
-
-        var cancellable: AnyCancellable?
-        var stream: Stream?
-
-        print("Trying to connect to \(msg.address) on \(msg.port)")
-
-        cancellable = self.client.requestForward(to: msg.address, port: Int32(msg.port),
-                                                 from: "localhost", localPort: Int32(self.port.rawValue))
-          .map { s -> SSH.Stream in
-            // If the connection succeeds, reply
-            let reply = NWProtocolFramer.Message(reply: .succeeded,
-                                                 addressType: .ipv4)
-            let context = NWConnection.ContentContext(identifier: "Reply", metadata: [reply])
-            let localhost = IPv4Address("0.0.0.0")
-            let data = localhost!.rawValue + Data([0x00, 0x00])
-            conn.send(content: data, contentContext: context,
-                      isComplete: true, completion: .idempotent)
-            
-            return s
-          }
-          .sink(receiveCompletion: { c in
-            if case let .failure(error) = c {
-              print("Could not process Forward Request to \(msg.address) \(error)")
-              conn.cancel()
-              cancellable = nil
-              stream = nil
-            }
-          }, receiveValue: { s in
-            print("SOCKS forward received - \(msg.address)")
-            // TODO We could make the connect a sink.
-            // Then the flow is clear and Stream does not need to be persisted.
-            // This would be a big change, but we could test if while maintaining the previous interface.
-            stream = s
-            s.connect(stdout: conn, stdin: conn)
-            s.handleCompletion = {
-              print("SOCKS forward completed - \(msg.address)")
-              stream = nil
-              self.closeConnection(conn)
-              cancellable = nil
-            }
-            s.handleFailure = { error in
-              stream = nil
-              self.closeConnection(conn)
-              conn.cancel()
-              cancellable = nil
-            }
-          })
+      guard let message = context?.protocolMetadata(definition: SOCKSProtocol.definition) as? NWProtocolFramer.Message,
+            let content = content,
+            let msg = SOCKSMessage(content, type: message.socksAddressType) else {
+        return
+      }
+      // We could offer a delegate call here instead, with the promise of reusability at one point.
+      // Not important for us right now.
+      self.log.message("SOCKS request to \(msg.address) on \(msg.port)", SSH_LOG_DEBUG)
+
+      // Reply before the channel is open, so the client sends its first bytes while the
+      // open is in flight. They wait on the socket until the stream is connected.
+      // If the open fails, the connection is closed instead of answered with an error.
+      self.sendReply(.succeeded, on: conn)
+
+      let stats = self.stats(for: "\(msg.address):\(msg.port)")
+      let resolve = self.resolvesLocally && message.socksAddressType == .domain
+      self.enqueueOpen { done in
+        guard resolve else {
+          self.forward(conn, to: msg.address, port: msg.port, stats: stats, done: done)
+          return
+        }
+        self.resolverQueue.async {
+          let address = self.resolver.resolve(msg.address)
+          self.forward(conn, to: address, port: msg.port, stats: stats, done: done)
+        }
+      }
+    }
+  }
+
+  func sendReply(_ reply: SOCKSReplyType, on conn: NWConnection) {
+    let message = NWProtocolFramer.Message(reply: reply, addressType: .ipv4)
+    let context = NWConnection.ContentContext(identifier: "Reply", metadata: [message])
+    let localhost = IPv4Address("0.0.0.0")
+    let data = localhost!.rawValue + Data([0x00, 0x00])
+    conn.send(content: data, contentContext: context,
+              isComplete: true, completion: .idempotent)
+  }
+
+  func forward(_ conn: NWConnection, to address: String, port: UInt16,
+               stats: SSHTunnelStats, done: @escaping () -> Void) {
+    var cancellable: AnyCancellable?
+    var stream: Stream?
+    var released = false
+    let release = {
+      if !released {
+        released = true
+        self.queue.async(execute: done)
+      }
+    }
+    let requestedAt = Date()
+
+    cancellable = self.client.requestForward(to: address, port: Int32(port),
+                                             from: "localhost", localPort: Int32(self.port.rawValue))
+      .sink(receiveCompletion: { c in
+        release()
+        if case let .failure(error) = c {
+          self.log.message("Could not process Forward Request to \(address) \(error)", SSH_LOG_WARN)
+          self.queue.async { self.closeConnection(conn) }
+          cancellable = nil
+          stream = nil
+        }
+      }, receiveValue: { s in
+        release()
+        stats.connectionOpened(setupTime: Date().timeIntervalSince(requestedAt))
+        stream = s
+        s.connect(to: conn, stats: stats)
+        s.handleCompletion = {
+          self.log.message("SOCKS forward completed - \(address)", SSH_LOG_DEBUG)
+          stream = nil
+          self.queue.async { self.closeConnection(conn) }
+          cancellable = nil
+        }
+        s.handleFailure = { error in
+          stream = nil
+          self.queue.async { self.closeConnection(conn) }
+          cancellable = nil
+        }
+      })
+  }
+
+  // Runs the open now if there is room, or when one in flight is done. Called on the queue.
+  func enqueueOpen(_ open: @escaping (@escaping () -> Void) -> Void) {
+    guard opening < maxConcurrentOpens else {
+      pendingOpens.append(open)
+      return
+    }
+    opening += 1
+    open { [weak self] in
+      guard let self = self else { return }
+      self.opening -= 1
+      if !self.pendingOpens.isEmpty {
+        self.enqueueOpen(self.pendingOpens.removeFirst())
       }
     }
   }
+
+  func stats(for destination: String) -> SSHTunnelStats {
+    if let s = stats[destination] {
+      return s
+    }
+    if stats.count >= maxTrackedDestinations {
+      stats = stats.filter { $0.value.snapshot.active > 0 }
+    }
+    let s = SSHTunnelStats()
+    stats[destination] = s
+    return s
+  }
   
   func closeConnection(_ conn: NWConnection) {
     conn.cancel()
-    for (idx, c) in connections.enumerated() {
-      if c === conn {
-        connections.remove(at: idx)
-      }
-    }
+    connections.removeAll { $0 === conn }
   }
 }
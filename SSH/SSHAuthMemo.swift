@@ -0,0 +1,159 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+import CryptoKit
+import Foundation
+
+
+/**
+ Remembers which authenticator, and which agent key, last logged in to a host, so
+ the next connection tries it first instead of walking every method and key in
+ order. Entries are keyed by user, host, port and the host key fingerprint, so a
+ different server behind the same name starts from scratch.
+ Stores are shared per path through `SSHAuthMemo.store(at:)`. A nil path keeps
+ the memo in memory only.
+ */
+public final class SSHAuthMemo {
+  public struct Hint: Codable, Equatable {
+    /// `SSHAuthMemo.identity(of:)` of the authenticator that succeeded.
+    public let method: String
+    /// SHA256 of the public key blob the agent signed with, if it was the agent.
+    public let agentKey: String?
+    public let updated: Date
+  }
+
+  private static var stores: [String: SSHAuthMemo] = [:]
+  private static let memory = SSHAuthMemo(url: nil)
+  private static let storesLock = NSLock()
+
+  public static func store(at path: String?) -> SSHAuthMemo {
+    guard let path = path else {
+      return memory
+    }
+    storesLock.lock()
+    defer { storesLock.unlock() }
+    if let store = stores[path] {
+      return store
+    }
+    let store = SSHAuthMemo(url: URL(fileURLWithPath: path))
+    stores[path] = store
+    return store
+  }
+
+  // Hosts not used in a while are dropped so the file does not grow forever.
+  static let maxEntries = 256
+
+  let url: URL?
+  private let lock = NSLock()
+  private var hints: [String: Hint]? = nil
+
+  init(url: URL?) {
+    self.url = url
+  }
+
+  static func key(user: String, host: String, port: String, fingerprint: String) -> String {
+    "\(user)@\(host):\(port) \(fingerprint)"
+  }
+
+  static func identity(of method: Authenticator) -> String {
+    "\(type(of: method)) \(method.displayName)"
+  }
+
+  static func hash(keyBlob: Data) -> String {
+    SHA256.hash(data: keyBlob).map { String(format: "%02x", $0) }.joined()
+  }
+
+  func hint(for key: String) -> Hint? {
+    lock.lock()
+    defer { lock.unlock() }
+    return load()[key]
+  }
+
+  func record(_ hint: Hint, for key: String) {
+    lock.lock()
+    defer { lock.unlock() }
+    var hints = load()
+    guard hints[key]?.method != hint.method || hints[key]?.agentKey != hint.agentKey else {
+      return
+    }
+    hints[key] = hint
+    if hints.count > Self.maxEntries {
+      let oldest = hints.sorted { $0.value.updated < $1.value.updated }.prefix(hints.count - Self.maxEntries)
+      oldest.forEach { hints.removeValue(forKey: $0.key) }
+    }
+    self.hints = hints
+    save()
+  }
+
+  func forget(_ key: String) {
+    lock.lock()
+    defer { lock.unlock() }
+    var hints = load()
+    guard hints.removeValue(forKey: key) != nil else {
+      return
+    }
+    self.hints = hints
+    save()
+  }
+
+  private func load() -> [String: Hint] {
+    if let hints = hints {
+      return hints
+    }
+    var loaded: [String: Hint] = [:]
+    if let url = url,
+       let data = try? Data(contentsOf: url),
+       let decoded = try? PropertyListDecoder().decode([String: Hint].self, from: data) {
+      loaded = decoded
+    }
+    hints = loaded
+    return loaded
+  }
+
+  private func save() {
+    guard let url = url, let hints = hints,
+          let data = try? PropertyListEncoder().encode(hints) else {
+      return
+    }
+    try? data.write(to: url, options: .atomic)
+  }
+}
+
+/// What the last authentication cost, to tell how much the memo saves.
+public struct SSHAuthStats {
+  /// Authenticators tried, in order.
+  public internal(set) var methods: [String] = []
+  /// Userauth requests sent to the server, each one a round trip.
+  public internal(set) var requests: Int = 0
+  public internal(set) var elapsed: TimeInterval = 0
+  /// The memo hint was tried first.
+  public internal(set) var usedHint: Bool = false
+  /// The memo hint was the one that succeeded.
+  public internal(set) var hintSucceeded: Bool = false
+}
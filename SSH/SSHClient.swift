@@ -59,10 +59,16 @@ public class SSHClient {
   let proxyCb: ExecProxyCommandCallback?
   
   let rloop: RunLoop
+  /// Shared loop driving this client, if it was created in one. Otherwise the client owns its RunLoop.
+  let eventLoop: SSHEventLoop?
   var callbacks: ssh_callbacks_struct
   var reversePorts: [Int32: PassthroughSubject<Stream, Error>] = [:]
   
   var keepAliveTimer: Timer?
+  var keepAliveToken: SSHTimerWheel.Token?
+  
+  /// Orders the data written by all the channels on this session.
+  public private(set) lazy var writeScheduler = SSHWriteScheduler(perform: { [unowned self] in self.perform($0) })
   
   public var isConnected: Bool {
     ssh_is_connected(session) == 1
@@ -83,6 +89,17 @@ public class SSHClient {
   // When a connection is local, we consider it trusted and we use this flag to indicate that
   // to the agent. On an untrusted connection, the Agent may decide not to use specific keys.
   var trustAgentConnection: Bool = true
+
+  // SHA256 fingerprint of the host key, set once the host has been verified.
+  var serverFingerprint: String? = nil
+  // Agent key to answer first in the identities list, and the keys the agent
+  // offered and signed with while authenticating.
+  var agentKeyHint: String? = nil
+  var agentKeysOffered: [String] = []
+  var agentSignedKey: String? = nil
+
+  /// Cost of the last authentication.
+  public private(set) var authStats = SSHAuthStats()
   
   public struct PTY {
     let rows: Int32
@@ -127,6 +144,8 @@ public class SSHClient {
     self.proxyCb = proxyCb
     
     self.rloop = RunLoop.current
+    self.eventLoop = SSHEventLoop.current
+    self.eventLoop?.attach()
     
     self.callbacks = ssh_callbacks_struct()
     
@@ -233,20 +252,58 @@ public class SSHClient {
   
   func startKeepAliveTimer() {
     // https://github.com/golang/go/issues/4552
+    let interval = TimeInterval(options.keepAliveInterval ?? 15)
+    if let loop = eventLoop {
+      // Keepalives for all clients on a shared loop are served by its timer wheel.
+      if let token = keepAliveToken {
+        loop.wheel.cancel(token)
+      }
+      scheduleKeepAlive(on: loop, every: interval)
+      return
+    }
+
     keepAliveTimer?.invalidate()
-    keepAliveTimer = Timer(timeInterval: 15, target: self, selector: #selector(onServerKeepAlive), userInfo: nil, repeats: true)
+    keepAliveTimer = Timer(timeInterval: interval, target: self, selector: #selector(onServerKeepAlive), userInfo: nil, repeats: true)
     rloop.add(keepAliveTimer!, forMode: .default)
   }
   
+  private func scheduleKeepAlive(on loop: SSHEventLoop, every interval: TimeInterval) {
+    keepAliveToken = loop.wheel.schedule(after: interval) { [weak self] in
+      guard let self = self, self.sendKeepAlive() else {
+        return
+      }
+      self.scheduleKeepAlive(on: loop, every: interval)
+    }
+  }
+  
   @objc private func onServerKeepAlive() {
+    if !sendKeepAlive() {
+      keepAliveTimer?.invalidate()
+    }
+  }
+
+  private func sendKeepAlive() -> Bool {
     guard isConnected else {
-      return
+      return false
     }
     
     let rc = ssh_client_send_keepalive(session)
     if rc != SSH_OK {
-      keepAliveTimer?.invalidate()
       print("ERROR Keep alive")
+      return false
+    }
+    return true
+  }
+  
+  /**
+   Schedule work for this client on its RunLoop. On a shared SSHEventLoop, work is interleaved
+   fairly with the rest of the connections on the loop.
+   */
+  func perform(_ block: @escaping () -> Void) {
+    if let loop = eventLoop {
+      loop.perform(for: self, block)
+    } else {
+      rloop.perform(block)
     }
   }
   
@@ -346,6 +403,20 @@ public class SSHClient {
       // once the command is dumped.
       .eraseToAnyPublisher()
   }
+
+  /**
+   Dial on a shared SSHEventLoop instead of the current thread. The client and all its
+   channels are then driven by the loop, which it shares with other connections.
+   */
+  public static func dial(_ host: String, with opts: SSHClientConfig,
+                          withProxy proxyCb: ExecProxyCommandCallback? = nil,
+                          on loop: SSHEventLoop) -> AnyPublisher<SSHClient, Error> {
+    Just(())
+      .setFailureType(to: Error.self)
+      .receive(on: loop.runLoop)
+      .flatMap { SSHClient.dial(host, with: opts, withProxy: proxyCb) }
+      .eraseToAnyPublisher()
+  }
   
   /**
    Get the current IP address of the connected session.
@@ -377,6 +448,26 @@ public class SSHClient {
     return String(cString: hostBuffer, encoding: .utf8)
   }
   
+  /// Local address of the session socket, or nil if it is not an IP socket (ie ProxyCommand).
+  public func localAddressIP() -> String? {
+    let socketFd = ssh_get_fd(session)
+    var addr = sockaddr_storage()
+    var addrLen = socklen_t(MemoryLayout<sockaddr_storage>.size)
+    var hostBuffer = [CChar](repeating: 0, count: Int(NI_MAXHOST))
+
+    let rc: Int32 = withUnsafeMutablePointer(to: &addr) {
+      $0.withMemoryRebound(to: sockaddr.self, capacity: 1) {
+        guard getsockname(socketFd, $0, &addrLen) == 0,
+              $0.pointee.sa_family == AF_INET || $0.pointee.sa_family == AF_INET6 else {
+          return -1
+        }
+        return getnameinfo($0, addrLen, &hostBuffer, socklen_t(hostBuffer.count), nil, 0, NI_NUMERICHOST)
+      }
+    }
+
+    return rc == 0 ? String(cString: hostBuffer, encoding: .utf8) : nil
+  }
+  
   /**
    Check if the servers public key for the connected session is known. This checks if we already know the public key of the server we want to connect to. This allows to detect if there is a MITM attach going on of if there have been changes on the server we don't know about.
    */
@@ -390,6 +481,7 @@ public class SSHClient {
     if rc < 0 {
       return .fail(error: SSHError(title: "Could not get server publickey"))
     }
+    defer { ssh_key_free(serverPublicKey) }
     
     let state = ssh_get_publickey_hash(serverPublicKey, SSH_PUBLICKEY_HASH_SHA256, &hash, &hlen)
     if state < 0 {
@@ -399,95 +491,93 @@ public class SSHClient {
     let serverFingerprint = String(cString: ssh_get_fingerprint_hash(SSH_PUBLICKEY_HASH_SHA256, hash, hlen))
     //let hexString = String(cString: ssh_get_hexa(hash, hlen))
     ssh_clean_pubkey_hash(&hash)
-    
-    let rc3 = ssh_session_is_known_server(session)
-    switch rc3 {
-    case SSH_KNOWN_HOSTS_OK:
-      return .just(self)
-      
-    case SSH_KNOWN_HOSTS_CHANGED:
-      return self.options.requestVerifyHostCallback!(.changed(serverFingerprint: serverFingerprint)).flatMap { answer -> AnyPublisher<SSHClient, Error> in
-        if answer == .affirmative {
-          let rc = ssh_session_update_known_hosts(self.session)
-          if rc != SSH_OK {
-            return .fail(error: SSHError(title: "Could not update known_hosts file."))
-          }
-          return .just(self)
-        }
-        
-        return .fail(error: SSHError(title: "Could not verify host authenticity."))
-      }.eraseToAnyPublisher()
-      
-    case SSH_KNOWN_HOSTS_UNKNOWN:
-      return self.options.requestVerifyHostCallback!(.unknown(serverFingerprint: serverFingerprint)).flatMap { answer -> AnyPublisher<SSHClient, Error> in
-        if answer == .affirmative {
-          let rc = ssh_session_update_known_hosts(self.session)
-          
-          if rc < 0 {
-            return .fail(error: SSHError(title: "Error updating known_hosts file."))
-          }
-          
-          return .just(self)
-        }
-        
+    self.serverFingerprint = serverFingerprint
+
+    // Verify against the indexed store when we know where the file is, and fall
+    // back to libssh, which scans the file, otherwise.
+    var serverKey: (type: String, key: String)? = nil
+    var b64: UnsafeMutablePointer<CChar>? = nil
+    if ssh_pki_export_pubkey_base64(serverPublicKey, &b64) == SSH_OK, let b64 = b64 {
+      serverKey = (String(cString: ssh_key_type_to_char(ssh_key_type(serverPublicKey))), String(cString: b64))
+      ssh_string_free_char(b64)
+    }
+    let port = Int(options.port) ?? 22
+    let knownHosts = options.sshDirectory.map {
+      SSHKnownHosts.store(at: ($0 as NSString).appendingPathComponent("known_hosts"))
+    }
+
+    let verification: SSHKnownHosts.Verification
+    if let knownHosts = knownHosts, let serverKey = serverKey {
+      verification = knownHosts.verify(host: host, port: port, keyType: serverKey.type, key: serverKey.key)
+    } else {
+      switch ssh_session_is_known_server(session) {
+      case SSH_KNOWN_HOSTS_OK:        verification = .ok
+      case SSH_KNOWN_HOSTS_CHANGED:   verification = .changed
+      /// The server gave use a key of a type while we had another type recorded. It is a possible attack.
+      case SSH_KNOWN_HOSTS_OTHER:     verification = .other
+      case SSH_KNOWN_HOSTS_UNKNOWN:   verification = .unknown
+      /// The known host file does not exist. The host is thus unknown. File will be created if host key is accepted
+      case SSH_KNOWN_HOSTS_NOT_FOUND: verification = .notFound
+      /// There had been an eror checking the host.
+      case SSH_KNOWN_HOSTS_ERROR:
         return .fail(error: SSHError(title: "Could not verify host authenticity."))
-      }.eraseToAnyPublisher()
-      
-      
-    /// The server gave use a key of a type while we had another type recorded. It is a possible attack.
-    case SSH_KNOWN_HOSTS_OTHER:
-      return self.options.requestVerifyHostCallback!(.changed(serverFingerprint: serverFingerprint)).flatMap { answer -> AnyPublisher<SSHClient, Error> in
-        if answer == .affirmative {
-          let rc = ssh_session_update_known_hosts(self.session)
-          if rc != SSH_OK {
-            return .fail(error: SSHError(title: "Could not update known_hosts file."))
-          }
-          return .just(self)
-        }
-        
+      default:
+        return .fail(error: SSHError(title: "Unknown code received during host key exchange. Possible library error."))
+      }
+    }
+
+    let request: VerifyHost
+    switch verification {
+    case .ok:
+      return .just(self)
+    case .changed, .other:
+      request = .changed(serverFingerprint: serverFingerprint)
+    case .unknown:
+      request = .unknown(serverFingerprint: serverFingerprint)
+    case .notFound:
+      request = .notFound(serverFingerprint: serverFingerprint)
+    }
+
+    return self.options.requestVerifyHostCallback!(request).flatMap { answer -> AnyPublisher<SSHClient, Error> in
+      guard answer == .affirmative else {
         return .fail(error: SSHError(title: "Could not verify host authenticity."))
-      }.eraseToAnyPublisher()
-    //  return .fail(error: SSHError(title: "The server gave use a key of a type while we had an other type recorded. It is a possible attack."))
-    /// There had been an eror checking the host.
-    case SSH_KNOWN_HOSTS_ERROR:
-      return .fail(error: SSHError(title: "Could not verify host authenticity."))
-    /// The known host file does not exist. The host is thus unknown. File will be created if host key is accepted
-    case SSH_KNOWN_HOSTS_NOT_FOUND:
-      return self.options.requestVerifyHostCallback!(.notFound(serverFingerprint: serverFingerprint)).flatMap { answer -> AnyPublisher<SSHClient, Error> in
-        if answer == .affirmative {
-          let rc = ssh_session_update_known_hosts(self.session)
-          
-          if rc != SSH_OK {
-            return .fail(error: SSHError(title: "Error updating known_hosts file."))
-          }
-          
-          return .just(self)
+      }
+
+      if let knownHosts = knownHosts, let serverKey = serverKey {
+        do {
+          try knownHosts.update(host: self.host, port: port, keyType: serverKey.type, key: serverKey.key)
+        } catch {
+          return .fail(error: error)
         }
-        
-        return .fail(error: SSHError(title: "Could not verify host authenticity."))
-      }.eraseToAnyPublisher()
-      
-    default:
-      return .fail(error: SSHError(title: "Unknown code received during host key exchange. Possible library error."))
-    }
+      } else if ssh_session_update_known_hosts(self.session) != SSH_OK {
+        return .fail(error: SSHError(title: "Could not update known_hosts file."))
+      }
+      return .just(self)
+    }.eraseToAnyPublisher()
   }
   
   public func connect() -> AnyPublisher<SSHClient, Error> {
     var timerFired = false
     var timer: Timer?
+    var deadline: Date?
     return connection()
       .map { conn -> ssh_session in
         // Set timeout if it is configured.
         // We are already in the runloop, so rw is thread-safe.
         let timeout = self.options.connectionTimeout
-        timer = Timer.scheduledTimer(
-          withTimeInterval: Double(timeout),
-          repeats: false) {_ in timerFired = true }
+        if self.eventLoop != nil {
+          // Shared loops do not tick their wheel while the connection blocks.
+          deadline = Date(timeIntervalSinceNow: Double(timeout))
+        } else {
+          timer = Timer.scheduledTimer(
+            withTimeInterval: Double(timeout),
+            repeats: false) {_ in timerFired = true }
+        }
         return conn
       }
       .eraseToAnyPublisher()
       .tryOperation { session in
-        if timerFired {
+        if timerFired || (deadline.map { $0 < Date() } ?? false) {
           throw SSHError(title: "Connection to \(self.host) timed out.")
         }
         self.log.message("Starting connection to \(self.host)", SSH_LOG_INFO)
@@ -545,22 +635,93 @@ public class SSHClient {
   }
   
   func auth() -> AnyPublisher<SSHClient, Error> {
+    // The method that worked last time for this same user and host key goes first,
+    // and the rest stay in order as the fallback.
+    let memo = SSHAuthMemo.store(at: options.sshDirectory.map {
+      ($0 as NSString).appendingPathComponent("auth_memo.plist")
+    })
+    let memoKey = serverFingerprint.map {
+      SSHAuthMemo.key(user: options.user, host: host, port: options.port, fingerprint: $0)
+    }
+    let hint = memoKey.flatMap { memo.hint(for: $0) }
+    var partial = false
+    let start = Date()
+    authStats = SSHAuthStats()
+    agentKeyHint = hint?.agentKey
+
+    func prioritized(_ methods: [Authenticator]) -> [Authenticator] {
+      guard !partial,
+            let hint = hint,
+            let idx = methods.firstIndex(where: { SSHAuthMemo.identity(of: $0) == hint.method }) else {
+        return methods
+      }
+      authStats.usedHint = true
+      var methods = methods
+      methods.insert(methods.remove(at: idx), at: 0)
+      return methods
+    }
+
+    func account(_ method: Authenticator) {
+      authStats.methods.append(method.displayName)
+      if method is AuthAgent {
+        // Every key offered is a probe, plus the signed request for the accepted one.
+        if let signed = agentSignedKey, let idx = agentKeysOffered.firstIndex(of: signed) {
+          authStats.requests += idx + 2
+        } else {
+          authStats.requests += max(agentKeysOffered.count, 1)
+        }
+      } else {
+        authStats.requests += 1
+      }
+    }
+
+    func finish(_ method: Authenticator?) {
+      authStats.elapsed = Date().timeIntervalSince(start)
+      agentKeyHint = nil
+      if let memoKey = memoKey {
+        if let method = method {
+          // Multi-step logins depend on the whole sequence, so only single methods are memoized.
+          if !partial, method.name() != "none" {
+            let identity = SSHAuthMemo.identity(of: method)
+            let agentKey = method is AuthAgent ? agentSignedKey : nil
+            authStats.hintSucceeded = hint?.method == identity && hint?.agentKey == agentKey
+            memo.record(.init(method: identity, agentKey: agentKey, updated: Date()), for: memoKey)
+          }
+        } else if hint != nil {
+          memo.forget(memoKey)
+        }
+      }
+      log.message("Authentication \(method == nil ? "failed" : "succeeded") after \(authStats.methods.count) methods, \(authStats.requests) requests, \(String(format: "%.3f", authStats.elapsed))s\(authStats.usedHint ? " (remembered method first)" : "")", SSH_LOG_INFO)
+    }
+
     // Return the Client if any method worked, otherwise return an error
     func tryAuth(_ methods: [Authenticator],  tried: [Authenticator]) -> AnyPublisher<SSHClient, Error> {
       if methods.count == 0 {
+        finish(nil)
         return .fail(error: SSHError.authError(msg: "Could not authenticate, no valid methods to try."))
       }
       
       let method = methods.first!
       log.message("Trying \(method.displayName)...", SSH_LOG_INFO)
+      agentKeysOffered = []
+      agentSignedKey = nil
       
       return method
         .auth(user: self.options.user, host: self.host, on: connection())
+        .handleEvents(receiveOutput: { _ in account(method) },
+                      receiveCompletion: {
+                        if case .failure = $0 {
+                          account(method)
+                          finish(nil)
+                        }
+                      })
         .flatMap { result -> AnyPublisher<SSHClient, Error> in
           switch result {
           case .success:
+            finish(method)
             return .just(self)
           case .partial:
+            partial = true
             return tryAuth(self.validAuthMethods(), tried: tried)
           default:
             var tried = tried
@@ -568,11 +729,12 @@ public class SSHClient {
             
             if methods[0].name() == "none" {
               // Once we have tried, go for the rest.
-              return tryAuth(self.validAuthMethods(), tried: tried)
+              return tryAuth(prioritized(self.validAuthMethods()), tried: tried)
             }
             
             if methods.count == 1 {
               tried.append(methods.removeFirst())
+              finish(nil)
               
               // Return a failure and close the connection that's still open
               return .fail(error: SSHError.authFailed(methods: tried))
@@ -630,7 +792,8 @@ public class SSHClient {
         if rc != SSH_OK {
           throw SSHError(rc, forSession: self.session)
         }
-        return Stream(channel, on: self)
+        // Keystrokes on a PTY go ahead of any bulk data on the connection.
+        return Stream(channel, on: self, priority: pty != nil ? .interactive : .bulk(weight: 1))
       }
       .eraseToAnyPublisher()
   }
@@ -720,7 +883,7 @@ public class SSHClient {
         if rc != SSH_OK {
           throw SSHError(rc, forSession: self.session)
         }
-        return Stream(channel, on: self)
+        return Stream(channel, on: self, priority: pty != nil ? .interactive : .bulk(weight: 1))
       }
   }
   
@@ -855,7 +1018,7 @@ public class SSHClient {
   }
 
   func closeChannel(_ channel: ssh_channel) {
-    self.rloop.perform {
+    self.perform {
       // Keep self so the Session is always deinited after the channels are closed.
       let _ = self
       self.log.message("Closing channel", SSH_LOG_INFO)
@@ -864,7 +1027,7 @@ public class SSHClient {
   }
   
   func closeSFTP(_ sftp: sftp_session) {
-    self.rloop.perform {
+    self.perform {
       let _ = self
       self.log.message("Closing sftp channel", SSH_LOG_INFO)
       sftp_free(sftp)
@@ -889,7 +1052,12 @@ public class SSHClient {
     // automatically wake. But it needs the extra nagging.
     // ssh_disconnect(session)
     ssh_free(session)
-    CFRunLoopStop(self.rloop.getCFRunLoop())
+    if let loop = eventLoop {
+      // The loop is shared with other clients, so it must keep running.
+      loop.detach()
+    } else {
+      CFRunLoopStop(self.rloop.getCFRunLoop())
+    }
   }
 }
 
@@ -0,0 +1,268 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import Foundation
+
+
+/**
+ An SSHEventLoop drives many SSHClient sessions from a single thread.
+ LibSSH registers the session sockets as sources on the RunLoop where the client
+ was created, so one RunLoop already waits on the readiness of all of them at once.
+ Sharing a few loops instead of dedicating a thread to each connection keeps the
+ thread count fixed, no matter how many forwards, shells or File Provider sessions are open.
+ Work and timers only run in the default mode. A client blocking on a call runs the loop in
+ libSSHBlockMode, and must not have another session's work run in the middle of it.
+ */
+public final class SSHEventLoop {
+  private static let threadKey = "SSHEventLoop"
+
+  public let name: String
+  public private(set) var runLoop: RunLoop!
+  private var thread: Thread!
+
+  /// Keepalives and timeouts for all the clients on this loop. Only to be used from the loop thread.
+  let wheel: SSHTimerWheel
+  private var wheelTimer: Timer?
+
+  private let lock = NSLock()
+  private var _numClients = 0
+  // Work pending per owner, served round-robin so a busy connection cannot starve the rest.
+  private var pending: [ObjectIdentifier: [() -> Void]] = [:]
+  private var pendingOrder: [ObjectIdentifier] = []
+  private var isDraining = false
+
+  /// The loop driving the current thread, if any.
+  public static var current: SSHEventLoop? {
+    Thread.current.threadDictionary[threadKey] as? SSHEventLoop
+  }
+
+  public var numClients: Int {
+    lock.lock(); defer { lock.unlock() }
+    return _numClients
+  }
+
+  init(name: String, tick: TimeInterval = 1) {
+    self.name = name
+    self.wheel = SSHTimerWheel(resolution: tick)
+
+    let ready = DispatchSemaphore(value: 0)
+    self.thread = Thread { [unowned self] in
+      Thread.current.threadDictionary[SSHEventLoop.threadKey] = self
+      self.runLoop = RunLoop.current
+
+      // The wheel timer also keeps the RunLoop alive while there are no sockets attached.
+      let timer = Timer(timeInterval: tick, repeats: true) { [unowned self] _ in
+        self.wheel.tick()
+      }
+      self.runLoop.add(timer, forMode: .default)
+      self.wheelTimer = timer
+      ready.signal()
+
+      // Clients may stop the RunLoop (ie, when they are disposed), but the loop outlives them.
+      while true {
+        CFRunLoopRunInMode(.defaultMode, TimeInterval(INT_MAX), false)
+      }
+    }
+    self.thread.name = name
+    self.thread.start()
+    ready.wait()
+  }
+
+  func attach() {
+    lock.lock(); defer { lock.unlock() }
+    _numClients += 1
+  }
+
+  func detach() {
+    lock.lock(); defer { lock.unlock() }
+    _numClients -= 1
+  }
+
+  /**
+   Schedule a block on the loop on behalf of an owner (usually an SSHClient).
+   Each drain pass runs at most one block per owner, so work from different
+   connections is interleaved fairly. Safe to call from any thread.
+   */
+  func perform(for owner: AnyObject, _ block: @escaping () -> Void) {
+    let id = ObjectIdentifier(owner)
+    lock.lock()
+    if pending[id] == nil {
+      pending[id] = []
+      pendingOrder.append(id)
+    }
+    pending[id]!.append(block)
+    let shouldSchedule = !isDraining
+    isDraining = true
+    lock.unlock()
+
+    if shouldSchedule {
+      scheduleDrain()
+    }
+  }
+
+  private func scheduleDrain() {
+    runLoop.perform(inModes: [.default]) { [unowned self] in self.drain() }
+    CFRunLoopWakeUp(runLoop.getCFRunLoop())
+  }
+
+  private func drain() {
+    lock.lock()
+    let order = pendingOrder
+    var batch: [() -> Void] = []
+    batch.reserveCapacity(order.count)
+    for id in order {
+      guard var blocks = pending[id], !blocks.isEmpty else { continue }
+      batch.append(blocks.removeFirst())
+      pending[id] = blocks.isEmpty ? nil : blocks
+    }
+    pendingOrder = order.filter { pending[$0] != nil }
+    let hasMore = !pendingOrder.isEmpty
+    isDraining = hasMore
+    lock.unlock()
+
+    batch.forEach { $0() }
+
+    if hasMore {
+      // Go back to the RunLoop between passes, so sockets are also serviced.
+      scheduleDrain()
+    }
+  }
+}
+
+/**
+ A fixed set of SSHEventLoops shared by all connections in the process.
+ Loops are started lazily, and new clients go to the least loaded one.
+ */
+public final class SSHEventLoopGroup {
+  public static let shared = SSHEventLoopGroup(
+    numberOfLoops: min(max(ProcessInfo.processInfo.activeProcessorCount / 2, 2), 4)
+  )
+
+  public let numberOfLoops: Int
+  private var loops: [SSHEventLoop] = []
+  private var nextIdx = 0
+  private let lock = NSLock()
+
+  public init(numberOfLoops: Int) {
+    self.numberOfLoops = max(numberOfLoops, 1)
+  }
+
+  /// Loop where the next connection should run.
+  public func next() -> SSHEventLoop {
+    lock.lock(); defer { lock.unlock() }
+
+    // Start a new loop until we reach the limit, as long as existing ones are busy.
+    if loops.count < numberOfLoops && !loops.contains(where: { $0.numClients == 0 }) {
+      let loop = SSHEventLoop(name: "SSHEventLoop-\(loops.count)")
+      loops.append(loop)
+      return loop
+    }
+
+    // Least loaded, ties broken round-robin.
+    let start = nextIdx
+    nextIdx = (nextIdx + 1) % loops.count
+    var best = loops[start]
+    for i in 1..<loops.count {
+      let loop = loops[(start + i) % loops.count]
+      if loop.numClients < best.numClients {
+        best = loop
+      }
+    }
+    return best
+  }
+}
+
+/**
+ Hashed timer wheel. Timers are bucketed by expiration into a fixed ring of slots,
+ so scheduling and cancelling are O(1) and a single periodic tick serves
+ every keepalive and timeout on the loop, instead of one Timer per connection.
+ Not thread-safe, it belongs to the thread of its SSHEventLoop.
+ */
+final class SSHTimerWheel {
+  struct Token: Hashable {
+    fileprivate let id: UInt64
+  }
+
+  private struct Entry {
+    let id: UInt64
+    var rounds: Int
+    let block: () -> Void
+  }
+
+  let resolution: TimeInterval
+  private var slots: [[Entry]]
+  private var cursor = 0
+  private var lastId: UInt64 = 0
+  private var slotFor: [UInt64: Int] = [:]
+
+  var count: Int { slotFor.count }
+
+  init(slots: Int = 64, resolution: TimeInterval = 1) {
+    self.resolution = resolution
+    self.slots = Array(repeating: [], count: slots)
+  }
+
+  @discardableResult
+  func schedule(after interval: TimeInterval, _ block: @escaping () -> Void) -> Token {
+    let ticks = max(Int((interval / resolution).rounded(.up)), 1)
+    let slot = (cursor + ticks) % slots.count
+    let rounds = (ticks - 1) / slots.count
+
+    lastId += 1
+    slots[slot].append(Entry(id: lastId, rounds: rounds, block: block))
+    slotFor[lastId] = slot
+    return Token(id: lastId)
+  }
+
+  func cancel(_ token: Token) {
+    guard let slot = slotFor.removeValue(forKey: token.id) else {
+      return
+    }
+    slots[slot].removeAll { $0.id == token.id }
+  }
+
+  func tick() {
+    cursor = (cursor + 1) % slots.count
+
+    var expired: [Entry] = []
+    var remaining: [Entry] = []
+    for var entry in slots[cursor] {
+      if entry.rounds == 0 {
+        expired.append(entry)
+        slotFor.removeValue(forKey: entry.id)
+      } else {
+        entry.rounds -= 1
+        remaining.append(entry)
+      }
+    }
+    slots[cursor] = remaining
+
+    // Blocks may schedule again, so run them once the slot is consistent.
+    expired.forEach { $0.block() }
+  }
+}
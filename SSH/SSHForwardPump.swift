@@ -0,0 +1,456 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import Foundation
+import Network
+
+import LibSSH
+
+
+/**
+ Fixed size buffers reused between forwarded connections, so moving data
+ does not allocate on every read.
+ */
+final class SSHBufferPool {
+  static let shared = SSHBufferPool(bufferSize: 64 * 1024, maxCached: 64)
+
+  let bufferSize: Int
+  let maxCached: Int
+  private var buffers: [UnsafeMutableRawBufferPointer] = []
+  private let lock = NSLock()
+
+  init(bufferSize: Int, maxCached: Int) {
+    self.bufferSize = bufferSize
+    self.maxCached = maxCached
+  }
+
+  func take() -> UnsafeMutableRawBufferPointer {
+    lock.lock()
+    if let buf = buffers.popLast() {
+      lock.unlock()
+      return buf
+    }
+    lock.unlock()
+    return .allocate(byteCount: bufferSize, alignment: MemoryLayout<UInt8>.alignment)
+  }
+
+  func give(_ buf: UnsafeMutableRawBufferPointer) {
+    lock.lock()
+    if buffers.count < maxCached {
+      buffers.append(buf)
+      lock.unlock()
+      return
+    }
+    lock.unlock()
+    buf.deallocate()
+  }
+}
+
+/**
+ Counters for a tunnel, aggregated over all its connections. Safe to update
+ and read from any thread.
+ */
+public final class SSHTunnelStats {
+  public struct Snapshot {
+    public let opened: Int
+    public let active: Int
+    /// Waiting for a connection slot.
+    public let queued: Int
+    /// From the local socket to the channel.
+    public let bytesIn: Int
+    /// From the channel to the local socket.
+    public let bytesOut: Int
+    /// Average time to have the channel ready for a new connection.
+    public let averageSetupTime: TimeInterval
+    /// Average time from the channel being ready to the first byte from the remote.
+    public let averageFirstByteTime: TimeInterval
+  }
+
+  private let lock = NSLock()
+  private var opened = 0
+  private var active = 0
+  private var queued = 0
+  private var bytesIn = 0
+  private var bytesOut = 0
+  private var setupTime: TimeInterval = 0
+  private var firstByteTime: TimeInterval = 0
+  private var firstBytes = 0
+
+  public init() {}
+
+  public var snapshot: Snapshot {
+    lock.lock(); defer { lock.unlock() }
+    return Snapshot(opened: opened,
+                    active: active,
+                    queued: queued,
+                    bytesIn: bytesIn,
+                    bytesOut: bytesOut,
+                    averageSetupTime: opened > 0 ? setupTime / Double(opened) : 0,
+                    averageFirstByteTime: firstBytes > 0 ? firstByteTime / Double(firstBytes) : 0)
+  }
+
+  func connectionOpened(setupTime time: TimeInterval) {
+    lock.lock(); defer { lock.unlock() }
+    opened += 1
+    active += 1
+    setupTime += time
+  }
+
+  func connectionClosed() {
+    lock.lock(); defer { lock.unlock() }
+    active -= 1
+  }
+
+  func connectionQueued() {
+    lock.lock(); defer { lock.unlock() }
+    queued += 1
+  }
+
+  func connectionDequeued() {
+    lock.lock(); defer { lock.unlock() }
+    queued -= 1
+  }
+
+  func received(_ count: Int) {
+    lock.lock(); defer { lock.unlock() }
+    bytesIn += count
+  }
+
+  func sent(_ count: Int, firstByteAfter time: TimeInterval? = nil) {
+    lock.lock(); defer { lock.unlock() }
+    bytesOut += count
+    if let time = time {
+      firstByteTime += time
+      firstBytes += 1
+    }
+  }
+}
+
+/**
+ Moves data between a forwarded channel and a socket, without going through
+ Combine publishers like Stream.connect does.
+ - Channel to socket. Data is read into pooled buffers and handed to the connection without
+ copying. While a send is in flight the channel is not read, so libssh does not grow the
+ window and the remote stops sending.
+ - Socket to channel. The connection is only read when the channel window has room, and no
+ more than the window. Data is written straight from the received buffer.
+ All libssh calls happen on the RunLoop of the client. Connection callbacks hop back to it.
+ */
+final class SSHForwardPump {
+  let stream: Stream
+  let connection: NWConnection
+  let stats: SSHTunnelStats?
+  var channel: ssh_channel { stream.channel }
+  var client: SSHClient { stream.client }
+  var log: SSHLogger { stream.log }
+
+  var handleCompletion: (() -> Void)?
+  var handleFailure: ((Error) -> Void)?
+
+  private let pool = SSHBufferPool.shared
+  private var callbacks: ssh_channel_callbacks_struct? = nil
+  private var isSending = false
+  private var isReceiving = false
+  private var pendingWrite: (data: Data, offset: Int)? = nil
+  private var isWaitingForWindow = false
+  private var channelEOF = false
+  private var socketEOF = false
+  private var isDone = false
+  private var startedAt = Date()
+  private var firstByteSent = false
+
+  init(_ stream: Stream, connection: NWConnection, stats: SSHTunnelStats?) {
+    self.stream = stream
+    self.connection = connection
+    self.stats = stats
+  }
+
+  func start() {
+    client.perform {
+      guard !self.isDone else {
+        return
+      }
+      self.startedAt = Date()
+      if self.startCallbacks() != SSH_OK {
+        self.fail(SSHError(title: "Could not initialize callbacks.", forSession: self.client.session))
+        return
+      }
+      self.readChannel()
+      self.receiveSocket()
+    }
+  }
+
+  func cancel() {
+    client.perform { self.finish() }
+  }
+
+  // MARK: Channel -> Socket
+
+  private func readChannel() {
+    guard !isSending, !isDone else {
+      return
+    }
+
+    let buf = pool.take()
+    let rc = ssh_channel_read_nonblocking(channel, buf.baseAddress, UInt32(buf.count), 0)
+    if rc > 0 {
+      send(buf, count: Int(rc))
+      return
+    }
+
+    pool.give(buf)
+    if rc < 0 {
+      fail(SSHError(title: "Error while reading", forSession: client.session))
+    } else if ssh_channel_is_eof(channel) != 0 {
+      closeSocketSide()
+    }
+    // Otherwise, wait for the data callback.
+  }
+
+  private func send(_ buf: UnsafeMutableRawBufferPointer, count: Int) {
+    isSending = true
+    let pool = self.pool
+    let data = Data(bytesNoCopy: buf.baseAddress!, count: count, deallocator: .custom({ _, _ in pool.give(buf) }))
+
+    let firstByteAfter: TimeInterval? = firstByteSent ? nil : Date().timeIntervalSince(startedAt)
+    firstByteSent = true
+
+    connection.send(content: data, completion: .contentProcessed({ error in
+      self.client.perform {
+        self.isSending = false
+        if let error = error {
+          self.fail(SSHPortForwardError(title: "Could not send data over Connection", error))
+          return
+        }
+        self.stats?.sent(count, firstByteAfter: firstByteAfter)
+        self.readChannel()
+      }
+    }))
+  }
+
+  private func closeSocketSide() {
+    guard !channelEOF else {
+      return
+    }
+    channelEOF = true
+    log.message("Forward channel EOF", SSH_LOG_INFO)
+    connection.send(content: nil, contentContext: .finalMessage, isComplete: true, completion: .contentProcessed({ _ in
+      self.client.perform { self.complete() }
+    }))
+  }
+
+  // MARK: Socket -> Channel
+
+  private func receiveSocket() {
+    guard !isReceiving, pendingWrite == nil, !socketEOF, !isDone else {
+      return
+    }
+
+    let window = Int(ssh_channel_window_size(channel))
+    if window == 0 {
+      waitForWindow()
+      return
+    }
+
+    isReceiving = true
+    connection.receive(minimumIncompleteLength: 1,
+                       maximumLength: min(window, pool.bufferSize)) { data, _, isComplete, error in
+      self.client.perform {
+        self.isReceiving = false
+        if let error = error {
+          self.fail(SSHPortForwardError(title: "Connection Reading error", error))
+          return
+        }
+        if let data = data, !data.isEmpty {
+          self.stats?.received(data.count)
+          self.pendingWrite = (data, 0)
+        }
+        if isComplete {
+          self.socketEOF = true
+        }
+        self.writeChannel()
+      }
+    }
+  }
+
+  private func writeChannel() {
+    guard !isDone else {
+      return
+    }
+    guard let (data, offset) = pendingWrite else {
+      if socketEOF {
+        log.message("Forward socket EOF. Sending EOF", SSH_LOG_INFO)
+        if ssh_channel_send_eof(channel) != SSH_OK {
+          fail(SSHError(title: "Could not send EOF", forSession: client.session))
+        }
+      } else {
+        receiveSocket()
+      }
+      return
+    }
+
+    let window = Int(ssh_channel_window_size(channel))
+    if window == 0 {
+      waitForWindow()
+      return
+    }
+
+    let scheduler = client.writeScheduler
+    let size = scheduler.grant(stream.writeFlow, wanting: min(data.count - offset, window))
+    if size == 0 {
+      client.perform { self.writeChannel() }
+      return
+    }
+
+    let rc = data.withUnsafeBytes { bytes -> Int32 in
+      ssh_channel_write(channel, bytes.baseAddress! + offset, UInt32(size))
+    }
+    if rc < 0 {
+      fail(SSHError(rc, forSession: client.session))
+      return
+    }
+    scheduler.didWrite(stream.writeFlow, bytes: Int(rc))
+
+    let written = offset + Int(rc)
+    pendingWrite = written == data.count ? nil : (data, written)
+    client.perform { self.writeChannel() }
+  }
+
+  private func waitForWindow() {
+    // The write-wontblock callback resumes the flow. Check again in a while in case the
+    // window was adjusted while we were not listening.
+    guard !isWaitingForWindow else {
+      return
+    }
+    isWaitingForWindow = true
+    client.rloop.schedule(after: .init(Date(timeIntervalSinceNow: 0.05))) {
+      self.windowAvailable()
+    }
+  }
+
+  private func windowAvailable() {
+    guard isWaitingForWindow else {
+      return
+    }
+    isWaitingForWindow = false
+    if pendingWrite != nil {
+      writeChannel()
+    } else {
+      receiveSocket()
+    }
+  }
+
+  // MARK: Callbacks
+
+  private func startCallbacks() -> Int32 {
+    callbacks = ssh_channel_callbacks_struct()
+    ssh_init_channel_callbacks(&callbacks!)
+    callbacks!.userdata = UnsafeMutableRawPointer(Unmanaged.passUnretained(self).toOpaque())
+    callbacks!.channel_data_function = self.hasDataCallback
+    callbacks!.channel_eof_function = self.channelEOFCallback
+    callbacks!.channel_close_function = self.channelClosingCallback
+    callbacks!.channel_write_wontblock_function = self.writeWontBlockCallback
+
+    return ssh_add_channel_callbacks(channel, &callbacks!)
+  }
+
+  private func stopCallbacks() {
+    if callbacks != nil {
+      callbacks!.userdata = nil
+      ssh_remove_channel_callbacks(channel, &callbacks!)
+      callbacks = nil
+    }
+  }
+
+  private let hasDataCallback: ssh_channel_data_callback = { (session, channel, buf, length, is_stderr, userdata) -> Int32 in
+    let ctxt = Unmanaged<SSHForwardPump>.fromOpaque(userdata!).takeUnretainedValue()
+
+    // Leave the data on the channel while the socket catches up. That holds the window.
+    if is_stderr != 0 || length == 0 || ctxt.isSending || ctxt.isDone {
+      return 0
+    }
+
+    let pooled = ctxt.pool.take()
+    let count = min(Int(length), pooled.count)
+    pooled.copyMemory(from: UnsafeRawBufferPointer(start: buf, count: count))
+    ctxt.send(pooled, count: count)
+
+    return Int32(count)
+  }
+
+  private let channelEOFCallback: ssh_channel_eof_callback = { (session, channel, userdata) in
+    let ctxt = Unmanaged<SSHForwardPump>.fromOpaque(userdata!).takeUnretainedValue()
+    // Cannot change the state of the channel inside a callback.
+    ctxt.client.perform { ctxt.readChannel() }
+  }
+
+  private let channelClosingCallback: ssh_channel_close_callback = { (session, channel, userdata) in
+    let ctxt = Unmanaged<SSHForwardPump>.fromOpaque(userdata!).takeUnretainedValue()
+    ctxt.client.perform { ctxt.readChannel() }
+  }
+
+  private let writeWontBlockCallback: ssh_channel_write_wontblock_callback = { (session, channel, bytes, userdata) -> Int32 in
+    let ctxt = Unmanaged<SSHForwardPump>.fromOpaque(userdata!).takeUnretainedValue()
+    ctxt.client.perform { ctxt.windowAvailable() }
+    return 0
+  }
+
+  // MARK: Lifecycle
+
+  private func complete() {
+    guard !isDone else {
+      return
+    }
+    log.message("Forward complete", SSH_LOG_INFO)
+    let handleCompletion = self.handleCompletion
+    finish()
+    handleCompletion?()
+  }
+
+  private func fail(_ error: Error) {
+    guard !isDone else {
+      return
+    }
+    log.message("Forward failure \(error)", SSH_LOG_WARN)
+    let handleFailure = self.handleFailure
+    finish()
+    handleFailure?(error)
+  }
+
+  private func finish() {
+    guard !isDone else {
+      return
+    }
+    isDone = true
+    stopCallbacks()
+    pendingWrite = nil
+    handleCompletion = nil
+    handleFailure = nil
+    stats?.connectionClosed()
+  }
+}
@@ -0,0 +1,366 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+
+import CryptoKit
+import Foundation
+
+
+/**
+ In-memory index of a known_hosts file. The file is parsed once and parsed again
+ only when its stamp changes, so verification and completion do not read it on
+ every call. Plain hosts are indexed by their `host` or `[host]:port` token,
+ hashed `|1|salt|hash` entries are resolved once per token and memoized, and
+ wildcard patterns are checked in order.
+ Stores are shared per path through `SSHKnownHosts.store(at:)`.
+ */
+public final class SSHKnownHosts {
+  public enum Verification: Equatable {
+    case ok
+    /// A key of the same type is recorded with a different value.
+    case changed
+    /// Only keys of other types are recorded for the host.
+    case other
+    case unknown
+    /// There is no known_hosts file.
+    case notFound
+  }
+
+  struct Entry {
+    enum Marker {
+      case revoked
+      case certAuthority
+    }
+
+    let line: Int
+    let marker: Marker?
+    let keyType: String
+    let key: String
+    // Number of host patterns on the line, to know if it only belongs to one host.
+    let hostCount: Int
+  }
+
+  struct Stamp: Equatable {
+    let exists: Bool
+    let inode: UInt64
+    let size: Int64
+    let mtimeSec: Int
+    let mtimeNsec: Int
+
+    init(_ path: String) {
+      var st = stat()
+      guard stat(path, &st) == 0 else {
+        self.exists = false
+        self.inode = 0
+        self.size = 0
+        self.mtimeSec = 0
+        self.mtimeNsec = 0
+        return
+      }
+      self.exists = true
+      self.inode = UInt64(st.st_ino)
+      self.size = Int64(st.st_size)
+      self.mtimeSec = st.st_mtimespec.tv_sec
+      self.mtimeNsec = st.st_mtimespec.tv_nsec
+    }
+  }
+
+  private struct HashedHost {
+    let salt: Data
+    let hash: Data
+    let negated: Bool
+  }
+
+  private struct Pattern {
+    let pattern: String
+    let negated: Bool
+  }
+
+  private static var stores: [String: SSHKnownHosts] = [:]
+  private static let storesLock = NSLock()
+
+  public static func store(at path: String) -> SSHKnownHosts {
+    storesLock.lock()
+    defer { storesLock.unlock() }
+    if let store = stores[path] {
+      return store
+    }
+    let store = SSHKnownHosts(path: path)
+    stores[path] = store
+    return store
+  }
+
+  public let path: String
+  private let lock = NSLock()
+  private var stamp: Stamp? = nil
+  private var lines: [String] = []
+
+  private var plain: [String: [Entry]] = [:]
+  private var hashed: [(HashedHost, Entry)] = []
+  // Lines with wildcards or negations are matched one by one.
+  private var patterns: [([Pattern], Entry)] = []
+  private var hashedMemo: [String: [Entry]] = [:]
+  private var _hostNames: [String]? = nil
+
+  init(path: String) {
+    self.path = path
+  }
+
+  /// Host token as written on known_hosts. Port 22 is implicit.
+  public static func token(host: String, port: Int) -> String {
+    port == 22 ? host.lowercased() : "[\(host.lowercased())]:\(port)"
+  }
+
+  public func verify(host: String, port: Int, keyType: String, key: String) -> Verification {
+    lock.lock()
+    defer { lock.unlock() }
+
+    reloadIfNeeded()
+    guard stamp?.exists == true else {
+      return .notFound
+    }
+
+    let entries = _entries(for: Self.token(host: host, port: port))
+    if entries.contains(where: { $0.marker == .revoked && $0.key == key }) {
+      return .changed
+    }
+
+    let keys = entries.filter { $0.marker == nil }
+    if keys.contains(where: { $0.keyType == keyType && $0.key == key }) {
+      return .ok
+    }
+    if keys.contains(where: { $0.keyType == keyType }) {
+      return .changed
+    }
+    return keys.isEmpty ? .unknown : .other
+  }
+
+  /// Plain host names for completion. Hashed and wildcard entries are skipped.
+  public func hostNames() -> [String] {
+    lock.lock()
+    defer { lock.unlock() }
+
+    reloadIfNeeded()
+    if let names = _hostNames {
+      return names
+    }
+    let names = Set(plain.keys.map { token -> String in
+      // [host]:port -> host
+      guard token.hasPrefix("["), let end = token.firstIndex(of: "]") else {
+        return token
+      }
+      return String(token[token.index(after: token.startIndex)..<end])
+    })
+    _hostNames = names.sorted()
+    return _hostNames!
+  }
+
+  /**
+   Record `key` for the host. Lines that only belong to this host and have a key of
+   the same type are replaced. The file is written to a temporary file and renamed
+   over the original, so readers never see a partial update.
+   */
+  public func update(host: String, port: Int, keyType: String, key: String) throws {
+    lock.lock()
+    defer { lock.unlock() }
+
+    reloadIfNeeded()
+    let token = Self.token(host: host, port: port)
+    let replaced = Set(
+      _entries(for: token)
+        .filter { $0.hostCount == 1 && $0.marker == nil && $0.keyType == keyType }
+        .map { $0.line }
+    )
+
+    var content = lines.enumerated()
+      .filter { !replaced.contains($0.offset) }
+      .map { $0.element }
+      .joined(separator: "\n")
+    if !content.isEmpty && !content.hasSuffix("\n") {
+      content += "\n"
+    }
+    content += "\(token) \(keyType) \(key)\n"
+
+    let dir = (path as NSString).deletingLastPathComponent
+    try FileManager.default.createDirectory(atPath: dir, withIntermediateDirectories: true)
+    let tmp = (dir as NSString).appendingPathComponent(".known_hosts.\(UUID().uuidString)")
+    guard FileManager.default.createFile(atPath: tmp, contents: content.data(using: .utf8),
+                                         attributes: [.posixPermissions: 0o600]) else {
+      throw SSHError(title: "Could not write known_hosts file.")
+    }
+    guard rename(tmp, path) == 0 else {
+      unlink(tmp)
+      throw SSHError(title: "Could not update known_hosts file.")
+    }
+
+    // Force a reload, the index is built the same way as for external changes.
+    stamp = nil
+  }
+
+  private func _entries(for token: String) -> [Entry] {
+    var entries = plain[token] ?? []
+
+    if let memo = hashedMemo[token] {
+      entries += memo
+    } else {
+      let tokenData = Data(token.utf8)
+      var negated = Set<Int>()
+      var matched: [Entry] = []
+      for (h, entry) in hashed {
+        let mac = Data(HMAC<Insecure.SHA1>.authenticationCode(for: tokenData, using: SymmetricKey(data: h.salt)))
+        guard mac == h.hash else {
+          continue
+        }
+        if h.negated {
+          negated.insert(entry.line)
+        } else {
+          matched.append(entry)
+        }
+      }
+      let memo = matched.filter { !negated.contains($0.line) }
+      hashedMemo[token] = memo
+      entries += memo
+    }
+
+    for (patterns, entry) in self.patterns {
+      var isMatch = false
+      for p in patterns where Self.wildcardMatch(p.pattern, token) {
+        if p.negated {
+          isMatch = false
+          break
+        }
+        isMatch = true
+      }
+      if isMatch {
+        entries.append(entry)
+      }
+    }
+    return entries
+  }
+
+  private func reloadIfNeeded() {
+    let current = Stamp(path)
+    guard current != stamp else {
+      return
+    }
+
+    stamp = current
+    lines = []
+    plain = [:]
+    hashed = []
+    patterns = []
+    hashedMemo = [:]
+    _hostNames = nil
+
+    guard current.exists, let data = FileManager.default.contents(atPath: path) else {
+      return
+    }
+    lines = String(decoding: data, as: UTF8.self)
+      .split(separator: "\n", omittingEmptySubsequences: false)
+      .map(String.init)
+    if lines.last == "" {
+      lines.removeLast()
+    }
+
+    for (n, line) in lines.enumerated() {
+      var fields = line.split(whereSeparator: { $0 == " " || $0 == "\t" }).map(String.init)
+      guard let first = fields.first, !first.hasPrefix("#") else {
+        continue
+      }
+
+      var marker: Entry.Marker? = nil
+      if first.hasPrefix("@") {
+        switch first {
+        case "@revoked":        marker = .revoked
+        case "@cert-authority": marker = .certAuthority
+        default:                continue
+        }
+        fields.removeFirst()
+      }
+      guard fields.count >= 3 else {
+        continue
+      }
+
+      let hosts = fields[0].split(separator: ",").map(String.init)
+      let entry = Entry(line: n, marker: marker, keyType: fields[1], key: fields[2], hostCount: hosts.count)
+      var linePatterns: [Pattern] = []
+
+      for host in hosts {
+        let negated = host.hasPrefix("!")
+        let name = negated ? String(host.dropFirst()) : host
+
+        if name.hasPrefix("|1|") {
+          let parts = name.split(separator: "|")
+          guard parts.count == 3,
+                let salt = Data(base64Encoded: String(parts[1])),
+                let hash = Data(base64Encoded: String(parts[2])) else {
+            continue
+          }
+          hashed.append((HashedHost(salt: salt, hash: hash, negated: negated), entry))
+        } else {
+          linePatterns.append(Pattern(pattern: name.lowercased(), negated: negated))
+        }
+      }
+      if linePatterns.contains(where: { $0.negated || $0.pattern.contains(where: { $0 == "*" || $0 == "?" }) }) {
+        patterns.append((linePatterns, entry))
+      } else {
+        linePatterns.forEach { plain[$0.pattern, default: []].append(entry) }
+      }
+    }
+  }
+
+  // Only * and ? are special, like OpenSSH match_pattern. Brackets are literal
+  // as they are part of [host]:port tokens.
+  static func wildcardMatch(_ pattern: String, _ string: String) -> Bool {
+    let p = Array(pattern.utf8)
+    let s = Array(string.utf8)
+    var pi = 0, si = 0
+    var star = -1, mark = 0
+
+    while si < s.count {
+      if pi < p.count && (p[pi] == UInt8(ascii: "?") || p[pi] == s[si]) {
+        pi += 1
+        si += 1
+      } else if pi < p.count && p[pi] == UInt8(ascii: "*") {
+        star = pi
+        mark = si
+        pi += 1
+      } else if star >= 0 {
+        pi = star + 1
+        mark += 1
+        si = mark
+      } else {
+        return false
+      }
+    }
+    while pi < p.count && p[pi] == UInt8(ascii: "*") {
+      pi += 1
+    }
+    return pi == p.count
+  }
+}
@@ -62,6 +62,7 @@ public class SSHPortForwardListener {
   var cancellableBag: [AnyCancellable] = []
   
   var status = CurrentValueSubject<PortForwardState, Error>(.starting)
+  public let stats = SSHTunnelStats()
   
   var connections: [NWConnection] = []
   
@@ -163,6 +164,7 @@ public class SSHPortForwardListener {
       
       switch state {
       case .ready:
+        let requestedAt = Date()
         cancellable = self.client.requestForward(to: self.host,
                                                  port: Int32(self.remotePort.rawValue),
                                                  from: "localhost", localPort: Int32(self.localPort.rawValue))
@@ -178,7 +180,8 @@ public class SSHPortForwardListener {
             self.log.message("Forward received. Connecting to stream.", SSH_LOG_INFO)
             stream = s
             
-            s.connect(stdout: conn, stdin: conn)
+            self.stats.connectionOpened(setupTime: Date().timeIntervalSince(requestedAt))
+            s.connect(to: conn, stats: self.stats)
             s.handleCompletion = {
               self.closeConnection(conn)
               // Detach the stream, so we do not wait for the conn to be
@@ -238,6 +241,56 @@ public class SSHPortForwardListener {
   }
 }
 
+/**
+ How a reverse forward handles the local connections for the streams it receives.
+ */
+public struct SSHForwardPolicy {
+  /// Local connections open at the same time, prewarmed ones included. Zero for no limit.
+  public var maxConnections: Int
+  /// Streams waiting for a connection while at the limit. Further ones are closed.
+  public var maxQueued: Int
+  /// Local connections opened ahead of time, so a new stream does not wait on the handshake.
+  public var prewarm: Int
+  /// Prewarmed connections older than this are replaced, as servers drop idle sockets.
+  public var prewarmLifetime: TimeInterval
+
+  public init(maxConnections: Int = 0, maxQueued: Int = 64,
+              prewarm: Int = 0, prewarmLifetime: TimeInterval = 30) {
+    self.maxConnections = maxConnections
+    self.maxQueued = maxQueued
+    self.prewarm = prewarm
+    self.prewarmLifetime = prewarmLifetime
+  }
+
+  enum Admission {
+    case serve
+    case queue
+    case close
+  }
+
+  /// What to do with a new stream, given the connections in use and the streams already waiting.
+  func admit(streams: Int, warm: Int, queued: Int) -> Admission {
+    // A prewarmed connection is already counted, so it can always be handed over.
+    guard warm == 0, maxConnections > 0, streams >= maxConnections else {
+      return .serve
+    }
+    return queued < maxQueued ? .queue : .close
+  }
+
+  /// Connections to prewarm so there are enough of them, without going over the limit.
+  func missingWarm(streams: Int, warm: Int) -> Int {
+    var missing = prewarm - warm
+    if maxConnections > 0 {
+      missing = min(missing, maxConnections - streams - warm)
+    }
+    return max(missing, 0)
+  }
+
+  func isFresh(openedAt: Date, now: Date = Date()) -> Bool {
+    now.timeIntervalSince(openedAt) < prewarmLifetime
+  }
+}
+
 public class SSHPortForwardClient {
   let client: SSHClient
   let forwardHost: NWEndpoint.Host
@@ -245,22 +298,29 @@ public class SSHPortForwardClient {
   let queue: DispatchQueue
   let remotePort: NWEndpoint.Port
   let bindAddress: String?
+  public let policy: SSHForwardPolicy
 
   var log: SSHLogger { get { client.log } }
   
   let status = CurrentValueSubject<PortForwardState, Error>(.starting)
+  public let stats = SSHTunnelStats()
   var isReady = false
   
   var reverseForward: AnyCancellable?
+  // Streams, queued streams and prewarmed connections are only touched on the queue.
   var streams: [Stream] = []
+  private var queued: [(stream: Stream, receivedAt: Date)] = []
+  private var warm: [(conn: NWConnection, openedAt: Date)] = []
   
   public init(forward address: String, onPort localPort: UInt16,
-              toRemotePort remotePort: UInt16, bindAddress: String? = nil, using client: SSHClient) {
+              toRemotePort remotePort: UInt16, bindAddress: String? = nil,
+              policy: SSHForwardPolicy = SSHForwardPolicy(), using client: SSHClient) {
     self.localPort = NWEndpoint.Port(integerLiteral: localPort)
     self.forwardHost = NWEndpoint.Host(address)
     self.remotePort = NWEndpoint.Port(integerLiteral: remotePort)
     self.queue = DispatchQueue(label: "r-fwd-\(localPort)")
     self.bindAddress = bindAddress
+    self.policy = policy
     self.client = client
   }
   
@@ -273,6 +333,7 @@ public class SSHPortForwardClient {
         // Notify that a connection has been established.
         self.status.send(PortForwardState.ready)
         self.isReady = true
+        self.queue.async { self.prewarm() }
         return pub
       }
       .sink(
@@ -314,23 +375,87 @@ public class SSHPortForwardClient {
   public func close() {
       log.message("Closing Reverse Forward", SSH_LOG_INFO)
       reverseForward = nil
-      streams.forEach { $0.cancel() }
-      streams = []
+      isReady = false
+      queue.async {
+        self.streams.forEach { $0.cancel() }
+        self.streams = []
+        self.queued.forEach {
+          $0.stream.cancel()
+          self.stats.connectionDequeued()
+        }
+        self.queued = []
+        self.warm.forEach { $0.conn.cancel() }
+        self.warm = []
+      }
       self.status.send(completion: .finished)
   }
   
   private func receive(stream: Stream) {
     self.log.message("Reverse stream received. Establishing connection and piping stream", SSH_LOG_INFO)
+    let receivedAt = Date()
 
+    queue.async {
+      switch self.policy.admit(streams: self.streams.count, warm: self.warm.count, queued: self.queued.count) {
+      case .serve:
+        self.serve(stream, receivedAt: receivedAt)
+      case .queue:
+        self.queued.append((stream, receivedAt))
+        self.stats.connectionQueued()
+      case .close:
+        self.log.message("Reverse forward queue is full. Closing stream.", SSH_LOG_WARN)
+        stream.cancel()
+      }
+    }
+  }
+
+  private func serve(_ stream: Stream, receivedAt: Date) {
     self.streams.append(stream)
+    let conn = takeWarmConnection() ?? newConnection()
+    prewarm()
+
+    // Includes the time waiting in the queue.
+    self.stats.connectionOpened(setupTime: Date().timeIntervalSince(receivedAt))
+    stream.connect(to: conn, stats: self.stats)
+
+    weak var weakStream = stream
+    stream.handleCompletion = { [weak self] in
+      guard let self = self, let stream = weakStream else {
+        return
+      }
+      conn.cancel()
+      self.queue.async { self.release(stream) }
+    }
+    stream.handleFailure = { [weak self] error in
+      guard let self = self, let stream = weakStream else {
+        return
+      }
+      self.status.send(.error(error))
+      conn.cancel()
+      self.queue.async { self.release(stream) }
+    }
+  }
+
+  private func release(_ stream: Stream) {
+    guard removeStream(stream) else {
+      return
+    }
+    if !queued.isEmpty {
+      let next = queued.removeFirst()
+      stats.connectionDequeued()
+      serve(next.stream, receivedAt: next.receivedAt)
+    } else {
+      prewarm()
+    }
+  }
+
+  private func newConnection() -> NWConnection {
     let conn = NWConnection(host: self.forwardHost, port: self.localPort, using: .tcp)
     conn.stateUpdateHandler = { [weak self] (state: NWConnection.State) in
       guard let self = self else {
         return
       }
       self.log.message("Connection state Updated \(state)", SSH_LOG_INFO)
-      self.isReady = false
-      
+
       switch state {
       case .ready:
         // NOTE For the dashboard, we could offer another publisher for the state of the connection.
@@ -339,37 +464,65 @@ public class SSHPortForwardClient {
         // Just notify, the connection itself will be reopened after a wait.
         self.status.send(PortForwardState.waiting(error))
       case .failed(let error):
+        // A prewarmed connection failing is replaced with the next stream, not fatal.
+        if self.dropWarm(conn) {
+          return
+        }
         self.status.send(completion: .failure(SSHPortForwardError(title: "Connection state failed", error)))
+      case .cancelled:
+        self.dropWarm(conn)
       default:
         break
       }
     }
     conn.start(queue: self.queue)
-    stream.connect(stdout: conn, stdin: conn)
+    return conn
+  }
 
-    
-    weak var weakStream = stream
-    stream.handleCompletion = { [weak self] in
-      guard let self = self, let stream = weakStream else {
-        return
+  private func takeWarmConnection() -> NWConnection? {
+    let now = Date()
+    while !warm.isEmpty {
+      let w = warm.removeFirst()
+      if policy.isFresh(openedAt: w.openedAt, now: now) {
+        switch w.conn.state {
+        case .setup, .preparing, .ready:
+          return w.conn
+        default:
+          break
+        }
       }
-      self.removeStream(stream)
-      conn.cancel()
+      w.conn.cancel()
     }
-    stream.handleFailure = { [weak self] error in
-      guard let self = self, let stream = weakStream else {
-        return
-      }
-      self.removeStream(stream)
-      self.status.send(.error(error))
-      conn.cancel()
+    return nil
+  }
+
+  private func prewarm() {
+    guard isReady else {
+      return
+    }
+    var missing = policy.missingWarm(streams: streams.count, warm: warm.count)
+    while missing > 0 {
+      warm.append((newConnection(), Date()))
+      missing -= 1
+    }
+  }
+
+  @discardableResult
+  private func dropWarm(_ conn: NWConnection) -> Bool {
+    guard let idx = warm.firstIndex(where: { $0.conn === conn }) else {
+      return false
     }
+    warm.remove(at: idx)
+    return true
   }
   
-  private func removeStream(_ s: SSH.Stream) {
+  @discardableResult
+  private func removeStream(_ s: SSH.Stream) -> Bool {
     if let idx = self.streams.firstIndex(where: { s === $0 }) {
       self.streams.remove(at: idx)
+      return true
     }
+    return false
   }
   
 }
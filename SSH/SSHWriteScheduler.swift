@@ -0,0 +1,174 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import Foundation
+
+
+/**
+ Schedules outgoing data from all the channels multiplexed on a session.
+ Channels share one socket, so a bulk transfer writing as fast as the window allows would
+ fill the session buffers, and keystrokes would queue behind megabytes of data.
+ - Interactive flows (PTY channels) have strict priority. They are written in small quanta and
+ bulk flows yield while interactive data is waiting.
+ - Bulk flows share what is left with weighted Deficit Round Robin. Each flow earns
+ `bulkQuantum * weight` per turn of the RunLoop, and what it does not use carries over, so
+ a writer that needs a larger block gets it after a few turns. All bulk flows together write
+ no more than `bulkBudgetPerTurn`, so the amount queued ahead of an interactive write stays bounded.
+ Writers ask for a grant before writing, and report what they wrote. A grant of zero means
+ the writer should reschedule itself on the client and try again.
+ Not thread-safe, it must be used from the RunLoop of the client.
+ */
+public final class SSHWriteScheduler {
+  public enum Priority: Equatable {
+    case interactive
+    case bulk(weight: Int)
+  }
+
+  public final class Flow {
+    public let priority: Priority
+    public fileprivate(set) var bytesWritten = 0
+    fileprivate var deficit = 0
+    fileprivate var replenishedOnTurn = -1
+    fileprivate var pending = 0
+    fileprivate var isRegistered = true
+
+    fileprivate init(_ priority: Priority) {
+      self.priority = priority
+    }
+  }
+
+  let interactiveQuantum: Int
+  let bulkQuantum: Int
+  let bulkBudgetPerTurn: Int
+
+  private let perform: (@escaping () -> Void) -> Void
+  private var turn = 0
+  private var bulkWrittenOnTurn = 0
+  private var isTurnScheduled = false
+  private var interactivePending = 0
+  public private(set) var numFlows = 0
+
+  init(interactiveQuantum: Int = 4 * 1024,
+       bulkQuantum: Int = 32 * 1024,
+       bulkBudgetPerTurn: Int = 256 * 1024,
+       perform: @escaping (@escaping () -> Void) -> Void) {
+    self.interactiveQuantum = interactiveQuantum
+    self.bulkQuantum = bulkQuantum
+    self.bulkBudgetPerTurn = bulkBudgetPerTurn
+    self.perform = perform
+  }
+
+  public func register(_ priority: Priority) -> Flow {
+    numFlows += 1
+    return Flow(priority)
+  }
+
+  public func unregister(_ flow: Flow) {
+    guard flow.isRegistered else {
+      return
+    }
+    flow.isRegistered = false
+    cancelPending(flow)
+    numFlows -= 1
+  }
+
+  /// Announce data waiting to be written. Bulk flows will yield while interactive data is pending.
+  func willWrite(_ flow: Flow, bytes: Int) {
+    guard flow.priority == .interactive else {
+      return
+    }
+    flow.pending += bytes
+    interactivePending += bytes
+  }
+
+  /// The writer gave up on the announced data (cancelled or failed).
+  func cancelPending(_ flow: Flow) {
+    interactivePending -= flow.pending
+    flow.pending = 0
+  }
+
+  /// Bytes the flow may write now, up to `wanting`.
+  func grant(_ flow: Flow, wanting: Int) -> Int {
+    switch flow.priority {
+    case .interactive:
+      return min(wanting, interactiveQuantum)
+    case .bulk(let weight):
+      if interactivePending > 0 {
+        return 0
+      }
+      let budget = bulkBudgetPerTurn - bulkWrittenOnTurn
+      if budget <= 0 {
+        return 0
+      }
+      // The deficit grows once per turn, up to what the flow wants, so credit is not hoarded.
+      // A flow that used it waits for the next turn.
+      let quantum = bulkQuantum * max(weight, 1)
+      if flow.replenishedOnTurn != turn {
+        flow.replenishedOnTurn = turn
+        flow.deficit = min(flow.deficit + quantum, max(quantum, wanting))
+      }
+      let granted = max(min(wanting, flow.deficit, budget), 0)
+      if granted < wanting {
+        // Writers only take whole blocks, so they may not write at all until the deficit grows.
+        scheduleTurn()
+      }
+      return granted
+    }
+  }
+
+  func didWrite(_ flow: Flow, bytes: Int) {
+    guard bytes > 0 else {
+      return
+    }
+    flow.bytesWritten += bytes
+
+    switch flow.priority {
+    case .interactive:
+      let settled = min(bytes, flow.pending)
+      flow.pending -= settled
+      interactivePending -= settled
+    case .bulk:
+      flow.deficit -= bytes
+      bulkWrittenOnTurn += bytes
+      scheduleTurn()
+    }
+  }
+
+  private func scheduleTurn() {
+    if !isTurnScheduled {
+      isTurnScheduled = true
+      perform { self.nextTurn() }
+    }
+  }
+
+  private func nextTurn() {
+    turn &+= 1
+    bulkWrittenOnTurn = 0
+    isTurnScheduled = false
+  }
+}
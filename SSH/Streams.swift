@@ -30,6 +30,7 @@ import Combine
 import Foundation
 import FlowConsoleFiles
 import LibSSH
+import Network
 
 /**
  * A stream controls, reads and writes the received channel,
@@ -40,12 +41,15 @@ import LibSSH
 public class Stream : Reader, Writer, WriterTo {
   let channel: ssh_channel
   let client: SSHClient
+  /// Place of the stream on the write scheduler of the connection.
+  let writeFlow: SSHWriteScheduler.Flow
   
   var log: SSHLogger { get { client.log } }
   
   var stdoutCancellable: AnyCancellable?
   var stdinCancellable: AnyCancellable?
   var stderrCancellable: AnyCancellable?
+  var forwardPump: SSHForwardPump?
   
   // Handle counts internally on long running streams as a helper when debugging,
   // to know if both sides are receiving the same information, or if there is a problem
@@ -59,10 +63,21 @@ public class Stream : Reader, Writer, WriterTo {
    */
   public var handleCompletion: (() -> ())?
   public var handleFailure: ((Error) -> ())?
-  
-  init(_ channel: ssh_channel, on client: SSHClient) {
+
+  /**
+   * Exit status of the remote command, or nil if the server has not sent it (yet).
+   * Servers send it right before closing the channel, so it is usually available
+   * from handleCompletion. Must be called from the client loop.
+   */
+  public var exitStatus: Int32? {
+    let rc = ssh_channel_get_exit_status(channel)
+    return rc < 0 ? nil : rc
+  }
+
+  init(_ channel: ssh_channel, on client: SSHClient, priority: SSHWriteScheduler.Priority = .bulk(weight: 1)) {
     self.channel = channel
     self.client = client
+    self.writeFlow = client.writeScheduler.register(priority)
   }
   
   /**
@@ -103,7 +118,6 @@ public class Stream : Reader, Writer, WriterTo {
         })
     
     stdinCancellable = input?.writeTo(instream)
-      .print("INSTREAM")
       .receive(on: client.rloop).sink(
         receiveCompletion: { completion in
           switch completion {
@@ -153,6 +167,27 @@ public class Stream : Reader, Writer, WriterTo {
     }
   }
   
+  /**
+   * Connect the stream to a socket, for forwarded channels. Instead of the Reader/Writer flows,
+   * data is moved directly between the channel and the connection, with backpressure from both sides.
+   * Completion and failure are notified through the same callbacks as `connect(stdout:stdin:stderr:)`.
+   */
+  public func connect(to connection: NWConnection, stats: SSHTunnelStats? = nil) {
+    let pump = SSHForwardPump(self, connection: connection, stats: stats)
+    pump.handleCompletion = {
+      self.log.message("Channel complete", SSH_LOG_INFO)
+      self.handleCompletion?()
+      self.handleCompletion = nil
+      self.cancel()
+    }
+    pump.handleFailure = { error in
+      self.handleFailure?(error)
+      self.cancel()
+    }
+    forwardPump = pump
+    pump.start()
+  }
+  
   public func read(max length: Int) -> AnyPublisher<DispatchData, Error> {
     let outstream = OutStream(self)
     return outstream.read(max: length)
@@ -210,11 +245,15 @@ public class Stream : Reader, Writer, WriterTo {
     stdoutCancellable = nil
     stdinCancellable = nil
     stderrCancellable = nil
+    forwardPump?.cancel()
+    forwardPump = nil
   }
   
   deinit {
     print("Stream Deinit")
     self.log.message("Stream Deinit", SSH_LOG_INFO)
+    let (client, flow) = (self.client, self.writeFlow)
+    client.perform { client.writeScheduler.unregister(flow) }
     self.client.closeChannel(self.channel)
   }
 }
@@ -352,7 +391,7 @@ extension OutStream: Reader {
         return
       } else if bytesLeft > 0 {
         if demand == .unlimited {
-          RunLoop.current.perform { self.readAsync() }
+          parent.stream.client.perform { self.readAsync() }
           return
         } else if callbacks == nil {
           if startCallbacks() != SSH_OK {
@@ -505,6 +544,8 @@ extension InStream: Writer {
   public func write(_ buf: DispatchData, max length: Int) ->AnyPublisher<Int, Error> {
     var cancelled = false
     let pb = PassthroughSubject<Int, Error>()
+    let scheduler = client.writeScheduler
+    let flow = stream.writeFlow
     
     // Limit buf to length before continuing
     //let buffer = buf.subdata(in: 0..<length)
@@ -516,11 +557,16 @@ extension InStream: Writer {
       let window = ssh_channel_window_size(self.channel)
       if window == 0 {
         self.log.message("Window depleted", SSH_LOG_DEBUG)
-        self.rloop.perform { write(data) }
+        self.client.perform { write(data) }
         return
       }
       
-      let size: UInt32 = min(UInt32(data.count), window)
+      let size = UInt32(scheduler.grant(flow, wanting: Int(min(UInt32(data.count), window))))
+      if size == 0 {
+        self.log.message("Yielding to other channels", SSH_LOG_DEBUG)
+        self.client.perform { write(data) }
+        return
+      }
       
       self.log.message("Trying to write \(size) with window \(window)", SSH_LOG_DEBUG)
       let rc = data.withUnsafeBytes { bytes -> Int32 in
@@ -528,10 +574,12 @@ extension InStream: Writer {
       }
       
       if rc < 0 {
+        scheduler.cancelPending(flow)
         pb.send(completion: .failure(SSHError(rc, forSession: self.session)))
         return
       }
       
+      scheduler.didWrite(flow, bytes: Int(rc))
       pb.send(Int(rc))
       let nextData = data.subdata(in: Int(rc)..<data.count)
       
@@ -540,14 +588,18 @@ extension InStream: Writer {
         return
       }
       
-      self.rloop.perform { write(nextData) }
+      self.client.perform { write(nextData) }
     }
       
     return .demandingSubject(pb,
-                             receiveRequest: { _ in write(buf) },
+                             receiveRequest: { _ in
+                               scheduler.willWrite(flow, bytes: buf.count)
+                               write(buf)
+                             },
                              receiveCancel: {
                                self.log.message("Cancelling InStream", SSH_LOG_INFO)
                                cancelled = true
+                               self.client.perform { scheduler.cancelPending(flow) }
                              },
                              on: rloop)
   }
@@ -152,5 +152,31 @@ class AgentTests: XCTestCase {
     let output = String(bytes: data, encoding: .utf8)
     XCTAssertTrue(output == "hola\n")
   }
-}
 
+  func testDecodeFromSlice() throws {
+    let message = Data([0xff, 0xff]) +
+      SSHEncode.data(from: "ssh-ed25519") +
+      SSHEncode.data(from: Data([1, 2, 3])) +
+      SSHEncode.data(from: UInt32(4))
+    // Requests are decoded from the middle of the framing buffer.
+    var payload = message[2...]
+
+    XCTAssertEqual(SSHDecode.string(&payload), "ssh-ed25519")
+    XCTAssertEqual(SSHDecode.bytes(&payload), Data([1, 2, 3]))
+    XCTAssertEqual(SSHDecode.uint32(&payload), 4)
+    XCTAssertTrue(payload.isEmpty)
+  }
+
+  func testOfferedKeysAreEncodedOnce() throws {
+    let agent = SSHAgent()
+    let key = try SSHKey(fromFileBlob: Credentials.curvePrivateKey.data(using: .utf8)!)
+    agent.loadKey(key, aka: "test")
+    agent.loadKey(key, aka: "test")
+
+    let keys = agent.offeredKeys()
+    XCTAssertEqual(keys.count, 1)
+    var identity = keys[0].encodedIdentity!
+    XCTAssertEqual(SSHDecode.bytes(&identity), keys[0].blob)
+    XCTAssertEqual(SSHDecode.string(&identity), "test")
+  }
+}
@@ -0,0 +1,228 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import Foundation
+import Network
+
+/// In-process TCP relay on loopback that shapes traffic like a `tc netem` + `tbf`
+/// qdisc would: each direction gets half of the RTT as one-way delay and an
+/// optional token-bucket bandwidth cap. Benchmarks dial the emulator port
+/// instead of the test server, so every byte of the SSH session crosses the
+/// emulated link.
+final class LinkEmulator {
+  struct Profile: CustomStringConvertible {
+    let name: String
+    /// Round trip time added to the loopback path.
+    let rtt: TimeInterval
+    /// Bytes per second for each direction. nil means unlimited.
+    let bandwidth: Int?
+
+    static let loopback = Profile(name: "loopback", rtt: 0, bandwidth: nil)
+    static let lan      = Profile(name: "lan-2ms", rtt: 0.002, bandwidth: 100_000_000 / 8)
+    static let wan      = Profile(name: "wan-40ms", rtt: 0.040, bandwidth: 50_000_000 / 8)
+    static let mobile   = Profile(name: "mobile-120ms", rtt: 0.120, bandwidth: 10_000_000 / 8)
+
+    var description: String { name }
+  }
+
+  let profile: Profile
+  let targetHost: NWEndpoint.Host
+  let targetPort: NWEndpoint.Port
+  let queue = DispatchQueue(label: "LinkEmulator")
+  private var listener: NWListener?
+  private var pipes: [Pipe] = []
+
+  private(set) var port: UInt16 = 0
+
+  init(_ profile: Profile, to host: String, on port: UInt16) {
+    self.profile = profile
+    self.targetHost = NWEndpoint.Host(host)
+    self.targetPort = NWEndpoint.Port(integerLiteral: port)
+  }
+
+  /// Starts listening on an ephemeral loopback port and blocks until it is ready.
+  func start() throws {
+    let params = NWParameters.tcp
+    params.requiredInterfaceType = .loopback
+    params.allowLocalEndpointReuse = true
+    let listener = try NWListener(using: params, on: .any)
+    let ready = DispatchSemaphore(value: 0)
+    var failure: Error? = nil
+
+    listener.stateUpdateHandler = { state in
+      switch state {
+      case .ready:
+        ready.signal()
+      case .failed(let error):
+        failure = error
+        ready.signal()
+      default:
+        break
+      }
+    }
+    listener.newConnectionHandler = { [weak self] in self?.accept($0) }
+    listener.start(queue: queue)
+
+    ready.wait()
+    if let error = failure {
+      throw error
+    }
+    self.listener = listener
+    self.port = listener.port?.rawValue ?? 0
+  }
+
+  func stop() {
+    queue.sync {
+      listener?.cancel()
+      listener = nil
+      pipes.forEach { $0.cancel() }
+      pipes = []
+    }
+  }
+
+  private func accept(_ inbound: NWConnection) {
+    let outbound = NWConnection(host: targetHost, port: targetPort, using: .tcp)
+    let delay = profile.rtt / 2
+    let up = Pipe(from: inbound, to: outbound, delay: delay, bandwidth: profile.bandwidth, queue: queue)
+    let down = Pipe(from: outbound, to: inbound, delay: delay, bandwidth: profile.bandwidth, queue: queue)
+    up.peer = down
+    down.peer = up
+    pipes.append(contentsOf: [up, down])
+
+    inbound.stateUpdateHandler = { state in
+      if case .ready = state { up.start() }
+      if case .failed = state { up.cancel() }
+    }
+    outbound.stateUpdateHandler = { state in
+      if case .ready = state { down.start() }
+      if case .failed = state { down.cancel() }
+    }
+    inbound.start(queue: queue)
+    outbound.start(queue: queue)
+  }
+
+  /// One direction of the link. Receives are paused while more than
+  /// `maxInFlight` bytes are waiting for their delivery time, so a slow link
+  /// pushes back on the sender like a full queue would.
+  private final class Pipe {
+    let src: NWConnection
+    let dst: NWConnection
+    let delay: TimeInterval
+    let bandwidth: Int?
+    let queue: DispatchQueue
+    weak var peer: Pipe?
+
+    let maxInFlight = 1024 * 1024
+    private var inFlight = 0
+    private var receiving = false
+    private var started = false
+    private var cancelled = false
+    // Time at which the link finishes serializing the last accepted packet.
+    private var linkFree: DispatchTime = .now()
+    // Deliveries never reorder, even if a small packet could arrive earlier.
+    private var lastDelivery: DispatchTime = .now()
+
+    init(from src: NWConnection, to dst: NWConnection, delay: TimeInterval, bandwidth: Int?, queue: DispatchQueue) {
+      self.src = src
+      self.dst = dst
+      self.delay = delay
+      self.bandwidth = bandwidth
+      self.queue = queue
+    }
+
+    func start() {
+      guard !started else {
+        return
+      }
+      started = true
+      receive()
+    }
+
+    func cancel() {
+      guard !cancelled else {
+        return
+      }
+      cancelled = true
+      src.cancel()
+      dst.cancel()
+      peer?.cancel()
+    }
+
+    private func receive() {
+      guard !cancelled, !receiving, inFlight < maxInFlight else {
+        return
+      }
+      receiving = true
+      src.receive(minimumIncompleteLength: 1, maximumLength: 64 * 1024) { [weak self] data, _, isComplete, error in
+        guard let self = self else {
+          return
+        }
+        self.receiving = false
+        if let data = data, !data.isEmpty {
+          self.schedule(data, isComplete: false)
+        }
+        if isComplete || error != nil {
+          self.schedule(nil, isComplete: true)
+          return
+        }
+        self.receive()
+      }
+    }
+
+    private func schedule(_ data: Data?, isComplete: Bool) {
+      let now = DispatchTime.now()
+      var ready = now
+      if let data = data, let bandwidth = bandwidth {
+        let serialization = Double(data.count) / Double(bandwidth)
+        linkFree = max(linkFree, now) + serialization
+        ready = linkFree
+      }
+      let deliverAt = max(ready + delay, lastDelivery)
+      lastDelivery = deliverAt
+
+      let count = data?.count ?? 0
+      inFlight += count
+      queue.asyncAfter(deadline: deliverAt) { [weak self] in
+        guard let self = self, !self.cancelled else {
+          return
+        }
+        if isComplete {
+          self.dst.send(content: nil, contentContext: .finalMessage, isComplete: true, completion: .idempotent)
+          return
+        }
+        self.dst.send(content: data, completion: .contentProcessed { error in
+          self.inFlight -= count
+          if error != nil {
+            return self.cancel()
+          }
+          self.receive()
+        })
+      }
+    }
+  }
+}
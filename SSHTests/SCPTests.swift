@@ -159,6 +159,34 @@ class SCPTests: XCTestCase {
     //XCTAssertTrue(totalWritten > 0, "Wrote \(totalWritten)")
   }
   
+  // Directories are shared with their entries, so siblings must not end up inside each other.
+  func testSCPSiblingDirectoriesCopyTo() throws {
+    let fm = FileManager.default
+    let dst = (NSTemporaryDirectory() as NSString).appendingPathComponent(UUID().uuidString)
+    try fm.createDirectory(atPath: dst, withIntermediateDirectories: true)
+    defer { try? fm.removeItem(atPath: dst) }
+
+    let connection = try XCTUnwrap(SSHClient.dialWithTestConfig().exactOneOutput(test: self))
+    let sftp = try XCTUnwrap(connection.requestSFTP().tryMap { try SFTPTranslator(on: $0) }.exactOneOutput(test: self))
+    let status = try XCTUnwrap(
+      sftp.exec("rm -rf /tmp/scp-siblings && mkdir -p /tmp/scp-siblings/a /tmp/scp-siblings/b && " +
+                "echo a > /tmp/scp-siblings/a/fa && echo b > /tmp/scp-siblings/b/fb",
+                stdout: SFTPExecOutput())
+        .exactOneOutput(test: self))
+    XCTAssertEqual(status, 0)
+
+    let local = try XCTUnwrap(Local().walkTo(dst).exactOneOutput(test: self))
+    let copied = SCPClient.execute(using: connection, as: [.Source, .Recursive], root: "/tmp/scp-siblings")
+      .flatMap { $0.copy(to: local) }
+      .collect()
+    XCTAssertNotNil(copied.exactOneOutput(test: self))
+
+    let tree = (dst as NSString).appendingPathComponent("scp-siblings")
+    XCTAssertEqual(fm.contents(atPath: (tree as NSString).appendingPathComponent("a/fa")), Data("a\n".utf8))
+    XCTAssertEqual(fm.contents(atPath: (tree as NSString).appendingPathComponent("b/fb")), Data("b\n".utf8))
+    XCTAssertFalse(fm.fileExists(atPath: (tree as NSString).appendingPathComponent("a/b")))
+  }
+
   // Copy path from scp to path on sftp
   func testCopyTo() throws {
     throw XCTSkip("Disabled SCP for now.")
@@ -216,7 +216,41 @@ class SFTPTests: XCTestCase {
     
     waitForExpectations(timeout: 15, handler: nil)
   }
-  
+
+  // Servers advertising limits@openssh.com get blocks larger than a bulk quantum.
+  func testWriteLargeBlocks() throws {
+    let writeExpectation = self.expectation(description: "File Written")
+    var totalWritten = 0
+    let gen = RandomInputGenerator(fast: true)
+
+    let cancelWrite = SSHClient.dialWithTestConfig()
+      .flatMap() { $0.requestSFTP() }
+      .tryMap()  { sftp -> SFTPTranslator in
+        sftp.blockSize = 256 * 1024
+        return try SFTPTranslator(on: sftp)
+      }
+      .flatMap() { $0.walkTo("/tmp") }
+      .flatMap() { $0.create(name: "newfile-large-blocks", mode: S_IRWXU) }
+      .flatMap() { file in
+        gen.read(max: 5 * 1024 * 1024)
+          .flatMap() { data in
+            file.write(data, max: data.count)
+          }
+      }
+      .sink(receiveCompletion: { completion in
+        if case .failure(let error) = completion {
+          XCTFail("\(error)")
+        }
+        writeExpectation.fulfill()
+      }, receiveValue: { written in
+        totalWritten += written
+      })
+
+    waitForExpectations(timeout: 15, handler: nil)
+    XCTAssertEqual(totalWritten, 5 * 1024 * 1024)
+    cancelWrite.cancel()
+  }
+
   func testWriteToWriter() throws {
     let expectation = self.expectation(description: "Buffer Written")
     
@@ -256,6 +290,57 @@ class SFTPTests: XCTestCase {
     // TODO Cleanup
   }
   
+  func testParseFindTargets() throws {
+    let output = Data(("f\t12\t644\t1700000000.5\t./a file\0" +
+                       "d\t4096\t755\t1700000000.0000000000\t./dir\0" +
+                       "l\t7\t777\t1700000000.0\t./broken\0" +
+                       "garbage\0").utf8)
+    let targets = SFTPTranslator.parseFind(output)
+
+    XCTAssertEqual(targets.count, 2)
+    XCTAssertEqual(targets["a file"]?[.type] as? FileAttributeType, .typeRegular)
+    XCTAssertEqual((targets["a file"]?[.size] as? NSNumber)?.intValue, 12)
+    XCTAssertEqual(targets["a file"]?[.posixPermissions] as? Int16, 0o644)
+    XCTAssertEqual((targets["a file"]?[.modificationDate] as? Date)?.timeIntervalSince1970, 1700000000.5)
+    XCTAssertEqual(targets["dir"]?[.type] as? FileAttributeType, .typeDirectory)
+    XCTAssertNil(targets["broken"])
+  }
+
+  func testServerCopy() throws {
+    var totalWritten: UInt64 = 0
+    var size: UInt64 = 0
+    var capabilities: ServerCapabilities = []
+
+    let copied = self.expectation(description: "Copied on server")
+    let cancellable = SSHClient.dialWithTestConfig()
+      .flatMap() { $0.requestSFTP() }
+      .tryMap()  { try SFTPTranslator(on: $0) }
+      .flatMap() { t in
+        Publishers.Zip(t.walkTo("linux.tar.xz"), t.walkTo("/tmp"))
+      }
+      .flatMap() { (source, destination) -> CopyProgressInfoPublisher in
+        capabilities = (destination as! SFTPTranslator).capabilities
+        return destination.copy(from: [source])
+      }
+      .sink(receiveCompletion: { completion in
+        if case .failure(let error) = completion {
+          XCTFail("\(error)")
+        }
+        copied.fulfill()
+      }, receiveValue: { progress in
+        totalWritten += progress.written
+        size = progress.size
+      })
+
+    waitForExpectations(timeout: 30, handler: nil)
+    cancellable.cancel()
+
+    XCTAssertTrue(capabilities.contains(.copyData))
+    XCTAssertTrue(capabilities.contains(.atomicRename))
+    XCTAssertGreaterThan(size, 0)
+    XCTAssertEqual(totalWritten, size)
+  }
+
   // Z Makes sure we run this one last
   func testZRemove() throws {
     let expectation = self.expectation(description: "Removed")
@@ -387,6 +472,22 @@ class SFTPTests: XCTestCase {
     
     assertCompletionFinished(completion)
   }
+
+  func testBatchRejectsTruncatedReplies() throws {
+    var short = Data([0, 0, 1])
+    XCTAssertThrowsError(try SFTPBatch.uint32(&short))
+
+    // Length runs past the end of the reply.
+    var bytes = SSHEncode.data(from: UInt32(8)) + Data([1, 2, 3])
+    XCTAssertThrowsError(try SFTPBatch.bytes(&bytes))
+
+    var empty = Data()
+    XCTAssertThrowsError(try SFTPBatch.uint8(&empty))
+
+    var handle = SSHEncode.data(from: Data([1, 2, 3])) + Data([4])
+    XCTAssertEqual(try SFTPBatch.bytes(&handle), Data([1, 2, 3]))
+    XCTAssertEqual(try SFTPBatch.uint8(&handle), 4)
+  }
   
   // Write and read a stat
 //  func testStat() throws {
@@ -142,5 +142,18 @@ class SOCKSTests: XCTestCase {
       // TODO complete is never true. Even after the channel has been closed.
     }
     wait(for: [expectResponse], timeout: 1000)
+
+    let stats = server.destinationStats["www.google.com:80"]
+    XCTAssertEqual(stats?.opened, 1)
+    XCTAssertGreaterThan(stats?.bytesOut ?? 0, 0)
+  }
+
+  func testResolverCache() throws {
+    let cache = SOCKSResolverCache(ttl: 60)
+    let address = cache.resolve("localhost")
+    XCTAssertTrue(address == "127.0.0.1" || address == "::1", "Unexpected address \(address)")
+    XCTAssertEqual(cache.resolve("localhost"), address)
+    // Unresolvable names are left for the remote.
+    XCTAssertEqual(cache.resolve("does-not-exist.invalid"), "does-not-exist.invalid")
   }
 }
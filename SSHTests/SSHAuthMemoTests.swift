@@ -0,0 +1,60 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import XCTest
+
+@testable import SSH
+
+class SSHAuthMemoTests: XCTestCase {
+  var path: String!
+
+  override func setUpWithError() throws {
+    path = (NSTemporaryDirectory() as NSString).appendingPathComponent("auth_memo-\(UUID().uuidString).plist")
+  }
+
+  override func tearDownWithError() throws {
+    try? FileManager.default.removeItem(atPath: path)
+  }
+
+  func testRecordAndReload() throws {
+    let key = SSHAuthMemo.key(user: "user", host: "localhost", port: "22", fingerprint: "SHA256:abc")
+    let otherKey = SSHAuthMemo.key(user: "user", host: "localhost", port: "22", fingerprint: "SHA256:def")
+    let method = SSHAuthMemo.identity(of: AuthPassword(with: "pass"))
+
+    SSHAuthMemo(url: URL(fileURLWithPath: path))
+      .record(.init(method: method, agentKey: nil, updated: Date()), for: key)
+
+    let memo = SSHAuthMemo(url: URL(fileURLWithPath: path))
+    XCTAssertEqual(memo.hint(for: key)?.method, method)
+    // A different host key for the same name starts from scratch.
+    XCTAssertNil(memo.hint(for: otherKey))
+
+    memo.forget(key)
+    XCTAssertNil(SSHAuthMemo(url: URL(fileURLWithPath: path)).hint(for: key))
+  }
+}
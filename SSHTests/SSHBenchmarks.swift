@@ -0,0 +1,476 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import XCTest
+import FlowConsoleFiles
+import Combine
+import Dispatch
+import Network
+
+@testable import SSH
+
+/// Throughput and latency benchmarks against the docker test server, run
+/// through a `LinkEmulator` for each link profile. They are skipped unless
+/// `SSH_BENCHMARKS` is set, as they take minutes and need the data services
+/// started by the docker entrypoint (see docker/README.md).
+///
+/// Results are written as JSON to `SSH_BENCHMARKS_OUTPUT` (or the temporary
+/// directory) and compared against benchmarks-baseline.json next to this file,
+/// when there is one. Run with `SSH_BENCHMARKS_RECORD=1` to store the new
+/// numbers as baseline.
+class SSHBenchmarks: XCTestCase {
+  static let profiles: [LinkEmulator.Profile] = [.loopback, .lan, .wan, .mobile]
+  static let maxTransferSize = 32 * 1024 * 1024
+  // Seconds of transfer at full link speed, so slow profiles finish in time.
+  static let transferSeconds = 4
+  static let remoteSourcePort: UInt16 = 9000
+  static let remoteForwardPort: UInt16 = 9100
+  static let localForwardPort: UInt16 = 28080
+  static let socksPort: UInt16 = 28081
+
+  static var results: [String: Double] = [:]
+  static var localFile: URL!
+
+  var cancellableBag: [AnyCancellable] = []
+
+  override class func setUp() {
+    SSHInit()
+  }
+
+  override class func tearDown() {
+    guard !results.isEmpty else {
+      return
+    }
+    let report = BenchmarkReport.current(results)
+    try? report.write(to: BenchmarkReport.outputURL)
+    print("Benchmark results written to \(BenchmarkReport.outputURL.path)")
+    if ProcessInfo.processInfo.environment["SSH_BENCHMARKS_RECORD"] != nil {
+      var baseline = BenchmarkReport.baseline ?? report
+      baseline.results.merge(results) { _, new in new }
+      try? baseline.write(to: BenchmarkReport.baselineURL)
+    }
+    if let file = localFile {
+      try? FileManager.default.removeItem(at: file)
+    }
+  }
+
+  override func setUpWithError() throws {
+    guard ProcessInfo.processInfo.environment["SSH_BENCHMARKS"] != nil else {
+      throw XCTSkip("Set SSH_BENCHMARKS=1 to run the loopback benchmarks.")
+    }
+    continueAfterFailure = false
+
+    if Self.localFile == nil {
+      let url = URL(fileURLWithPath: NSTemporaryDirectory()).appendingPathComponent("ssh-bench-put")
+      let data = Data((0..<Self.maxTransferSize).map { _ in UInt8.random(in: 0...255) })
+      try data.write(to: url)
+      Self.localFile = url
+    }
+  }
+
+  override func tearDown() {
+    cancellableBag = []
+  }
+
+  func testConnectionSetup() throws {
+    try forEachProfile { profile, emulator in
+      var samples: [Double] = []
+      for _ in 0..<5 {
+        let start = Date()
+        let client = try dial(emulator)
+        samples.append(Date().timeIntervalSince(start) * 1000)
+        _ = client
+      }
+      record("connect-ms", on: profile, samples.sorted()[samples.count / 2], higherIsBetter: false)
+    }
+  }
+
+  func testExecStdout() throws {
+    try forEachProfile { profile, emulator in
+      let client = try dial(emulator)
+      let size = Self.transferSize(profile)
+
+      let elapsed = try timed(bytes: size) { done in
+        let writer = DiscardWriter()
+        client.requestExec(command: "head -c \(size) /dev/zero")
+          .assertNoFailure()
+          .sink { stream in
+            stream.handleCompletion = {
+              XCTAssertEqual(writer.count, size)
+              done()
+            }
+            stream.handleFailure = { XCTFail("\($0)") }
+            stream.connect(stdout: writer)
+          }.store(in: &cancellableBag)
+      }
+      record("exec-stdout-MBps", on: profile, Self.throughput(size, elapsed))
+    }
+  }
+
+  func testSFTPGet() throws {
+    try forEachProfile { profile, emulator in
+      let client = try dial(emulator)
+      let size = Self.transferSize(profile)
+      let path = "/tmp/ssh-bench-get"
+      try exec("head -c \(size) /dev/urandom > \(path)", on: client)
+
+      let sftp = try XCTUnwrap(
+        client.requestSFTP().tryMap { try SFTPTranslator(on: $0) }.exactOneOutput(test: self, timeout: 15)
+      )
+
+      let elapsed = try timed(bytes: size) { done in
+        let writer = DiscardWriter()
+        sftp.walkTo(path)
+          .flatMap { $0.open(flags: O_RDONLY) }
+          .flatMap { $0.writeTo(writer) }
+          .sink(receiveCompletion: { completion in
+            if case .failure(let error) = completion {
+              XCTFail("\(error)")
+            }
+            XCTAssertEqual(writer.count, size)
+            done()
+          }, receiveValue: { _ in })
+          .store(in: &cancellableBag)
+      }
+      record("sftp-get-MBps", on: profile, Self.throughput(size, elapsed))
+    }
+  }
+
+  func testSFTPPut() throws {
+    try forEachProfile { profile, emulator in
+      let client = try dial(emulator)
+      let size = Self.transferSize(profile)
+      let source = try localSource(size: size)
+
+      let sftp = try XCTUnwrap(
+        client.requestSFTP().tryMap { try SFTPTranslator(on: $0) }.exactOneOutput(test: self, timeout: 15)
+      )
+
+      let elapsed = try timed(bytes: size) { done in
+        sftp.walkTo("/tmp")
+          .flatMap { $0.copy(from: [source]) }
+          .sink(receiveCompletion: { completion in
+            if case .failure(let error) = completion {
+              XCTFail("\(error)")
+            }
+            done()
+          }, receiveValue: { _ in })
+          .store(in: &cancellableBag)
+      }
+      record("sftp-put-MBps", on: profile, Self.throughput(size, elapsed))
+    }
+  }
+
+  func testSCPPut() throws {
+    try forEachProfile { profile, emulator in
+      let client = try dial(emulator)
+      let size = Self.transferSize(profile)
+      let source = try localSource(size: size)
+
+      let elapsed = try timed(bytes: size) { done in
+        SCPClient.execute(using: client, as: .Sink, root: "/tmp")
+          .flatMap { $0.copy(from: [source]) }
+          .sink(receiveCompletion: { completion in
+            if case .failure(let error) = completion {
+              XCTFail("\(error)")
+            }
+            done()
+          }, receiveValue: { _ in })
+          .store(in: &cancellableBag)
+      }
+      record("scp-put-MBps", on: profile, Self.throughput(size, elapsed))
+    }
+  }
+
+  func testLocalForward() throws {
+    try forEachProfile { profile, emulator in
+      let client = try dial(emulator)
+      let size = Self.transferSize(profile)
+
+      let listener = SSHPortForwardListener(on: Self.localForwardPort, toDestination: "127.0.0.1",
+                                            on: Self.remoteSourcePort, using: client)
+      _ = try XCTUnwrap(listener.ready().exactOneOutput(test: self, timeout: 15))
+      defer { listener.close() }
+
+      let elapsed = try timed(bytes: size) { done in
+        let conn = NWConnection(host: "127.0.0.1", port: NWEndpoint.Port(integerLiteral: Self.localForwardPort), using: .tcp)
+        conn.stateUpdateHandler = { state in
+          if case .ready = state {
+            Self.drain(conn, bytes: size) { done() }
+          }
+        }
+        conn.start(queue: .main)
+      }
+      record("local-forward-MBps", on: profile, Self.throughput(size, elapsed))
+    }
+  }
+
+  func testRemoteForward() throws {
+    try forEachProfile { profile, emulator in
+      let client = try dial(emulator)
+      let size = Self.transferSize(profile)
+
+      let source = try ZeroSource(size: size)
+      defer { source.cancel() }
+      let forward = SSHPortForwardClient(forward: "127.0.0.1", onPort: source.port,
+                                         toRemotePort: Self.remoteForwardPort, using: client)
+      _ = try XCTUnwrap(forward.ready().exactOneOutput(test: self, timeout: 15))
+      defer { forward.close() }
+
+      // Includes the exec round trips, which are measured separately on testExecStdout.
+      let elapsed = try timed(bytes: size) { done in
+        let cmd = "bash -c 'head -c \(size) < /dev/tcp/127.0.0.1/\(Self.remoteForwardPort) | wc -c'"
+        client.requestExec(command: cmd)
+          .flatMap { $0.read(max: SSIZE_MAX) }
+          .assertNoFailure()
+          .sink { buf in
+            let output = String(data: buf as AnyObject as! Data, encoding: .utf8)
+            XCTAssertEqual(output?.trimmingCharacters(in: .whitespacesAndNewlines), "\(size)")
+            done()
+          }.store(in: &cancellableBag)
+      }
+      record("remote-forward-MBps", on: profile, Self.throughput(size, elapsed))
+    }
+  }
+
+  func testDynamicForward() throws {
+    try forEachProfile { profile, emulator in
+      let client = try dial(emulator)
+      let size = Self.transferSize(profile)
+
+      let socks = try SOCKSServer(Self.socksPort, proxy: client)
+      defer { socks.close() }
+
+      let elapsed = try timed(bytes: size) { done in
+        let conn = NWConnection(host: "127.0.0.1", port: NWEndpoint.Port(integerLiteral: Self.socksPort), using: .tcp)
+        conn.stateUpdateHandler = { state in
+          guard case .ready = state else {
+            return
+          }
+          // No auth, then CONNECT 127.0.0.1:remoteSourcePort.
+          let port = Self.remoteSourcePort
+          conn.send(content: Data([0x05, 0x01, 0x00]), completion: .idempotent)
+          conn.send(content: Data([0x05, 0x01, 0x00, 0x01, 127, 0, 0, 1, UInt8(port >> 8), UInt8(port & 0xff)]),
+                    completion: .idempotent)
+          conn.receive(minimumIncompleteLength: 2 + 10, maximumLength: 2 + 10) { data, _, _, error in
+            XCTAssertNil(error)
+            XCTAssertEqual(data?[data!.startIndex + 3], 0x00, "SOCKS CONNECT failed")
+            Self.drain(conn, bytes: size) { done() }
+          }
+        }
+        conn.start(queue: .main)
+      }
+      record("dynamic-forward-MBps", on: profile, Self.throughput(size, elapsed))
+    }
+  }
+}
+
+extension SSHBenchmarks {
+  func forEachProfile(_ body: (LinkEmulator.Profile, LinkEmulator) throws -> ()) throws {
+    for profile in Self.profiles {
+      let emulator = LinkEmulator(profile, to: Credentials.none.host, on: UInt16(Credentials.port)!)
+      try emulator.start()
+      defer { emulator.stop() }
+      try body(profile, emulator)
+    }
+  }
+
+  func dial(_ emulator: LinkEmulator) throws -> SSHClient {
+    let config = SSHClientConfig(
+      user: Credentials.none.user,
+      port: String(emulator.port),
+      authMethods: []
+    )
+    return try XCTUnwrap(SSHClient.dial("127.0.0.1", with: config).exactOneOutput(test: self, timeout: 30))
+  }
+
+  func exec(_ command: String, on client: SSHClient) throws {
+    _ = try XCTUnwrap(
+      client.requestExec(command: command)
+        .flatMap { $0.read(max: SSIZE_MAX) }
+        .lastOutput(test: self, timeout: 60)
+    )
+  }
+
+  func localSource(size: Int) throws -> Translator {
+    let url = Self.localFile.deletingLastPathComponent().appendingPathComponent("ssh-bench-put-\(size)")
+    if !FileManager.default.fileExists(atPath: url.path) {
+      try Data(contentsOf: Self.localFile).prefix(size).write(to: url)
+    }
+    return try XCTUnwrap(Local().walkTo(url.path).exactOneOutput(test: self))
+  }
+
+  /// Runs the transfer started by `body` and returns the seconds until it calls done.
+  func timed(bytes: Int, _ body: (@escaping () -> ()) -> ()) throws -> TimeInterval {
+    let expectation = self.expectation(description: "Transfer completed")
+    let start = Date()
+    var end: Date? = nil
+    body {
+      end = Date()
+      expectation.fulfill()
+    }
+    // Allow for a link three times slower than the slowest profile.
+    wait(for: [expectation], timeout: Double(Self.transferSeconds) * 3 + 60)
+    return try XCTUnwrap(end).timeIntervalSince(start)
+  }
+
+  func record(_ metric: String, on profile: LinkEmulator.Profile, _ value: Double, higherIsBetter: Bool = true) {
+    let key = "\(profile.name)/\(metric)"
+    Self.results[key] = value
+    print("BENCHMARK \(key) \(String(format: "%.2f", value))")
+
+    guard let baseline = BenchmarkReport.baseline,
+          let expected = baseline.results[key] else {
+      return
+    }
+    if higherIsBetter {
+      XCTAssertGreaterThanOrEqual(value, expected * (1 - baseline.tolerance), "\(key) regressed from \(expected)")
+    } else {
+      XCTAssertLessThanOrEqual(value, expected * (1 + baseline.tolerance), "\(key) regressed from \(expected)")
+    }
+  }
+
+  static func transferSize(_ profile: LinkEmulator.Profile) -> Int {
+    guard let bandwidth = profile.bandwidth else {
+      return maxTransferSize
+    }
+    return min(maxTransferSize, bandwidth * transferSeconds)
+  }
+
+  static func throughput(_ bytes: Int, _ elapsed: TimeInterval) -> Double {
+    Double(bytes) / elapsed / 1_000_000
+  }
+
+  static func drain(_ conn: NWConnection, bytes: Int, then done: @escaping () -> ()) {
+    conn.receive(minimumIncompleteLength: 1, maximumLength: min(bytes, 256 * 1024)) { data, _, isComplete, error in
+      let left = bytes - (data?.count ?? 0)
+      if left <= 0 {
+        conn.cancel()
+        return done()
+      }
+      if isComplete || error != nil {
+        XCTFail("Connection closed with \(left) bytes left. \(String(describing: error))")
+        conn.cancel()
+        return done()
+      }
+      drain(conn, bytes: left, then: done)
+    }
+  }
+}
+
+struct BenchmarkReport: Codable {
+  var date: Date
+  var profiles: [String]
+  /// Allowed relative regression before a benchmark fails against the baseline.
+  var tolerance: Double
+  var results: [String: Double]
+
+  static let baselineURL = URL(fileURLWithPath: #filePath)
+    .deletingLastPathComponent()
+    .appendingPathComponent("benchmarks-baseline.json")
+
+  static var outputURL: URL {
+    if let path = ProcessInfo.processInfo.environment["SSH_BENCHMARKS_OUTPUT"] {
+      return URL(fileURLWithPath: path)
+    }
+    return URL(fileURLWithPath: NSTemporaryDirectory()).appendingPathComponent("ssh-benchmarks.json")
+  }
+
+  static let baseline: BenchmarkReport? = {
+    guard let data = try? Data(contentsOf: baselineURL) else {
+      return nil
+    }
+    let decoder = JSONDecoder()
+    decoder.dateDecodingStrategy = .iso8601
+    return try? decoder.decode(BenchmarkReport.self, from: data)
+  }()
+
+  static func current(_ results: [String: Double]) -> BenchmarkReport {
+    BenchmarkReport(date: Date(),
+                    profiles: SSHBenchmarks.profiles.map { $0.name },
+                    tolerance: baseline?.tolerance ?? 0.2,
+                    results: results)
+  }
+
+  func write(to url: URL) throws {
+    let encoder = JSONEncoder()
+    encoder.dateEncodingStrategy = .iso8601
+    encoder.outputFormatting = [.prettyPrinted, .sortedKeys]
+    try encoder.encode(self).write(to: url)
+  }
+}
+
+/// Writer that only counts, so benchmarks measure the transport and not the sink.
+final class DiscardWriter: Writer {
+  private(set) var count = 0
+
+  func write(_ buf: DispatchData, max length: Int) -> AnyPublisher<Int, Error> {
+    count += buf.count
+    return .just(buf.count)
+  }
+}
+
+/// Local TCP service that sends `size` zero bytes to each connection and closes.
+final class ZeroSource {
+  let listener: NWListener
+  let size: Int
+  var port: UInt16 { listener.port?.rawValue ?? 0 }
+
+  init(size: Int) throws {
+    self.size = size
+    self.listener = try NWListener(using: .tcp, on: .any)
+    let ready = DispatchSemaphore(value: 0)
+    listener.stateUpdateHandler = { state in
+      if case .ready = state { ready.signal() }
+    }
+    listener.newConnectionHandler = { [size] conn in
+      conn.start(queue: .global())
+      ZeroSource.send(conn, left: size)
+    }
+    listener.start(queue: .global())
+    ready.wait()
+  }
+
+  func cancel() {
+    listener.cancel()
+  }
+
+  private static func send(_ conn: NWConnection, left: Int) {
+    guard left > 0 else {
+      conn.send(content: nil, contentContext: .finalMessage, isComplete: true, completion: .idempotent)
+      return
+    }
+    let chunk = min(left, 64 * 1024)
+    conn.send(content: Data(count: chunk), completion: .contentProcessed { error in
+      guard error == nil else {
+        return conn.cancel()
+      }
+      send(conn, left: left - chunk)
+    })
+  }
+}
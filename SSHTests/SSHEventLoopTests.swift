@@ -0,0 +1,108 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import XCTest
+
+@testable import SSH
+
+class SSHEventLoopTests: XCTestCase {
+
+  func testTimerWheel() throws {
+    let wheel = SSHTimerWheel(slots: 4, resolution: 1)
+    var fired: [String] = []
+
+    wheel.schedule(after: 1) { fired.append("short") }
+    // Longer than a full turn of the wheel.
+    wheel.schedule(after: 6) { fired.append("long") }
+    let cancelled = wheel.schedule(after: 2) { fired.append("cancelled") }
+    wheel.cancel(cancelled)
+    XCTAssertEqual(wheel.count, 2)
+
+    wheel.tick()
+    XCTAssertEqual(fired, ["short"])
+
+    for _ in 0..<4 { wheel.tick() }
+    XCTAssertEqual(fired, ["short"])
+
+    wheel.tick()
+    XCTAssertEqual(fired, ["short", "long"])
+    XCTAssertEqual(wheel.count, 0)
+  }
+
+  func testFairPerform() throws {
+    let loop = SSHEventLoopGroup(numberOfLoops: 1).next()
+    let busy = NSObject()
+    let quiet = NSObject()
+    var order: [String] = []
+    let done = expectation(description: "All blocks performed")
+    done.expectedFulfillmentCount = 4
+
+    // Schedule from the loop itself so no drain happens in between.
+    loop.perform(for: busy) {
+      for i in 0..<3 {
+        loop.perform(for: busy) { order.append("busy\(i)"); done.fulfill() }
+      }
+      loop.perform(for: quiet) { order.append("quiet"); done.fulfill() }
+    }
+
+    wait(for: [done], timeout: 2)
+    // The quiet owner does not wait for the whole busy queue.
+    XCTAssertEqual(order.firstIndex(of: "quiet"), 1)
+  }
+
+  func testBlockingCallDoesNotRunOtherWork() throws {
+    let loop = SSHEventLoopGroup(numberOfLoops: 1).next()
+    let blocking = NSObject()
+    let other = NSObject()
+    var order: [String] = []
+    let done = expectation(description: "Other work performed")
+
+    loop.perform(for: blocking) {
+      loop.perform(for: other) { order.append("other"); done.fulfill() }
+      // Same as a publisher retrying a libssh call.
+      RunLoop.current.run(mode: libSSHBlockMode, before: Date(timeIntervalSinceNow: 0.1))
+      order.append("blocking")
+    }
+
+    wait(for: [done], timeout: 2)
+    XCTAssertEqual(order, ["blocking", "other"])
+  }
+
+  func testGroupSpreadsClients() throws {
+    let group = SSHEventLoopGroup(numberOfLoops: 2)
+    let first = group.next()
+    first.attach()
+    let second = group.next()
+    XCTAssertFalse(first === second)
+    second.attach()
+    second.attach()
+
+    // No more loops than the limit, and the least loaded is chosen.
+    XCTAssertTrue(group.next() === first)
+  }
+}
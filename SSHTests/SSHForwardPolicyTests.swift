@@ -0,0 +1,74 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import XCTest
+
+@testable import SSH
+
+class SSHForwardPolicyTests: XCTestCase {
+  func testUnlimitedServesEverything() throws {
+    let policy = SSHForwardPolicy()
+    XCTAssertEqual(policy.admit(streams: 1000, warm: 0, queued: 0), .serve)
+    XCTAssertEqual(policy.missingWarm(streams: 1000, warm: 0), 0)
+  }
+
+  func testStreamsOverTheCapAreQueued() throws {
+    let policy = SSHForwardPolicy(maxConnections: 2, maxQueued: 2)
+    XCTAssertEqual(policy.admit(streams: 0, warm: 0, queued: 0), .serve)
+    XCTAssertEqual(policy.admit(streams: 1, warm: 0, queued: 0), .serve)
+    XCTAssertEqual(policy.admit(streams: 2, warm: 0, queued: 0), .queue)
+    XCTAssertEqual(policy.admit(streams: 2, warm: 0, queued: 1), .queue)
+  }
+
+  func testStreamsOverTheQueueAreClosed() throws {
+    let policy = SSHForwardPolicy(maxConnections: 2, maxQueued: 2)
+    XCTAssertEqual(policy.admit(streams: 2, warm: 0, queued: 2), .close)
+
+    let noQueue = SSHForwardPolicy(maxConnections: 1, maxQueued: 0)
+    XCTAssertEqual(noQueue.admit(streams: 1, warm: 0, queued: 0), .close)
+  }
+
+  func testPrewarmStaysWithinTheCap() throws {
+    let policy = SSHForwardPolicy(maxConnections: 4, prewarm: 2)
+    XCTAssertEqual(policy.missingWarm(streams: 0, warm: 0), 2)
+    XCTAssertEqual(policy.missingWarm(streams: 0, warm: 1), 1)
+    XCTAssertEqual(policy.missingWarm(streams: 3, warm: 0), 1)
+    XCTAssertEqual(policy.missingWarm(streams: 4, warm: 0), 0)
+
+    // Warm connections count against the cap, but can be handed to a new stream.
+    XCTAssertEqual(policy.admit(streams: 3, warm: 1, queued: 0), .serve)
+    XCTAssertEqual(policy.admit(streams: 4, warm: 0, queued: 0), .queue)
+  }
+
+  func testPrewarmedConnectionsExpire() throws {
+    let policy = SSHForwardPolicy(prewarm: 1, prewarmLifetime: 30)
+    let openedAt = Date()
+    XCTAssertTrue(policy.isFresh(openedAt: openedAt, now: openedAt.addingTimeInterval(29)))
+    XCTAssertFalse(policy.isFresh(openedAt: openedAt, now: openedAt.addingTimeInterval(30)))
+  }
+}
@@ -0,0 +1,109 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import CryptoKit
+import XCTest
+
+@testable import SSH
+
+class SSHKnownHostsTests: XCTestCase {
+  let ed25519 = "AAAAC3NzaC1lZDI1NTE5AAAAIHB0aGlzaXNub3RhcmVhbGtleWJ1dGl0aXNmaW5l"
+  let otherEd25519 = "AAAAC3NzaC1lZDI1NTE5AAAAIGFub3RoZXJrZXl0aGF0aXNub3RyZWFsZWl0aGVy"
+  let rsa = "AAAAB3NzaC1yc2EAAAADAQABAAABAQDnotarealrsakey"
+  var path: String!
+
+  override func setUpWithError() throws {
+    path = (NSTemporaryDirectory() as NSString).appendingPathComponent("known_hosts-\(UUID().uuidString)")
+  }
+
+  override func tearDownWithError() throws {
+    try? FileManager.default.removeItem(atPath: path)
+  }
+
+  func hashed(_ token: String) -> String {
+    let salt = Data((0..<20).map { _ in UInt8.random(in: 0...255) })
+    let mac = HMAC<Insecure.SHA1>.authenticationCode(for: Data(token.utf8), using: SymmetricKey(data: salt))
+    return "|1|\(salt.base64EncodedString())|\(Data(mac).base64EncodedString())"
+  }
+
+  func testVerify() throws {
+    let content = """
+    # comment
+    plain.example.com,10.0.0.1 ssh-ed25519 \(ed25519)
+    [ported.example.com]:2222 ssh-ed25519 \(ed25519)
+    \(hashed("secret.example.com")) ssh-ed25519 \(ed25519)
+    *.wild.example.com,!bad.wild.example.com ssh-rsa \(rsa)
+    @revoked revoked.example.com ssh-ed25519 \(ed25519)
+    """
+    try content.write(toFile: path, atomically: true, encoding: .utf8)
+    let kh = SSHKnownHosts(path: path)
+
+    XCTAssertEqual(kh.verify(host: "plain.example.com", port: 22, keyType: "ssh-ed25519", key: ed25519), .ok)
+    XCTAssertEqual(kh.verify(host: "10.0.0.1", port: 22, keyType: "ssh-ed25519", key: otherEd25519), .changed)
+    XCTAssertEqual(kh.verify(host: "ported.example.com", port: 2222, keyType: "ssh-ed25519", key: ed25519), .ok)
+    XCTAssertEqual(kh.verify(host: "ported.example.com", port: 22, keyType: "ssh-ed25519", key: ed25519), .unknown)
+    XCTAssertEqual(kh.verify(host: "secret.example.com", port: 22, keyType: "ssh-ed25519", key: ed25519), .ok)
+    XCTAssertEqual(kh.verify(host: "a.wild.example.com", port: 22, keyType: "ssh-rsa", key: rsa), .ok)
+    XCTAssertEqual(kh.verify(host: "a.wild.example.com", port: 22, keyType: "ssh-ed25519", key: ed25519), .other)
+    XCTAssertEqual(kh.verify(host: "bad.wild.example.com", port: 22, keyType: "ssh-rsa", key: rsa), .unknown)
+    XCTAssertEqual(kh.verify(host: "revoked.example.com", port: 22, keyType: "ssh-ed25519", key: ed25519), .changed)
+
+    XCTAssertEqual(kh.hostNames(), ["10.0.0.1", "plain.example.com", "ported.example.com", "revoked.example.com"])
+  }
+
+  func testMissingFile() throws {
+    let kh = SSHKnownHosts(path: path)
+    XCTAssertEqual(kh.verify(host: "plain.example.com", port: 22, keyType: "ssh-ed25519", key: ed25519), .notFound)
+    XCTAssertEqual(kh.hostNames(), [])
+  }
+
+  func testUpdateReplacesAndReloads() throws {
+    try "plain.example.com ssh-ed25519 \(ed25519)\nshared.example.com,plain.example.com ssh-ed25519 \(ed25519)\n"
+      .write(toFile: path, atomically: true, encoding: .utf8)
+    let kh = SSHKnownHosts(path: path)
+
+    try kh.update(host: "plain.example.com", port: 22, keyType: "ssh-ed25519", key: otherEd25519)
+    let lines = try String(contentsOfFile: path).split(separator: "\n")
+    // The single host line is replaced, the shared one is kept.
+    XCTAssertEqual(lines.count, 2)
+    XCTAssertEqual(lines.last.map(String.init), "plain.example.com ssh-ed25519 \(otherEd25519)")
+
+    try kh.update(host: "new.example.com", port: 2200, keyType: "ssh-ed25519", key: ed25519)
+    XCTAssertEqual(kh.verify(host: "new.example.com", port: 2200, keyType: "ssh-ed25519", key: ed25519), .ok)
+
+    // External changes are picked up.
+    try "".write(toFile: path, atomically: true, encoding: .utf8)
+    XCTAssertEqual(kh.verify(host: "new.example.com", port: 2200, keyType: "ssh-ed25519", key: ed25519), .unknown)
+  }
+
+  func testWildcardMatch() {
+    XCTAssertTrue(SSHKnownHosts.wildcardMatch("*.example.com", "a.example.com"))
+    XCTAssertTrue(SSHKnownHosts.wildcardMatch("[host?]:22*", "[host1]:2222"))
+    XCTAssertFalse(SSHKnownHosts.wildcardMatch("*.example.com", "example.com"))
+  }
+}
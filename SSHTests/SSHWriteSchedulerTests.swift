@@ -0,0 +1,116 @@
+//////////////////////////////////////////////////////////////////////////////////
+//
+// F L O W  C O N S O L E
+//
+// Based on Blink Shell for iOS
+// Original Copyright (C) 2016-2024 Blink Shell contributors
+// Flow Console modifications Copyright (C) 2024 Flow Console Project
+//
+// This file is part of Flow Console.
+//
+// Flow Console is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Flow Console is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Flow Console. If not, see <http://www.gnu.org/licenses/>.
+//
+// Original Blink Shell project: https://github.com/blinksh/blink
+// Flow Console project: https://github.com/rafliruslan/flow-console
+//
+////////////////////////////////////////////////////////////////////////////////
+
+import XCTest
+
+@testable import SSH
+
+class SSHWriteSchedulerTests: XCTestCase {
+  var turns: [() -> Void] = []
+
+  func scheduler() -> SSHWriteScheduler {
+    SSHWriteScheduler(interactiveQuantum: 4, bulkQuantum: 10, bulkBudgetPerTurn: 25,
+                      perform: { self.turns.append($0) })
+  }
+
+  func nextTurn() {
+    let pending = turns
+    turns = []
+    pending.forEach { $0() }
+  }
+
+  func testInteractiveHasPriority() throws {
+    let s = scheduler()
+    let shell = s.register(.interactive)
+    let bulk = s.register(.bulk(weight: 1))
+
+    s.willWrite(shell, bytes: 6)
+    XCTAssertEqual(s.grant(bulk, wanting: 100), 0)
+    // Interactive data goes in small quanta.
+    XCTAssertEqual(s.grant(shell, wanting: 6), 4)
+    s.didWrite(shell, bytes: 4)
+    XCTAssertEqual(s.grant(bulk, wanting: 100), 0)
+    s.didWrite(shell, bytes: 2)
+
+    XCTAssertEqual(s.grant(bulk, wanting: 100), 10)
+  }
+
+  func testCancelledInteractiveReleasesBulk() throws {
+    let s = scheduler()
+    let shell = s.register(.interactive)
+    let bulk = s.register(.bulk(weight: 1))
+
+    s.willWrite(shell, bytes: 6)
+    XCTAssertEqual(s.grant(bulk, wanting: 100), 0)
+    s.unregister(shell)
+    XCTAssertEqual(s.grant(bulk, wanting: 100), 10)
+  }
+
+  func testBulkIsWeightedAndCapped() throws {
+    let s = scheduler()
+    let light = s.register(.bulk(weight: 1))
+    let heavy = s.register(.bulk(weight: 2))
+
+    XCTAssertEqual(s.grant(light, wanting: 100), 10)
+    s.didWrite(light, bytes: 10)
+    XCTAssertEqual(s.grant(light, wanting: 100), 0)
+
+    XCTAssertEqual(s.grant(heavy, wanting: 100), 15, "Capped by what is left of the turn budget")
+    s.didWrite(heavy, bytes: 15)
+    XCTAssertEqual(s.grant(heavy, wanting: 100), 0)
+
+    nextTurn()
+    XCTAssertEqual(s.grant(heavy, wanting: 100), 25, "What the budget cut off carries over")
+    s.didWrite(heavy, bytes: 25)
+    XCTAssertEqual(s.grant(light, wanting: 100), 0)
+
+    // Turns without budget do not earn credit.
+    nextTurn()
+    XCTAssertEqual(s.grant(light, wanting: 100), 10)
+  }
+
+  func testBlockLargerThanQuantum() throws {
+    let s = SSHWriteScheduler(perform: { self.turns.append($0) })
+    let sftp = s.register(.bulk(weight: 2))
+    let block = 256 * 1024
+
+    // The writer waits for a whole block, and the deficit grows each turn until it fits.
+    var turnsWaited = 0
+    while s.grant(sftp, wanting: block) < block {
+      XCTAssertFalse(turns.isEmpty, "A turn must be scheduled while the writer waits")
+      nextTurn()
+      turnsWaited += 1
+      XCTAssertLessThan(turnsWaited, 8)
+    }
+    XCTAssertEqual(turnsWaited, 3)
+    s.didWrite(sftp, bytes: block)
+
+    nextTurn()
+    XCTAssertEqual(s.grant(sftp, wanting: block), 64 * 1024)
+  }
+}
@@ -2,4 +2,7 @@
 
 dropbear -RB -p 23
 
+# Endless data source for the forward benchmarks (SSHBenchmarks).
+socat TCP-LISTEN:9000,bind=127.0.0.1,fork,reuseaddr OPEN:/dev/zero &
+
 exec /usr/sbin/sshd -D -e $@
\ No newline at end of file